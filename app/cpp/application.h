@@ -3,7 +3,10 @@
 #include "graphics_plugin_vulkan.h"
 
 #include <android/asset_manager.h>
+#include <algorithm>
+#include <iterator>
 #include <memory>
+#include <vector>
 
 #include "common/file/android_file_loader.h"
 #include "common/model_loader/model_loader.h"
@@ -58,6 +61,11 @@ ErrorOr<Texture> createCubemap(const LogicalDevice &logicalDevice,
                   createBufferImageCopyRegions(imageData.copyRegions));
 }
 
+// The texels are copied as they are, any format of their size works. The KTX holds sRGB encoded
+// colors, which the compositor only decodes from an SRGB format.
+constexpr int64_t kSkyboxLayerFormats[] = {VK_FORMAT_R8G8B8A8_SRGB,
+                                           VK_FORMAT_R8G8B8A8_UNORM};
+
 } // namespace
 
 namespace xrw {
@@ -79,6 +87,139 @@ public:
     return StatusOk();
   }
 
+  // Uploads the cubemap once into a static cube swapchain, to be submitted as an
+  // XrCompositionLayerCubeKHR below the projection layer. The skybox is no longer rasterized
+  // from then on, the eye buffers are cleared transparent instead. The caller destroys the
+  // swapchain, before the session. XR_NULL_HANDLE when the runtime offers none of the formats,
+  // the skybox then stays rasterized.
+  ErrorOr<XrSwapchain> createSkyboxSwapchain(XrSession session) {
+    uint32_t formatCount = 0;
+    CHECK_XRCMD(xrEnumerateSwapchainFormats(session, 0, &formatCount, nullptr));
+    std::vector<int64_t> formats(formatCount);
+    CHECK_XRCMD(xrEnumerateSwapchainFormats(session, formatCount, &formatCount,
+                                            formats.data()));
+    const auto format = std::find_first_of(
+        formats.cbegin(), formats.cend(), std::cbegin(kSkyboxLayerFormats),
+        std::cend(kSkyboxLayerFormats));
+    if (format == formats.cend()) {
+      return XR_NULL_HANDLE;
+    }
+
+    ASSIGN_OR_RETURN(const AssetManager::ImageData &imageData,
+                     _assetManager.getImageData(TEXTURES_PATH
+                                                "cubemap_yokohama_rgba.ktx"));
+
+    const XrSwapchainCreateInfo createInfo = {
+        .type = XR_TYPE_SWAPCHAIN_CREATE_INFO,
+        .createFlags = XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT,
+        .usageFlags = XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT |
+                      XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT,
+        .format = *format,
+        .sampleCount = 1,
+        .width = static_cast<uint32_t>(imageData.width),
+        .height = static_cast<uint32_t>(imageData.height),
+        .faceCount = 6,
+        .arraySize = 1,
+        .mipCount = static_cast<uint32_t>(imageData.mipLevels)};
+    XrSwapchain swapchain = XR_NULL_HANDLE;
+    CHECK_XRCMD(xrCreateSwapchain(session, &createInfo, &swapchain));
+
+    uint32_t imageCount = 0;
+    CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr));
+    std::vector<XrSwapchainImageVulkan2KHR> images(
+        imageCount, {.type = XR_TYPE_SWAPCHAIN_IMAGE_VULKAN2_KHR});
+    CHECK_XRCMD(xrEnumerateSwapchainImages(
+        swapchain, imageCount, &imageCount,
+        reinterpret_cast<XrSwapchainImageBaseHeader *>(images.data())));
+
+    // A static swapchain is acquired and released exactly once.
+    const XrSwapchainImageAcquireInfo acquireInfo = {
+        .type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+    uint32_t imageIndex = 0;
+    CHECK_XRCMD(xrAcquireSwapchainImage(swapchain, &acquireInfo, &imageIndex));
+    const XrSwapchainImageWaitInfo waitInfo = {
+        .type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO,
+        .timeout = XR_INFINITE_DURATION};
+    CHECK_XRCMD(xrWaitSwapchainImage(swapchain, &waitInfo));
+    {
+      SingleTimeCommandBuffer handle(*_singleTimeCommandPool);
+      const VkCommandBuffer commandBuffer = handle.getCommandBuffer();
+
+      VkImageMemoryBarrier barrier = {
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = 0,
+          .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+          .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = images[imageIndex].image,
+          .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                               .baseMipLevel = 0,
+                               .levelCount = createInfo.mipCount,
+                               .baseArrayLayer = 0,
+                               .layerCount = createInfo.faceCount}};
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                           nullptr, 1, &barrier);
+
+      const lib::Buffer<VkBufferImageCopy> regions =
+          createBufferImageCopyRegions(imageData.copyRegions);
+      vkCmdCopyBufferToImage(commandBuffer,
+                             imageData.stagingBuffer.getVkBuffer(),
+                             images[imageIndex].image,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             static_cast<uint32_t>(regions.size()),
+                             regions.data());
+
+      // Released color attachment images are expected in their attachment layout.
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = 0;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                           0, nullptr, 1, &barrier);
+    }
+    const XrSwapchainImageReleaseInfo releaseInfo = {
+        .type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+    CHECK_XRCMD(xrReleaseSwapchainImage(swapchain, &releaseInfo));
+
+    _skyboxInLayer = true;
+    return swapchain;
+  }
+
+  // Drops the device-local copies of the assets while the app is in the background. The device,
+  // pipelines and swapchains stay, and the asset manager keeps the cooked data in staging memory
+  // for restoreResources to upload again.
+  Status releaseResources() {
+    if (!_resourcesResident) {
+      return StatusOk();
+    }
+    CHECK_VKCMD(vkDeviceWaitIdle(_logicalDevice.getVkDevice()));
+    _textureCubemap = Texture();
+    _vertexBufferCube = Buffer();
+    _indexBufferCube = Buffer();
+    _resourcesResident = false;
+    return StatusOk();
+  }
+
+  // Uploads what releaseResources dropped. Submits to the graphics queue, which the runtime uses
+  // as well in xrEndFrame and the swapchain calls, so it has to run between frames.
+  Status restoreResources() {
+    if (_resourcesResident) {
+      return StatusOk();
+    }
+    RETURN_IF_ERROR(uploadAssets());
+    // A fresh writer over the same set hands out the slots from the first one again, so the
+    // cubemap takes back the slot it had instead of a new one on every resume.
+    _bindlessWriter =
+        std::make_unique<BindlessDescriptorSetWriter>(_bindlessDescriptorSet);
+    _skyboxHandle = _bindlessWriter->storeTexture(_textureCubemap);
+    _resourcesResident = true;
+    return StatusOk();
+  }
+
 private:
   AssetManager _assetManager;
   ShaderProgramManager _programManager;
@@ -90,6 +231,8 @@ private:
   Texture _textureCubemap;
   ShaderProgram _skyboxShaderProgram;
   TextureHandle _skyboxHandle;
+  bool _skyboxInLayer = false;
+  bool _resourcesResident = true;
 
   std::shared_ptr<DescriptorPool> _descriptorPool;
   DescriptorSet _bindlessDescriptorSet;
@@ -114,7 +257,10 @@ private:
         _logicalDevice, "cube.obj", vertexDataCube.indices,
         static_cast<uint8_t>(vertexDataCube.indexType),
         std::span<const glm::vec3>(vertexDataCube.positions));
+    return uploadAssets();
+  }
 
+  Status uploadAssets() {
     {
       SingleTimeCommandBuffer handle(*_singleTimeCommandPool);
       const VkCommandBuffer commandBuffer = handle.getCommandBuffer();
@@ -291,6 +437,20 @@ private:
         vkCmdSetScissor(commandBuffer, 0, 1, &framebuffer.getScissor());
       }
 
+      if (_skyboxInLayer) {
+        // The compositor samples the sky below, only what covers it stays opaque.
+        const VkClearAttachment clearAttachment = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .colorAttachment = 0,
+            .clearValue = {.color = {{0.0f, 0.0f, 0.0f, 0.0f}}}};
+        const VkClearRect clearRect = {.rect = framebuffer.getScissor(),
+                                       .baseArrayLayer = 0,
+                                       .layerCount = 1};
+        vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+        CHECK_VKCMD(vkEndCommandBuffer(commandBuffer));
+        return StatusOk();
+      }
+
       vkCmdBindPipeline(commandBuffer,
                         _graphicsPipelineSkybox->getVkPipelineBindPoint(),
                         _graphicsPipelineSkybox->getVkPipeline());
@@ -0,0 +1,71 @@
+#include "dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+// Share of the display period the GPU may take, above it the scale drops.
+constexpr double kTargetLoad = 0.85;
+// Below this share the scale grows again, the gap keeps it from oscillating.
+constexpr double kRaiseLoad = 0.7;
+constexpr double kMaxRaiseStep = 1.05;
+constexpr double kSmoothing = 0.1;
+constexpr uint32_t kSettleFrames = 8;
+}
+
+DynamicResolutionController::DynamicResolutionController(float min_scale,
+                                                         float max_scale,
+                                                         float initial_scale) :
+    min_scale_(min_scale),
+    max_scale_(max_scale),
+    scale_(std::clamp(initial_scale, min_scale, max_scale)) {
+  if (min_scale <= 0.0f || min_scale > max_scale) {
+    throw std::invalid_argument("resolution scale range is empty");
+  }
+}
+
+float DynamicResolutionController::Update(int64_t gpu_frame_time, int64_t display_period) {
+  if (gpu_frame_time <= 0 || display_period <= 0) {
+    return scale_;
+  }
+  smoothed_gpu_time_ = smoothed_gpu_time_ == 0.0
+                       ? static_cast<double>(gpu_frame_time)
+                       : smoothed_gpu_time_ + kSmoothing * (gpu_frame_time - smoothed_gpu_time_);
+  if (++frames_since_change_ < kSettleFrames) {
+    return scale_;
+  }
+
+  const double kLoad = smoothed_gpu_time_ / static_cast<double>(display_period);
+  double factor = 1.0;
+  if (kLoad > kTargetLoad) {
+    factor = std::sqrt(kTargetLoad / kLoad);
+  } else if (kLoad < kRaiseLoad) {
+    factor = std::min(std::sqrt(kTargetLoad / kLoad), kMaxRaiseStep);
+  }
+  const float kScale = std::clamp(static_cast<float>(scale_ * factor), min_scale_, max_scale_);
+  if (kScale != scale_) {
+    // Expect the cost of the new pixel count until frames rendered with it are measured.
+    smoothed_gpu_time_ *= (kScale * kScale) / (scale_ * scale_);
+    scale_ = kScale;
+    frames_since_change_ = 0;
+  }
+  return scale_;
+}
+
+void DynamicResolutionController::SetMaxScale(float max_scale) {
+  max_scale_ = std::max(max_scale, min_scale_);
+  if (scale_ > max_scale_) {
+    smoothed_gpu_time_ *= (max_scale_ * max_scale_) / (scale_ * scale_);
+    scale_ = max_scale_;
+    frames_since_change_ = 0;
+  }
+}
+
+float DynamicResolutionController::GetScale() const {
+  return scale_;
+}
+
+bool DynamicResolutionController::IsAtMinScale() const {
+  return scale_ <= min_scale_;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Picks the fraction of the allocated eye buffer extent to render at, so the GPU time of a frame
+// stays below a share of the display period. Shading cost follows the pixel count, the square of
+// the scale. Overload is answered at once, spare time is taken back in small steps, and no
+// change follows within a few frames of another as the measurements lag the frames in flight.
+class DynamicResolutionController {
+ private:
+  float min_scale_;
+  float max_scale_;
+  float scale_;
+  double smoothed_gpu_time_ = 0.0;
+  uint32_t frames_since_change_ = 0;
+
+ public:
+  explicit DynamicResolutionController(float min_scale = 0.5f,
+                                       float max_scale = 1.0f,
+                                       float initial_scale = 1.0f);
+
+  // Takes the GPU time of a completed frame and the display period, both in nanoseconds, and
+  // returns the scale for the next frame.
+  float Update(int64_t gpu_frame_time, int64_t display_period);
+
+  // Lowers or restores the upper end of the range, e.g. when the device runs hot. The scale drops
+  // at once when above it.
+  void SetMaxScale(float max_scale);
+
+  [[nodiscard]] float GetScale() const;
+
+  // Whether the scale can drop no further, so more load can only be answered elsewhere.
+  [[nodiscard]] bool IsAtMinScale() const;
+};
@@ -0,0 +1,26 @@
+#include "foveation.hpp"
+
+#include <algorithm>
+
+FoveationLevel SelectFoveationLevel(FoveationLevel requested, FoveationLevel minimum) {
+  return std::max(requested, minimum);
+}
+
+FoveationTiles GetFoveationTiles(FoveationLevel level) {
+  // Shaded fraction of the eye buffer is inset_size^2 + periphery_scale^2: 78%, 55% and 36%.
+  switch (level) {
+    case FoveationLevel::LOW:
+      return {0.65f, 0.6f};
+    case FoveationLevel::MEDIUM:
+      return {0.55f, 0.5f};
+    case FoveationLevel::HIGH:
+      return {0.45f, 0.4f};
+    case FoveationLevel::OFF:
+    default:
+      return {1.0f, 1.0f};
+  }
+}
+
+bool IsFoveated(const FoveationTiles &tiles) {
+  return tiles.inset_size < 1.0f && tiles.periphery_scale < 1.0f;
+}
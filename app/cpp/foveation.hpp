@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// Shared by the runtime density map (XR_FB_foveation) and the renderer's tile fallback, so the
+// level can be changed at runtime whichever of them is active.
+enum class FoveationLevel {
+  OFF,
+  LOW,
+  MEDIUM,
+  HIGH,
+};
+
+// Tile fallback: the centered inset, inset_size of the eye buffer in each dimension, is shaded
+// at full resolution, the periphery at periphery_scale and then upscaled underneath it.
+struct FoveationTiles {
+  float inset_size;
+  float periphery_scale;
+};
+
+// The periphery targets are allocated once at this scale, so no level needs new images.
+constexpr float kMaxFoveationPeripheryScale = 0.6f;
+
+// The level asked for, raised to the minimum the quality settings allow.
+[[nodiscard]] FoveationLevel SelectFoveationLevel(FoveationLevel requested, FoveationLevel minimum);
+
+FoveationTiles GetFoveationTiles(FoveationLevel level);
+
+[[nodiscard]] bool IsFoveated(const FoveationTiles &tiles);
@@ -0,0 +1,378 @@
+#include "mesh_optimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+constexpr size_t kForsythCacheSize = 32;
+constexpr float kForsythCacheDecayPower = 1.5f;
+constexpr float kForsythLastTriangleScore = 0.75f;
+constexpr float kForsythValenceBoostScale = 2.0f;
+constexpr float kForsythValenceBoostPower = 0.5f;
+constexpr size_t kMinOverdrawClusterTriangles = 8;
+
+float ForsythVertexScore(int32_t cache_position, uint32_t remaining_triangles) {
+  if (remaining_triangles == 0) {
+    return -1.0f;
+  }
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      score = kForsythLastTriangleScore;
+    } else {
+      float scaler = 1.0f / (kForsythCacheSize - 3);
+      score = std::pow(1.0f - (cache_position - 3) * scaler, kForsythCacheDecayPower);
+    }
+  }
+  return score + kForsythValenceBoostScale
+      * std::pow(static_cast<float>(remaining_triangles), -kForsythValenceBoostPower);
+}
+
+void CheckIndices(const std::vector<uint32_t> &indices, size_t vertex_count) {
+  if (indices.size() % 3 != 0) {
+    throw std::invalid_argument("index count must be a multiple of 3");
+  }
+  for (uint32_t index: indices) {
+    if (index >= vertex_count) {
+      throw std::out_of_range("index references a missing vertex");
+    }
+  }
+}
+
+glm::vec3 Position(const std::vector<float> &vertices,
+                   size_t stride,
+                   size_t position_offset,
+                   uint32_t vertex) {
+  const float *position = &vertices[vertex * stride + position_offset];
+  return {position[0], position[1], position[2]};
+}
+}
+
+geometry::VertexCacheStatistics geometry::AnalyzeVertexCache(const std::vector<uint32_t> &indices,
+                                                             size_t vertex_count,
+                                                             size_t cache_size) {
+  VertexCacheStatistics statistics{};
+  if (indices.empty() || vertex_count == 0) {
+    return statistics;
+  }
+  std::deque<uint32_t> cache{};
+  size_t misses = 0;
+  for (uint32_t index: indices) {
+    if (std::find(cache.begin(), cache.end(), index) != cache.end()) {
+      continue;
+    }
+    misses++;
+    cache.push_back(index);
+    if (cache.size() > cache_size) {
+      cache.pop_front();
+    }
+  }
+  statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+  statistics.atvr = static_cast<float>(misses) / static_cast<float>(vertex_count);
+  return statistics;
+}
+
+size_t geometry::DeduplicateVertices(std::vector<float> &vertices,
+                                     size_t stride,
+                                     std::vector<uint32_t> &indices) {
+  if (stride == 0 || vertices.size() % stride != 0) {
+    throw std::invalid_argument("vertex data does not match the stride");
+  }
+  const size_t kVertexCount = vertices.size() / stride;
+  CheckIndices(indices, kVertexCount);
+
+  auto hash = [&vertices, stride](uint32_t vertex) {
+    size_t seed = 0;
+    for (size_t i = 0; i < stride; i++) {
+      uint32_t bits = 0;
+      std::memcpy(&bits, &vertices[vertex * stride + i], sizeof(bits));
+      seed ^= bits + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  };
+  auto equal = [&vertices, stride](uint32_t lhs, uint32_t rhs) {
+    return std::memcmp(&vertices[lhs * stride], &vertices[rhs * stride], stride * sizeof(float))
+        == 0;
+  };
+  std::unordered_map<uint32_t, uint32_t, decltype(hash), decltype(equal)>
+      unique_vertices(kVertexCount, hash, equal);
+
+  std::vector<uint32_t> remap(kVertexCount);
+  std::vector<float> deduplicated{};
+  deduplicated.reserve(vertices.size());
+  for (uint32_t vertex = 0; vertex < kVertexCount; vertex++) {
+    auto [it, inserted] = unique_vertices.try_emplace(
+        vertex, static_cast<uint32_t>(deduplicated.size() / stride));
+    if (inserted) {
+      deduplicated.insert(deduplicated.end(),
+                          vertices.begin() + vertex * stride,
+                          vertices.begin() + (vertex + 1) * stride);
+    }
+    remap[vertex] = it->second;
+  }
+  for (auto &index: indices) {
+    index = remap[index];
+  }
+  vertices.swap(deduplicated);
+  return vertices.size() / stride;
+}
+
+void geometry::OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count) {
+  CheckIndices(indices, vertex_count);
+  const size_t kTriangleCount = indices.size() / 3;
+  if (kTriangleCount == 0) {
+    return;
+  }
+
+  std::vector<uint32_t> triangle_offsets(vertex_count + 1, 0);
+  for (uint32_t index: indices) {
+    triangle_offsets[index + 1]++;
+  }
+  std::partial_sum(triangle_offsets.begin(), triangle_offsets.end(), triangle_offsets.begin());
+  std::vector<uint32_t> vertex_triangles(indices.size());
+  std::vector<uint32_t> fill = triangle_offsets;
+  for (size_t i = 0; i < indices.size(); i++) {
+    vertex_triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  std::vector<uint32_t> remaining(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    remaining[v] = triangle_offsets[v + 1] - triangle_offsets[v];
+  }
+  std::vector<int32_t> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    vertex_score[v] = ForsythVertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangle_score(kTriangleCount);
+  for (size_t t = 0; t < kTriangleCount; t++) {
+    triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]]
+        + vertex_score[indices[t * 3 + 2]];
+  }
+  std::vector<bool> emitted(kTriangleCount, false);
+
+  std::vector<uint32_t> optimized{};
+  optimized.reserve(indices.size());
+  std::vector<uint32_t> cache{};
+  std::vector<uint32_t> next_cache{};
+  size_t scan_position = 0;
+  int64_t best_triangle = -1;
+
+  for (size_t emitted_count = 0; emitted_count < kTriangleCount; emitted_count++) {
+    if (best_triangle < 0) {
+      // Nothing in the cache touches a pending triangle, take the best of the rest.
+      float best_score = -std::numeric_limits<float>::max();
+      while (emitted[scan_position]) {
+        scan_position++;
+      }
+      for (size_t t = scan_position; t < kTriangleCount; t++) {
+        if (!emitted[t] && triangle_score[t] > best_score) {
+          best_score = triangle_score[t];
+          best_triangle = static_cast<int64_t>(t);
+        }
+      }
+    }
+
+    const auto kTriangle = static_cast<size_t>(best_triangle);
+    emitted[kTriangle] = true;
+    next_cache.clear();
+    for (size_t i = 0; i < 3; i++) {
+      uint32_t vertex = indices[kTriangle * 3 + i];
+      optimized.push_back(vertex);
+      next_cache.push_back(vertex);
+      remaining[vertex]--;
+      auto begin = vertex_triangles.begin() + triangle_offsets[vertex];
+      auto end = begin + remaining[vertex] + 1;
+      std::iter_swap(std::find(begin, end, static_cast<uint32_t>(kTriangle)), end - 1);
+    }
+    for (uint32_t vertex: cache) {
+      if (std::find(next_cache.begin(), next_cache.end(), vertex) == next_cache.end()) {
+        next_cache.push_back(vertex);
+      }
+    }
+    for (size_t i = kForsythCacheSize; i < next_cache.size(); i++) {
+      cache_position[next_cache[i]] = -1;
+      vertex_score[next_cache[i]] = ForsythVertexScore(-1, remaining[next_cache[i]]);
+    }
+    next_cache.resize(std::min(next_cache.size(), kForsythCacheSize));
+    cache.swap(next_cache);
+
+    for (size_t i = 0; i < cache.size(); i++) {
+      cache_position[cache[i]] = static_cast<int32_t>(i);
+      vertex_score[cache[i]] = ForsythVertexScore(static_cast<int32_t>(i), remaining[cache[i]]);
+    }
+
+    best_triangle = -1;
+    float best_score = -std::numeric_limits<float>::max();
+    for (uint32_t vertex: cache) {
+      for (uint32_t i = 0; i < remaining[vertex]; i++) {
+        uint32_t t = vertex_triangles[triangle_offsets[vertex] + i];
+        triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]]
+            + vertex_score[indices[t * 3 + 2]];
+        if (triangle_score[t] > best_score) {
+          best_score = triangle_score[t];
+          best_triangle = t;
+        }
+      }
+    }
+  }
+  indices.swap(optimized);
+}
+
+void geometry::OptimizeOverdraw(std::vector<uint32_t> &indices,
+                                const std::vector<float> &vertices,
+                                size_t stride,
+                                size_t position_offset,
+                                float threshold) {
+  const size_t kVertexCount = vertices.size() / stride;
+  CheckIndices(indices, kVertexCount);
+  const size_t kTriangleCount = indices.size() / 3;
+  if (kTriangleCount < kMinOverdrawClusterTriangles * 2) {
+    return;
+  }
+
+  // A triangle missing the cache with all three vertices starts a new strip-like run, which is
+  // where clusters can be reordered without hurting the cache much.
+  std::vector<size_t> cluster_starts{0};
+  std::deque<uint32_t> cache{};
+  for (size_t t = 0; t < kTriangleCount; t++) {
+    size_t misses = 0;
+    for (size_t i = 0; i < 3; i++) {
+      uint32_t vertex = indices[t * 3 + i];
+      if (std::find(cache.begin(), cache.end(), vertex) == cache.end()) {
+        misses++;
+        cache.push_back(vertex);
+        if (cache.size() > kVertexCacheSize) {
+          cache.pop_front();
+        }
+      }
+    }
+    if (misses == 3 && t - cluster_starts.back() >= kMinOverdrawClusterTriangles) {
+      cluster_starts.push_back(t);
+    }
+  }
+  if (cluster_starts.size() < 2) {
+    return;
+  }
+  cluster_starts.push_back(kTriangleCount);
+
+  glm::vec3 mesh_centroid(0.0f);
+  float mesh_area = 0.0f;
+  std::vector<float> cluster_sort_keys(cluster_starts.size() - 1);
+  std::vector<glm::vec3> cluster_centroids(cluster_sort_keys.size(), glm::vec3(0.0f));
+  std::vector<glm::vec3> cluster_normals(cluster_sort_keys.size(), glm::vec3(0.0f));
+  for (size_t c = 0; c + 1 < cluster_starts.size(); c++) {
+    float cluster_area = 0.0f;
+    for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+      glm::vec3 p0 = Position(vertices, stride, position_offset, indices[t * 3]);
+      glm::vec3 p1 = Position(vertices, stride, position_offset, indices[t * 3 + 1]);
+      glm::vec3 p2 = Position(vertices, stride, position_offset, indices[t * 3 + 2]);
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(normal);
+      glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+      cluster_centroids[c] += centroid * area;
+      cluster_normals[c] += normal;
+      cluster_area += area;
+      mesh_centroid += centroid * area;
+      mesh_area += area;
+    }
+    if (cluster_area > 0.0f) {
+      cluster_centroids[c] /= cluster_area;
+    }
+  }
+  if (mesh_area > 0.0f) {
+    mesh_centroid /= mesh_area;
+  }
+  for (size_t c = 0; c < cluster_sort_keys.size(); c++) {
+    float normal_length = glm::length(cluster_normals[c]);
+    glm::vec3 normal = normal_length > 0.0f ? cluster_normals[c] / normal_length : glm::vec3(0.0f);
+    cluster_sort_keys[c] = glm::dot(cluster_centroids[c] - mesh_centroid, normal);
+  }
+
+  std::vector<size_t> cluster_order(cluster_sort_keys.size());
+  std::iota(cluster_order.begin(), cluster_order.end(), 0);
+  std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](size_t lhs, size_t rhs) {
+    return cluster_sort_keys[lhs] > cluster_sort_keys[rhs];
+  });
+
+  std::vector<uint32_t> reordered{};
+  reordered.reserve(indices.size());
+  for (size_t c: cluster_order) {
+    reordered.insert(reordered.end(),
+                     indices.begin() + cluster_starts[c] * 3,
+                     indices.begin() + cluster_starts[c + 1] * 3);
+  }
+
+  float acmr = AnalyzeVertexCache(indices, kVertexCount).acmr;
+  float reordered_acmr = AnalyzeVertexCache(reordered, kVertexCount).acmr;
+  if (reordered_acmr <= acmr * threshold) {
+    indices.swap(reordered);
+  }
+}
+
+void geometry::OptimizeVertexFetch(std::vector<float> &vertices,
+                                   size_t stride,
+                                   std::vector<uint32_t> &indices) {
+  const size_t kVertexCount = vertices.size() / stride;
+  CheckIndices(indices, kVertexCount);
+  constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> remap(kVertexCount, kUnused);
+  std::vector<float> reordered{};
+  reordered.reserve(vertices.size());
+  for (auto &index: indices) {
+    if (remap[index] == kUnused) {
+      remap[index] = static_cast<uint32_t>(reordered.size() / stride);
+      reordered.insert(reordered.end(),
+                       vertices.begin() + index * stride,
+                       vertices.begin() + (index + 1) * stride);
+    }
+    index = remap[index];
+  }
+  vertices.swap(reordered);
+}
+
+bool geometry::FitsUint16Indices(size_t vertex_count) {
+  return vertex_count <= std::numeric_limits<uint16_t>::max() + size_t{1};
+}
+
+std::vector<uint16_t> geometry::ToUint16Indices(const std::vector<uint32_t> &indices) {
+  std::vector<uint16_t> narrowed{};
+  narrowed.reserve(indices.size());
+  for (uint32_t index: indices) {
+    if (index > std::numeric_limits<uint16_t>::max()) {
+      throw std::out_of_range("index does not fit into 16 bits");
+    }
+    narrowed.push_back(static_cast<uint16_t>(index));
+  }
+  return narrowed;
+}
+
+geometry::MeshOptimizationReport geometry::OptimizeMesh(std::vector<float> &vertices,
+                                                        size_t stride,
+                                                        size_t position_offset,
+                                                        std::vector<uint32_t> &indices) {
+  if (position_offset + 3 > stride) {
+    throw std::invalid_argument("position attribute does not fit into the vertex");
+  }
+  MeshOptimizationReport report{};
+  report.vertex_count_before = vertices.size() / stride;
+  report.before = AnalyzeVertexCache(indices, report.vertex_count_before);
+
+  size_t vertex_count = DeduplicateVertices(vertices, stride, indices);
+  OptimizeVertexCache(indices, vertex_count);
+  OptimizeOverdraw(indices, vertices, stride, position_offset);
+  OptimizeVertexFetch(vertices, stride, indices);
+
+  report.vertex_count_after = vertices.size() / stride;
+  report.after = AnalyzeVertexCache(indices, report.vertex_count_after);
+  report.fits_uint16_indices = FitsUint16Indices(report.vertex_count_after);
+  return report;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace geometry {
+// FIFO size used when reporting statistics, close to the post-transform cache of mobile GPUs.
+constexpr size_t kVertexCacheSize = 16;
+// Overdraw ordering is rejected when it makes ACMR worse than this factor.
+constexpr float kOverdrawCacheThreshold = 1.05f;
+
+struct VertexCacheStatistics {
+  // Average cache miss ratio: transformed vertices per triangle, 0.5 is ideal for a grid.
+  float acmr;
+  // Average transformed vertex ratio: transformed vertices per unique vertex, 1.0 is ideal.
+  float atvr;
+};
+
+struct MeshOptimizationReport {
+  VertexCacheStatistics before;
+  VertexCacheStatistics after;
+  size_t vertex_count_before;
+  size_t vertex_count_after;
+  bool fits_uint16_indices;
+};
+
+// Vertices are tightly packed float attributes, stride floats per vertex.
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t> &indices,
+                                         size_t vertex_count,
+                                         size_t cache_size = kVertexCacheSize);
+
+// Merges bitwise identical vertices and returns the new vertex count.
+size_t DeduplicateVertices(std::vector<float> &vertices,
+                           size_t stride,
+                           std::vector<uint32_t> &indices);
+
+// Reorders triangles for the post-transform cache using Forsyth's linear-speed algorithm.
+void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count);
+
+// Reorders cache friendly triangle clusters so outward facing ones are drawn first, which
+// lets early depth testing reject more of the rest. Expects a cache optimized index buffer.
+void OptimizeOverdraw(std::vector<uint32_t> &indices,
+                      const std::vector<float> &vertices,
+                      size_t stride,
+                      size_t position_offset,
+                      float threshold = kOverdrawCacheThreshold);
+
+// Reorders vertices in the order the index buffer first references them.
+void OptimizeVertexFetch(std::vector<float> &vertices,
+                         size_t stride,
+                         std::vector<uint32_t> &indices);
+
+[[nodiscard]] bool FitsUint16Indices(size_t vertex_count);
+
+std::vector<uint16_t> ToUint16Indices(const std::vector<uint32_t> &indices);
+
+// Runs deduplication, vertex cache, overdraw and vertex fetch optimization in that order.
+MeshOptimizationReport OptimizeMesh(std::vector<float> &vertices,
+                                    size_t stride,
+                                    size_t position_offset,
+                                    std::vector<uint32_t> &indices);
+}
@@ -0,0 +1,254 @@
+#include "mesh_simplifier.hpp"
+
+#include "mesh_optimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// Lower progress than this between two LODs ends the chain.
+constexpr float kMinLodProgress = 0.9f;
+
+struct Quadric {
+  double a2 = 0, ab = 0, ac = 0, ad = 0;
+  double b2 = 0, bc = 0, bd = 0;
+  double c2 = 0, cd = 0;
+  double d2 = 0;
+
+  static Quadric FromPlane(const glm::vec3 &normal, float distance) {
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    return {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+  }
+
+  Quadric &operator+=(const Quadric &other) {
+    a2 += other.a2, ab += other.ab, ac += other.ac, ad += other.ad;
+    b2 += other.b2, bc += other.bc, bd += other.bd;
+    c2 += other.c2, cd += other.cd;
+    d2 += other.d2;
+    return *this;
+  }
+
+  [[nodiscard]] double Evaluate(const glm::vec3 &p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+        + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+        + c2 * z * z + 2 * cd * z
+        + d2;
+    return std::max(error, 0.0);
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+glm::vec3 TriangleNormal(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) {
+  return glm::cross(p1 - p0, p2 - p0);
+}
+
+bool FlipsTriangles(uint32_t from,
+                    uint32_t to,
+                    const std::vector<uint32_t> &indices,
+                    const std::vector<uint32_t> &vertex_triangles,
+                    const std::vector<uint32_t> &triangle_offsets,
+                    const std::vector<glm::vec3> &positions) {
+  for (uint32_t i = triangle_offsets[from]; i < triangle_offsets[from + 1]; i++) {
+    const uint32_t *triangle = &indices[vertex_triangles[i] * 3];
+    if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+      continue;  // Removed by the collapse.
+    }
+    glm::vec3 before[3];
+    glm::vec3 after[3];
+    for (size_t k = 0; k < 3; k++) {
+      before[k] = positions[triangle[k]];
+      after[k] = triangle[k] == from ? positions[to] : positions[triangle[k]];
+    }
+    glm::vec3 normal_before = TriangleNormal(before[0], before[1], before[2]);
+    glm::vec3 normal_after = TriangleNormal(after[0], after[1], after[2]);
+    if (glm::dot(normal_before, normal_after) <= 0.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+}
+
+std::vector<uint32_t> geometry::SimplifyMesh(const std::vector<uint32_t> &indices,
+                                             const std::vector<float> &vertices,
+                                             size_t stride,
+                                             size_t position_offset,
+                                             size_t target_index_count,
+                                             float max_error,
+                                             float *result_error) {
+  if (indices.size() % 3 != 0 || position_offset + 3 > stride) {
+    throw std::invalid_argument("invalid mesh for simplification");
+  }
+  const size_t kVertexCount = vertices.size() / stride;
+  std::vector<glm::vec3> positions(kVertexCount);
+  for (size_t v = 0; v < kVertexCount; v++) {
+    const float *position = &vertices[v * stride + position_offset];
+    positions[v] = {position[0], position[1], position[2]};
+  }
+
+  std::vector<Quadric> quadrics(kVertexCount);
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t> edge_use{};
+  for (size_t t = 0; t < indices.size(); t += 3) {
+    glm::vec3 normal = TriangleNormal(positions[indices[t]],
+                                      positions[indices[t + 1]],
+                                      positions[indices[t + 2]]);
+    float length = glm::length(normal);
+    if (length > 0.0f) {
+      normal /= length;
+      Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, positions[indices[t]]));
+      for (size_t k = 0; k < 3; k++) {
+        quadrics[indices[t + k]] += plane;
+      }
+    }
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t a = indices[t + k];
+      uint32_t b = indices[t + (k + 1) % 3];
+      edge_use[std::minmax(a, b)]++;
+    }
+  }
+  std::vector<bool> locked(kVertexCount, false);
+  for (const auto &[edge, count]: edge_use) {
+    if (count == 1) {
+      locked[edge.first] = true;
+      locked[edge.second] = true;
+    }
+  }
+
+  const double kMaxCost = static_cast<double>(max_error) * max_error;
+  double worst_cost = 0.0;
+  std::vector<uint32_t> result = indices;
+  while (result.size() > target_index_count) {
+    std::vector<uint32_t> triangle_offsets(kVertexCount + 1, 0);
+    for (uint32_t index: result) {
+      triangle_offsets[index + 1]++;
+    }
+    std::partial_sum(triangle_offsets.begin(), triangle_offsets.end(), triangle_offsets.begin());
+    std::vector<uint32_t> vertex_triangles(result.size());
+    std::vector<uint32_t> fill = triangle_offsets;
+    for (size_t i = 0; i < result.size(); i++) {
+      vertex_triangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<Collapse> collapses{};
+    for (size_t t = 0; t < result.size(); t += 3) {
+      for (size_t k = 0; k < 3; k++) {
+        uint32_t a = result[t + k];
+        uint32_t b = result[t + (k + 1) % 3];
+        for (auto [from, to]: {std::pair{a, b}, std::pair{b, a}}) {
+          if (locked[from]) {
+            continue;
+          }
+          Quadric quadric = quadrics[from];
+          quadric += quadrics[to];
+          collapses.push_back({from, to, quadric.Evaluate(positions[to])});
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse &lhs, const Collapse &rhs) {
+      return lhs.cost < rhs.cost;
+    });
+
+    std::vector<uint32_t> remap(kVertexCount);
+    std::iota(remap.begin(), remap.end(), 0);
+    std::vector<bool> touched(kVertexCount, false);
+    size_t index_count = result.size();
+    size_t collapsed = 0;
+    for (const auto &collapse: collapses) {
+      if (index_count <= target_index_count || collapse.cost > kMaxCost) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to]) {
+        continue;
+      }
+      if (FlipsTriangles(collapse.from, collapse.to, result, vertex_triangles, triangle_offsets,
+                         positions)) {
+        continue;
+      }
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      touched[collapse.from] = true;
+      touched[collapse.to] = true;
+      worst_cost = std::max(worst_cost, collapse.cost);
+      collapsed++;
+      // An interior edge is shared by two triangles, both of which become degenerate.
+      index_count -= std::min<size_t>(index_count, 6);
+    }
+    if (collapsed == 0) {
+      break;
+    }
+
+    std::vector<uint32_t> simplified{};
+    simplified.reserve(result.size());
+    for (size_t t = 0; t < result.size(); t += 3) {
+      uint32_t a = remap[result[t]];
+      uint32_t b = remap[result[t + 1]];
+      uint32_t c = remap[result[t + 2]];
+      if (a != b && b != c && a != c) {
+        simplified.insert(simplified.end(), {a, b, c});
+      }
+    }
+    result.swap(simplified);
+  }
+
+  if (result_error != nullptr) {
+    *result_error = static_cast<float>(std::sqrt(worst_cost));
+  }
+  return result;
+}
+
+std::vector<geometry::MeshLod> geometry::BuildLodChain(const std::vector<float> &vertices,
+                                                       size_t stride,
+                                                       size_t position_offset,
+                                                       const std::vector<uint32_t> &indices,
+                                                       size_t max_lod_count) {
+  std::vector<MeshLod> lods{};
+  lods.push_back({indices, 0.0f});
+  if (vertices.empty()) {
+    return lods;
+  }
+
+  glm::vec3 min(std::numeric_limits<float>::max());
+  glm::vec3 max(-std::numeric_limits<float>::max());
+  for (size_t v = 0; v < vertices.size(); v += stride) {
+    glm::vec3 position(vertices[v + position_offset],
+                       vertices[v + position_offset + 1],
+                       vertices[v + position_offset + 2]);
+    min = glm::min(min, position);
+    max = glm::max(max, position);
+  }
+  const float kMaxError = glm::length(max - min) * kMaxLodRelativeError;
+  const size_t kVertexCount = vertices.size() / stride;
+
+  while (lods.size() < max_lod_count) {
+    const MeshLod &previous = lods.back();
+    size_t target = static_cast<size_t>(previous.indices.size() / 3 * kLodReduction) * 3;
+    float error = 0.0f;
+    std::vector<uint32_t> simplified = SimplifyMesh(previous.indices,
+                                                    vertices,
+                                                    stride,
+                                                    position_offset,
+                                                    target,
+                                                    kMaxError - previous.error,
+                                                    &error);
+    if (simplified.empty()
+        || simplified.size() > previous.indices.size() * kMinLodProgress) {
+      break;
+    }
+    OptimizeVertexCache(simplified, kVertexCount);
+    lods.push_back({std::move(simplified), previous.error + error});
+  }
+  return lods;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace geometry {
+constexpr size_t kMaxLodCount = 4;
+constexpr float kLodReduction = 0.5f;
+// Largest simplification error accepted for a LOD, relative to the mesh bounding box diagonal.
+constexpr float kMaxLodRelativeError = 0.05f;
+
+struct MeshLod {
+  std::vector<uint32_t> indices{};
+  // Object space distance by which the LOD may deviate from the full resolution surface.
+  float error;
+};
+
+// Collapses edges in quadric error order until the index count drops to target_index_count or
+// the next collapse would exceed max_error. Only the index buffer changes, so every LOD of a mesh
+// can share its vertex buffer. Vertices on open borders are never moved.
+std::vector<uint32_t> SimplifyMesh(const std::vector<uint32_t> &indices,
+                                   const std::vector<float> &vertices,
+                                   size_t stride,
+                                   size_t position_offset,
+                                   size_t target_index_count,
+                                   float max_error,
+                                   float *result_error = nullptr);
+
+// LOD 0 is the input mesh. Each further LOD aims for kLodReduction of the previous triangle
+// count and the chain stops early once simplification stops making progress.
+std::vector<MeshLod> BuildLodChain(const std::vector<float> &vertices,
+                                   size_t stride,
+                                   size_t position_offset,
+                                   const std::vector<uint32_t> &indices,
+                                   size_t max_lod_count = kMaxLodCount);
+}
@@ -0,0 +1,185 @@
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+constexpr float kDegenerateConeThreshold = 0.1f;
+
+glm::vec3 TriangleNormal(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) {
+  glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+  float area = glm::length(normal);
+  return area == 0.0f ? glm::vec3(0.0f) : normal / area;
+}
+}
+
+geometry::MeshletMesh geometry::BuildMeshlets(const std::vector<uint32_t> &indices,
+                                              const std::vector<glm::vec3> &positions,
+                                              size_t max_vertices,
+                                              size_t max_triangles) {
+  if (indices.size() % 3 != 0) {
+    throw std::invalid_argument("index count must be a multiple of 3");
+  }
+  if (max_vertices < 3 || max_vertices > 256 || max_triangles == 0) {
+    throw std::invalid_argument("unsupported meshlet limits");
+  }
+
+  MeshletMesh mesh{};
+  std::vector<int32_t> local_index(positions.size(), -1);
+  Meshlet current{};
+
+  auto flush = [&]() {
+    if (current.triangle_count == 0) {
+      return;
+    }
+    for (uint32_t i = 0; i < current.vertex_count; i++) {
+      local_index[mesh.vertices[current.vertex_offset + i]] = -1;
+    }
+    mesh.meshlets.push_back(current);
+    current = Meshlet{
+        .vertex_offset = static_cast<uint32_t>(mesh.vertices.size()),
+        .triangle_offset = static_cast<uint32_t>(mesh.triangles.size()),
+        .vertex_count = 0,
+        .triangle_count = 0,
+    };
+  };
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const uint32_t kA = indices[i];
+    const uint32_t kB = indices[i + 1];
+    const uint32_t kC = indices[i + 2];
+    if (kA >= positions.size() || kB >= positions.size() || kC >= positions.size()) {
+      throw std::out_of_range("index references a missing vertex");
+    }
+
+    uint32_t new_vertices = (local_index[kA] < 0) + (local_index[kB] < 0) + (local_index[kC] < 0);
+    if (current.vertex_count + new_vertices > max_vertices
+        || current.triangle_count + 1 > max_triangles) {
+      flush();
+    }
+
+    for (uint32_t vertex: {kA, kB, kC}) {
+      if (local_index[vertex] < 0) {
+        local_index[vertex] = static_cast<int32_t>(current.vertex_count++);
+        mesh.vertices.push_back(vertex);
+      }
+      mesh.triangles.push_back(static_cast<uint8_t>(local_index[vertex]));
+    }
+    current.triangle_count++;
+  }
+  flush();
+
+  mesh.bounds.reserve(mesh.meshlets.size());
+  for (const auto &meshlet: mesh.meshlets) {
+    mesh.bounds.push_back(ComputeMeshletBounds(mesh, meshlet, positions));
+  }
+  return mesh;
+}
+
+geometry::MeshletMesh geometry::BuildMeshletLods(
+    const std::vector<std::vector<uint32_t>> &lod_indices,
+    const std::vector<glm::vec3> &positions,
+    std::vector<MeshletLodRange> &lod_ranges) {
+  MeshletMesh mesh{};
+  lod_ranges.clear();
+  for (const auto &indices: lod_indices) {
+    MeshletMesh lod = BuildMeshlets(indices, positions);
+    lod_ranges.push_back({
+        .first_meshlet = static_cast<uint32_t>(mesh.meshlets.size()),
+        .meshlet_count = static_cast<uint32_t>(lod.meshlets.size()),
+    });
+    const auto kVertexOffset = static_cast<uint32_t>(mesh.vertices.size());
+    const auto kTriangleOffset = static_cast<uint32_t>(mesh.triangles.size());
+    for (auto meshlet: lod.meshlets) {
+      meshlet.vertex_offset += kVertexOffset;
+      meshlet.triangle_offset += kTriangleOffset;
+      mesh.meshlets.push_back(meshlet);
+    }
+    mesh.bounds.insert(mesh.bounds.end(), lod.bounds.begin(), lod.bounds.end());
+    mesh.vertices.insert(mesh.vertices.end(), lod.vertices.begin(), lod.vertices.end());
+    mesh.triangles.insert(mesh.triangles.end(), lod.triangles.begin(), lod.triangles.end());
+  }
+  return mesh;
+}
+
+geometry::MeshletBounds geometry::ComputeMeshletBounds(const MeshletMesh &mesh,
+                                                       const Meshlet &meshlet,
+                                                       const std::vector<glm::vec3> &positions) {
+  MeshletBounds bounds{};
+
+  glm::vec3 min = positions[mesh.vertices[meshlet.vertex_offset]];
+  glm::vec3 max = min;
+  for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+    const glm::vec3 &position = positions[mesh.vertices[meshlet.vertex_offset + i]];
+    min = glm::min(min, position);
+    max = glm::max(max, position);
+  }
+  bounds.center = (min + max) * 0.5f;
+  for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+    const glm::vec3 &position = positions[mesh.vertices[meshlet.vertex_offset + i]];
+    bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, position));
+  }
+
+  std::vector<glm::vec3> normals(meshlet.triangle_count);
+  glm::vec3 normal_sum(0.0f);
+  for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+    const uint8_t *triangle = &mesh.triangles[meshlet.triangle_offset + t * 3];
+    const glm::vec3 &p0 = positions[mesh.vertices[meshlet.vertex_offset + triangle[0]]];
+    const glm::vec3 &p1 = positions[mesh.vertices[meshlet.vertex_offset + triangle[1]]];
+    const glm::vec3 &p2 = positions[mesh.vertices[meshlet.vertex_offset + triangle[2]]];
+    normals[t] = TriangleNormal(p0, p1, p2);
+    normal_sum += normals[t];
+  }
+
+  // A cone that can never be backfacing: the shader test always fails for cutoff 1.
+  bounds.cone_cutoff = 1.0f;
+  float axis_length = glm::length(normal_sum);
+  if (axis_length == 0.0f) {
+    return bounds;
+  }
+  glm::vec3 axis = normal_sum / axis_length;
+
+  float min_dot = 1.0f;
+  for (const auto &normal: normals) {
+    min_dot = std::min(min_dot, glm::dot(normal, axis));
+  }
+  if (min_dot <= kDegenerateConeThreshold) {
+    return bounds;
+  }
+
+  // Move the apex back along the axis until every triangle plane is in front of it.
+  float max_t = 0.0f;
+  for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+    const uint8_t *triangle = &mesh.triangles[meshlet.triangle_offset + t * 3];
+    const glm::vec3 &p0 = positions[mesh.vertices[meshlet.vertex_offset + triangle[0]]];
+    float dc = glm::dot(bounds.center - p0, normals[t]);
+    float dn = glm::dot(axis, normals[t]);
+    max_t = std::max(max_t, dc / dn);
+  }
+
+  bounds.cone_axis = axis;
+  bounds.cone_apex = bounds.center - axis * max_t;
+  // The normal cone spans acos(min_dot); widening it by 90 degrees gives sin(acos(min_dot)).
+  bounds.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+  return bounds;
+}
+
+std::vector<uint32_t> geometry::FlattenMeshletIndices(const MeshletMesh &mesh,
+                                                      std::vector<MeshletDrawRange> &draw_ranges) {
+  std::vector<uint32_t> indices{};
+  indices.reserve(mesh.triangles.size());
+  draw_ranges.clear();
+  draw_ranges.reserve(mesh.meshlets.size());
+  for (const auto &meshlet: mesh.meshlets) {
+    draw_ranges.push_back({
+        .first_index = static_cast<uint32_t>(indices.size()),
+        .index_count = meshlet.triangle_count * 3,
+    });
+    for (uint32_t i = 0; i < meshlet.triangle_count * 3; i++) {
+      uint8_t local = mesh.triangles[meshlet.triangle_offset + i];
+      indices.push_back(mesh.vertices[meshlet.vertex_offset + local]);
+    }
+  }
+  return indices;
+}
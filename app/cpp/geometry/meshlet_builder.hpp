@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace geometry {
+constexpr size_t kMaxMeshletVertices = 64;
+constexpr size_t kMaxMeshletTriangles = 124;
+
+struct Meshlet {
+  uint32_t vertex_offset;
+  uint32_t triangle_offset;
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+};
+
+// Laid out to match the std430 struct read by meshlet_cull.glsl.
+struct MeshletBounds {
+  glm::vec3 center;
+  float radius;
+  glm::vec3 cone_apex;
+  float padding;
+  glm::vec3 cone_axis;
+  // The meshlet is backfacing when
+  // dot(normalize(cone_apex - camera_position), cone_axis) >= cone_cutoff.
+  float cone_cutoff;
+};
+
+struct MeshletMesh {
+  std::vector<Meshlet> meshlets{};
+  std::vector<MeshletBounds> bounds{};
+  // Indices into the source vertex buffer, meshlet.vertex_count entries per meshlet.
+  std::vector<uint32_t> vertices{};
+  // Meshlet local vertex indices, 3 per triangle.
+  std::vector<uint8_t> triangles{};
+};
+
+// Range of the flattened index buffer drawn for a single meshlet.
+struct MeshletDrawRange {
+  uint32_t first_index;
+  uint32_t index_count;
+};
+
+// Meshlets of one LOD inside a MeshletMesh holding a whole LOD chain.
+struct MeshletLodRange {
+  uint32_t first_meshlet;
+  uint32_t meshlet_count;
+};
+
+MeshletMesh BuildMeshlets(const std::vector<uint32_t> &indices,
+                          const std::vector<glm::vec3> &positions,
+                          size_t max_vertices = kMaxMeshletVertices,
+                          size_t max_triangles = kMaxMeshletTriangles);
+
+// Builds the meshlets of every LOD index buffer into one mesh, LOD by LOD.
+MeshletMesh BuildMeshletLods(const std::vector<std::vector<uint32_t>> &lod_indices,
+                             const std::vector<glm::vec3> &positions,
+                             std::vector<MeshletLodRange> &lod_ranges);
+
+MeshletBounds ComputeMeshletBounds(const MeshletMesh &mesh,
+                                   const Meshlet &meshlet,
+                                   const std::vector<glm::vec3> &positions);
+
+// Expands meshlets back into a regular triangle list grouped by meshlet so every
+// meshlet can be drawn with a plain vertex shader through vkCmdDrawIndexedIndirect.
+std::vector<uint32_t> FlattenMeshletIndices(const MeshletMesh &mesh,
+                                            std::vector<MeshletDrawRange> &draw_ranges);
+}
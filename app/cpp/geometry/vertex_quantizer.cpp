@@ -0,0 +1,188 @@
+#include "vertex_quantizer.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr size_t kPositionSize = 4 * sizeof(uint16_t);
+constexpr size_t kNormalSize = 2 * sizeof(int16_t);
+constexpr size_t kUvSize = 2 * sizeof(uint16_t);
+constexpr size_t kColorSize = 4 * sizeof(uint8_t);
+
+uint16_t QuantizeUnorm16(float value) {
+  return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+int16_t QuantizeSnorm16(float value) {
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint8_t QuantizeUnorm8(float value) {
+  return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+size_t Append(size_t &stride, size_t source_offset, size_t size) {
+  if (source_offset == geometry::kNoVertexAttribute) {
+    return geometry::kNoVertexAttribute;
+  }
+  size_t offset = stride;
+  stride += size;
+  return offset;
+}
+}
+
+geometry::QuantizedMesh geometry::QuantizeVertices(const std::vector<float> &vertices,
+                                                   size_t stride,
+                                                   const VertexAttributeOffsets &offsets) {
+  if (offsets.position == kNoVertexAttribute || offsets.position + 3 > stride
+      || (offsets.normal != kNoVertexAttribute && offsets.normal + 3 > stride)
+      || (offsets.uv != kNoVertexAttribute && offsets.uv + 2 > stride)
+      || (offsets.color != kNoVertexAttribute
+          && (offsets.color_components < 3 || offsets.color_components > 4
+              || offsets.color + offsets.color_components > stride))) {
+    throw std::invalid_argument("invalid vertex layout for quantization");
+  }
+  const size_t kVertexCount = vertices.size() / stride;
+
+  glm::vec3 min(std::numeric_limits<float>::max());
+  glm::vec3 max(-std::numeric_limits<float>::max());
+  for (size_t v = 0; v < kVertexCount; v++) {
+    const float *position = &vertices[v * stride + offsets.position];
+    min = glm::min(min, glm::vec3(position[0], position[1], position[2]));
+    max = glm::max(max, glm::vec3(position[0], position[1], position[2]));
+  }
+  float extent = kVertexCount == 0 ? 0.0f : std::max({max.x - min.x, max.y - min.y, max.z - min.z});
+  float scale = extent > 0.0f ? extent : 1.0f;
+  if (kVertexCount == 0) {
+    min = glm::vec3(0.0f);
+  }
+
+  QuantizedMesh mesh{};
+  mesh.offsets.position = Append(mesh.stride, offsets.position, kPositionSize);
+  mesh.offsets.normal = Append(mesh.stride, offsets.normal, kNormalSize);
+  mesh.offsets.uv = Append(mesh.stride, offsets.uv, kUvSize);
+  mesh.offsets.color = Append(mesh.stride, offsets.color, kColorSize);
+  mesh.offsets.color_components = 4;
+  mesh.dequantization = glm::scale(glm::translate(glm::mat4(1.0f), min), glm::vec3(scale));
+  mesh.vertices.resize(kVertexCount * mesh.stride);
+
+  for (size_t v = 0; v < kVertexCount; v++) {
+    const float *source = &vertices[v * stride];
+    uint8_t *destination = &mesh.vertices[v * mesh.stride];
+
+    const float *p = source + offsets.position;
+    uint16_t position[4] = {
+        QuantizeUnorm16((p[0] - min.x) / scale),
+        QuantizeUnorm16((p[1] - min.y) / scale),
+        QuantizeUnorm16((p[2] - min.z) / scale),
+        QuantizeUnorm16(1.0f),
+    };
+    std::memcpy(destination + mesh.offsets.position, position, kPositionSize);
+
+    if (offsets.normal != kNoVertexAttribute) {
+      const float *n = source + offsets.normal;
+      glm::vec2 octahedral = EncodeOctahedral(glm::vec3(n[0], n[1], n[2]));
+      int16_t normal[2] = {QuantizeSnorm16(octahedral.x), QuantizeSnorm16(octahedral.y)};
+      std::memcpy(destination + mesh.offsets.normal, normal, kNormalSize);
+    }
+    if (offsets.uv != kNoVertexAttribute) {
+      const float *t = source + offsets.uv;
+      uint16_t uv[2] = {FloatToHalf(t[0]), FloatToHalf(t[1])};
+      std::memcpy(destination + mesh.offsets.uv, uv, kUvSize);
+    }
+    if (offsets.color != kNoVertexAttribute) {
+      const float *c = source + offsets.color;
+      uint8_t color[4] = {QuantizeUnorm8(c[0]), QuantizeUnorm8(c[1]), QuantizeUnorm8(c[2]),
+                          QuantizeUnorm8(offsets.color_components == 4 ? c[3] : 1.0f)};
+      std::memcpy(destination + mesh.offsets.color, color, kColorSize);
+    }
+  }
+  return mesh;
+}
+
+std::vector<glm::vec3> geometry::DecodeQuantizedPositions(const QuantizedMesh &mesh) {
+  std::vector<glm::vec3> positions(mesh.stride == 0 ? 0 : mesh.vertices.size() / mesh.stride);
+  for (size_t v = 0; v < positions.size(); v++) {
+    uint16_t position[4];
+    std::memcpy(position, &mesh.vertices[v * mesh.stride + mesh.offsets.position], kPositionSize);
+    positions[v] = glm::vec3(position[0], position[1], position[2]) / 65535.0f;
+  }
+  return positions;
+}
+
+std::vector<uint8_t> geometry::ExtractVertexStream(const void *vertices,
+                                                   size_t vertex_count,
+                                                   size_t stride,
+                                                   size_t offset,
+                                                   size_t size) {
+  if (offset + size > stride) {
+    throw std::invalid_argument("vertex stream exceeds the vertex stride");
+  }
+  const auto *source = static_cast<const uint8_t *>(vertices);
+  std::vector<uint8_t> stream(vertex_count * size);
+  for (size_t v = 0; v < vertex_count; v++) {
+    std::memcpy(&stream[v * size], source + v * stride + offset, size);
+  }
+  return stream;
+}
+
+glm::vec2 geometry::EncodeOctahedral(const glm::vec3 &normal) {
+  float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (length == 0.0f) {
+    return glm::vec2(0.0f);
+  }
+  glm::vec2 encoded(normal.x / length, normal.y / length);
+  if (normal.z < 0.0f) {
+    encoded = glm::vec2((1.0f - std::abs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f),
+                        (1.0f - std::abs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f));
+  }
+  return encoded;
+}
+
+glm::vec3 geometry::DecodeOctahedral(const glm::vec2 &encoded) {
+  glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+  float fold = std::max(-normal.z, 0.0f);
+  normal.x += normal.x >= 0.0f ? -fold : fold;
+  normal.y += normal.y >= 0.0f ? -fold : fold;
+  return glm::normalize(normal);
+}
+
+uint16_t geometry::FloatToHalf(float value) {
+  uint32_t bits = std::bit_cast<uint32_t>(value);
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  uint32_t magnitude = bits & 0x7fffffffu;
+  if (magnitude >= 0x7f800000u) {
+    // Infinity stays infinity, NaN keeps a quiet NaN payload.
+    return static_cast<uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u));
+  }
+  if (magnitude >= 0x477ff000u) {
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (magnitude < 0x38800000u) {
+    // Subnormal half, rounded to nearest even.
+    if (magnitude < 0x33000000u) {
+      return static_cast<uint16_t>(sign);
+    }
+    uint32_t exponent = magnitude >> 23;
+    uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+    uint32_t shift = 126 - exponent;
+    uint32_t half = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t midpoint = 1u << (shift - 1);
+    if (remainder > midpoint || (remainder == midpoint && (half & 1u))) {
+      half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (magnitude - 0x38000000u) >> 13;
+  uint32_t remainder = magnitude & 0x1fffu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+    half++;
+  }
+  return static_cast<uint16_t>(sign | half);
+}
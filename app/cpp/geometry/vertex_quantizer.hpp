@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace geometry {
+constexpr size_t kNoVertexAttribute = std::numeric_limits<size_t>::max();
+
+// Float offsets of the attributes in a tightly packed float vertex, kNoVertexAttribute when absent.
+struct VertexAttributeOffsets {
+  size_t position = 0;
+  size_t normal = kNoVertexAttribute;
+  size_t uv = kNoVertexAttribute;
+  size_t color = kNoVertexAttribute;
+  // Three component colors are stored with an opaque alpha.
+  size_t color_components = 4;
+};
+
+// Quantized vertices use the following encodings, each attribute 4-byte aligned:
+//   position  UNORM16 x4, xyz relative to the mesh bounds and w = 1
+//   normal    SNORM16 x2, octahedral
+//   uv        HALF_FLOAT x2
+//   color     UNORM8 x4
+// Byte offsets of absent attributes are kNoVertexAttribute.
+struct QuantizedMesh {
+  std::vector<uint8_t> vertices{};
+  size_t stride = 0;
+  VertexAttributeOffsets offsets{};
+  // Maps decoded positions in [0, 1] back to object space. The scale is uniform so normals,
+  // bounding spheres and normal cones keep their meaning in the quantized space.
+  glm::mat4 dequantization{1.0f};
+};
+
+QuantizedMesh QuantizeVertices(const std::vector<float> &vertices,
+                               size_t stride,
+                               const VertexAttributeOffsets &offsets);
+
+// Positions as the vertex shader sees them before the dequantization transform is applied.
+std::vector<glm::vec3> DecodeQuantizedPositions(const QuantizedMesh &mesh);
+
+// Copies size bytes at offset of every vertex into a tightly packed stream, e.g. to give the
+// positions their own vertex buffer binding.
+std::vector<uint8_t> ExtractVertexStream(const void *vertices,
+                                         size_t vertex_count,
+                                         size_t stride,
+                                         size_t offset,
+                                         size_t size);
+
+glm::vec2 EncodeOctahedral(const glm::vec3 &normal);
+
+glm::vec3 DecodeOctahedral(const glm::vec2 &encoded);
+
+uint16_t FloatToHalf(float value);
+}
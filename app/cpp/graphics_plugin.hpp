@@ -1,11 +1,22 @@
 #pragma once
 
+#include "foveation.hpp"
 #include "openxr-include.hpp"
 #include "math_utils.h"
 
 #include <vector>
 #include <string>
 #include <memory>
+#include <optional>
+#include <utility>
+
+// Part of the scene the images of a swapchain hold. With a background projection layer, what
+// lies beyond the renderer's split distance goes below and the rest over it.
+enum class LayerContent {
+  ALL,
+  FOREGROUND,
+  BACKGROUND,
+};
 
 class GraphicsPlugin {
  public:
@@ -22,11 +33,128 @@ class GraphicsPlugin {
 
   virtual void SwapchainImageStructsReady(XrSwapchainImageBaseHeader *images) = 0;
 
-  virtual void RenderView(const XrCompositionLayerProjectionView &layer_view,
+  // Defaults to LayerContent::ALL. FOREGROUND images are cleared transparent, to be composited
+  // with XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT over the BACKGROUND ones.
+  virtual void SetLayerContent(XrSwapchainImageBaseHeader *images, LayerContent content) = 0;
+
+  // UI panel swapchains are written from host memory instead of rendered to, with RGBA8 texels
+  // in a format picked from the runtime's. They need XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT.
+  virtual int64_t SelectPanelSwapchainFormat(const std::vector<int64_t> &runtime_formats) = 0;
+
+  virtual XrSwapchainImageBaseHeader *AllocatePanelImageStructs(
+      uint32_t capacity,
+      const XrSwapchainCreateInfo &swapchain_create_info) = 0;
+
+  // Records the copy of pixels, one RGBA8 texel per pixel row after row, into an acquired panel
+  // image. Submitted by EndFrame along with the views.
+  virtual void UploadPanel(XrSwapchainImageBaseHeader *images,
+                           uint32_t image_index,
+                           const std::vector<uint32_t> &pixels) = 0;
+
+  // Depth swapchains are submitted with XR_KHR_composition_layer_depth. Empty when none of the
+  // runtime's formats can take the renderer's depth.
+  virtual std::optional<int64_t> SelectDepthSwapchainFormat(
+      const std::vector<int64_t> &runtime_formats) = 0;
+
+  // Images of a depth swapchain laid out like the one of color_images, allocated before
+  // SwapchainImageStructsReady of the color images. Every frame rendered into color_images then
+  // writes its depth into them, which needs XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT.
+  virtual XrSwapchainImageBaseHeader *AllocateDepthImageStructs(
+      XrSwapchainImageBaseHeader *color_images,
+      uint32_t capacity,
+      const XrSwapchainCreateInfo &swapchain_create_info) = 0;
+
+  // Acquired depth image the next RenderView or RenderMultiview into color_images writes.
+  virtual void SetDepthImageIndex(XrSwapchainImageBaseHeader *color_images,
+                                  uint32_t image_index) = 0;
+
+  // Near and far plane the views of a swapchain are rendered with, depth 0 at the near one.
+  [[nodiscard]] virtual std::pair<float, float> GetDepthRange(
+      XrSwapchainImageBaseHeader *images) const = 0;
+
+  // Whether the next frame rendered into images writes its depth. The tile foveation fallback
+  // does not, the views of its frames have to go without depth.
+  [[nodiscard]] virtual bool IsDepthKept(XrSwapchainImageBaseHeader *images) const = 0;
+
+  // Motion vector and depth swapchain formats for XR_FB_space_warp, in that order. Empty when the
+  // runtime offers none the renderer can write.
+  virtual std::optional<std::pair<int64_t, int64_t>> SelectSpaceWarpSwapchainFormats(
+      const std::vector<int64_t> &runtime_formats) = 0;
+
+  // Images of the motion vector and the depth swapchain of the views rendered into color_images,
+  // in that order. Both share the array size of color_images at a size of their own. Frames
+  // rendered into color_images after SetSpaceWarpImageIndices write the motion since the previous
+  // one into them.
+  virtual std::pair<XrSwapchainImageBaseHeader *, XrSwapchainImageBaseHeader *>
+  AllocateSpaceWarpImageStructs(XrSwapchainImageBaseHeader *color_images,
+                                uint32_t motion_vector_capacity,
+                                const XrSwapchainCreateInfo &motion_vector_create_info,
+                                uint32_t depth_capacity,
+                                const XrSwapchainCreateInfo &depth_create_info) = 0;
+
+  // Acquired space warp images the next RenderView or RenderMultiview into color_images writes.
+  // Frames without a call leave them alone.
+  virtual void SetSpaceWarpImageIndices(XrSwapchainImageBaseHeader *color_images,
+                                        uint32_t motion_vector_image_index,
+                                        uint32_t depth_image_index) = 0;
+
+  // Single pass stereo: both views live in the layers of one array swapchain and are recorded
+  // once with RenderMultiview. Otherwise every view has its own swapchain and RenderView call.
+  virtual bool IsMultiviewEnabled() const = 0;
+
+  // Whether the device can consume the runtime's fragment density maps (XR_FB_foveation_vulkan).
+  virtual bool IsFragmentDensityMapSupported() const = 0;
+
+  // Must be called before SelectSwapchainFormat; the swapchains then have to be created with
+  // XR_SWAPCHAIN_CREATE_FOVEATION_FRAGMENT_DENSITY_MAP_BIT_FB.
+  virtual void UseFragmentDensityMap() = 0;
+
+  // With a runtime density map the level is applied through the swapchains by the caller, the
+  // renderer otherwise falls back to tile foveation. Can change between any two frames.
+  virtual void SetFoveationLevel(FoveationLevel level) = 0;
+
+  // Scales the pixel error the LODs may show, 1 by default. Can change between any two frames.
+  virtual void SetLodBias(float bias) = 0;
+
+  // RenderView and RenderMultiview only record, the views of a frame are submitted together by
+  // EndFrame. Recording may start right after the images are acquired, EndFrame must wait until
+  // xrWaitSwapchainImage returned for all of them and precede their release.
+  virtual void BeginFrame() = 0;
+
+  // GPU time of the frame completed by the last BeginFrame, empty without timestamp queries.
+  // The subImage.imageRect of the layer views decides the rendered part of the swapchain images,
+  // so it can be scaled from frame to frame against this measurement.
+  [[nodiscard]] virtual std::optional<XrDuration> GetGpuFrameTime() const = 0;
+
+  // Hidden area mesh of a view as reported by XR_KHR_visibility_mask, kept until replaced.
+  virtual void SetVisibilityMask(uint32_t view_index,
+                                 const std::vector<XrVector2f> &vertices,
+                                 const std::vector<uint32_t> &indices) = 0;
+
+  // Called once per frame before anything is rendered, with the views of the main layer. Picks the
+  // LOD of every object from between the views, shared by all views and layers of the frame.
+  virtual void SelectLods(const std::vector<XrCompositionLayerProjectionView> &layer_views,
+                          const std::vector<math::Transform> &cube_transforms) = 0;
+
+  // Called before the RenderView calls of a frame. When the renderer shares the far field
+  // between the views, renders what lies beyond the split distance once from between them, for
+  // every RenderView to reproject; otherwise does nothing.
+  virtual void RenderFarField(const std::vector<XrCompositionLayerProjectionView> &layer_views,
+                              const std::vector<math::Transform> &cube_transforms) = 0;
+
+  virtual void RenderView(uint32_t view_index,
+                          const XrCompositionLayerProjectionView &layer_view,
                           XrSwapchainImageBaseHeader *swapchain_images,
                           const uint32_t image_index,
                           const std::vector<math::Transform> &cube_transforms) = 0;
 
+  virtual void RenderMultiview(const std::vector<XrCompositionLayerProjectionView> &layer_views,
+                               XrSwapchainImageBaseHeader *swapchain_images,
+                               const uint32_t image_index,
+                               const std::vector<math::Transform> &cube_transforms) = 0;
+
+  virtual void EndFrame() = 0;
+
   virtual void DeinitDevice() = 0;
 
   virtual ~GraphicsPlugin() = default;
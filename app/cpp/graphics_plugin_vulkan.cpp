@@ -2,15 +2,30 @@
 
 #include "openxr_utils.hpp"
 
+#include "lod_selector.hpp"
+#include "vulkan_far_field_renderer.hpp"
+#include "vulkan_frame_submitter.hpp"
+#include "vulkan_hidden_area_mask.hpp"
+#include "vulkan_meshlet_culler.hpp"
+#include "vulkan_panel_swapchain.hpp"
+#include "vulkan_space_warp_renderer.hpp"
 #include "vulkan_swapchain_context.hpp"
+#include "geometry/mesh_optimizer.hpp"
+#include "geometry/mesh_simplifier.hpp"
+#include "geometry/meshlet_builder.hpp"
+#include "geometry/vertex_quantizer.hpp"
 #include "vulkan/data_type.hpp"
+#include "vulkan/vulkan_geometry_pool.hpp"
 #include "vulkan/vulkan_rendering_context.hpp"
 #include "vulkan/vulkan_rendering_pipeline.hpp"
 #include "vulkan/vulkan_utils.hpp"
 
 #include <array>
+#include <cmath>
 #include <map>
 #include <memory>
+#include <optional>
+#include <utility>
 
 #include <spdlog/spdlog.h>
 
@@ -39,6 +54,45 @@ const std::vector<unsigned short> kCubeIndices{
     3, 2, 6,
     6, 7, 3
 };
+// Visualized reference spaces plus both hands, with some headroom.
+constexpr uint32_t kMaxMeshletInstances = 16;
+// Fetch vertex attributes from the geometry pool storage buffers instead of vertex input state.
+constexpr bool kUseVertexPulling = false;
+// Store positions as UNORM16 and colors as UNORM8 when the device can fetch them.
+constexpr bool kUseQuantizedVertices = true;
+// Lay down depth from the position stream before shading, worth it once fragments get expensive.
+constexpr bool kUseDepthPrepass = false;
+// Record both eyes in one render pass over an array swapchain when the device supports it.
+constexpr bool kUseMultiview = true;
+// Render at kTemporalInputScale and accumulate jittered frames into the full eye buffer. Needs
+// the swapchains to allow transfers, so it stays off with the runtime's density maps.
+constexpr bool kUseTemporalUpsampling = false;
+constexpr float kTemporalInputScale = 0.75f;
+// Render what lies beyond kFarFieldSplitDistance once from between the eyes and reproject it into
+// both, only the near content is rendered per eye. The split distance also separates the
+// background projection layer from the foreground. The far pass runs on a render pass of its own,
+// so it needs the views without multiview and without the runtime's density maps.
+constexpr bool kUseFarFieldReprojection = false;
+constexpr float kFarFieldSplitDistance = 5.0f;
+// Far field images relative to a view swapchain, room for the union of the views.
+constexpr float kFarFieldExtentScale = 1.5f;
+// Bounding sphere radius of the unit cube, tells whether an object is wholly near or far.
+constexpr float kCubeRadius = 0.8660254f;
+constexpr float kNearDistance = 0.05f;
+constexpr float kFarDistance = 100.0f;
+constexpr uint32_t kStereoViewCount = 2;
+constexpr uint32_t kMaxFramesInFlight = 2;
+constexpr uint32_t kViewProjectionBinding = 0;
+constexpr size_t kGeometryPoolVertexCapacity = 4 * 1024 * 1024;
+constexpr size_t kGeometryPoolIndexCapacity = 1024 * 1024;
+constexpr uint32_t kGeometryPoolMeshCapacity = 256;
+// Render queue sort key ids and the view distance mapped to the far end of the depth bits.
+constexpr uint32_t kMainPipelineId = 0;
+constexpr uint32_t kPullingPipelineId = 1;
+constexpr float kRenderQueueDepthRange = 100.0f;
+constexpr uint64_t kLodStatisticsInterval = 300;
+// Pixel error of the LODs at a bias of 1.
+constexpr float kLodPixelThreshold = 1.0f;
 
 VkResult CreateDebugUtilsMessengerExt(
     VkInstance instance,
@@ -69,6 +123,14 @@ void DestroyDebugUtilsMessengerExt(
   }
 }
 
+VkRect2D ToRenderArea(const XrRect2Di &image_rect) {
+  return {
+      {image_rect.offset.x, image_rect.offset.y},
+      {static_cast<uint32_t>(image_rect.extent.width),
+       static_cast<uint32_t>(image_rect.extent.height)},
+  };
+}
+
 class VulkanGraphicsPlugin : public GraphicsPlugin {
   [[nodiscard]] std::vector<std::string> GetOpenXrInstanceExtensions() const override {
     return {XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME};
@@ -268,20 +330,101 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
     for (uint32_t i = 0; i < queue_family_count; ++i) {
       if ((queue_family_properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0u) {
         graphics_queue_family_index_ = queue_info.queueFamilyIndex = i;
+        timestamp_valid_bits_ = queue_family_properties[i].timestampValidBits;
         break;
       }
     }
 
+    uint32_t device_extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device_, nullptr, &device_extension_count, nullptr);
+    std::vector<VkExtensionProperties> device_extension_properties(device_extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device_,
+                                         nullptr,
+                                         &device_extension_count,
+                                         device_extension_properties.data());
+    auto has_device_extension = [&device_extension_properties](const char *name) {
+      return std::any_of(device_extension_properties.begin(),
+                         device_extension_properties.end(),
+                         [name](const VkExtensionProperties &properties) {
+                           return strcmp(properties.extensionName, name) == 0;
+                         });
+    };
+
+    VkPhysicalDeviceBufferDeviceAddressFeaturesKHR buffer_device_address_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR,
+    };
+    VkPhysicalDeviceMultiviewFeatures multiview_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 supported_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &multiview_features,
+    };
+    VkPhysicalDeviceFragmentDensityMapFeaturesEXT fragment_density_map_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_FEATURES_EXT,
+    };
+    if (has_device_extension(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME)) {
+      multiview_features.pNext = &buffer_device_address_features;
+    }
+    if (has_device_extension(VK_EXT_FRAGMENT_DENSITY_MAP_EXTENSION_NAME)) {
+      fragment_density_map_features.pNext = supported_features.pNext;
+      supported_features.pNext = &fragment_density_map_features;
+    }
+    vkGetPhysicalDeviceFeatures2(physical_device_, &supported_features);
     VkPhysicalDeviceFeatures features{};
+    features.multiDrawIndirect = supported_features.features.multiDrawIndirect;
+    enabled_features_ = features;
+
+    std::vector<const char *> device_extensions{};
+    void *device_create_info_next = nullptr;
+    buffer_device_address_enabled_ = buffer_device_address_features.bufferDeviceAddress == VK_TRUE;
+    if (buffer_device_address_enabled_) {
+      device_extensions.push_back(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+      buffer_device_address_features = {
+          .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR,
+          .bufferDeviceAddress = VK_TRUE,
+      };
+      device_create_info_next = &buffer_device_address_features;
+    }
+    spdlog::info("Buffer device address {}", buffer_device_address_enabled_ ? "enabled" : "unsupported");
+
+    // Multiview is core in Vulkan 1.1 but the feature itself is still optional.
+    multiview_enabled_ = kUseMultiview && !kUseVertexPulling
+        && multiview_features.multiview == VK_TRUE;
+    if (multiview_enabled_) {
+      multiview_features = {
+          .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES,
+          .pNext = device_create_info_next,
+          .multiview = VK_TRUE,
+      };
+      device_create_info_next = &multiview_features;
+    }
+    spdlog::info("Multiview {}", multiview_enabled_ ? "enabled" : "disabled");
+
+    // Enabled whenever present, whether the runtime provides density maps is only known later.
+    // The attachments are regular images, so non-subsampled ones have to be allowed too.
+    fragment_density_map_supported_ = fragment_density_map_features.fragmentDensityMap == VK_TRUE
+        && fragment_density_map_features.fragmentDensityMapNonSubsampledImages == VK_TRUE;
+    if (fragment_density_map_supported_) {
+      device_extensions.push_back(VK_EXT_FRAGMENT_DENSITY_MAP_EXTENSION_NAME);
+      fragment_density_map_features = {
+          .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_FEATURES_EXT,
+          .pNext = device_create_info_next,
+          .fragmentDensityMap = VK_TRUE,
+          .fragmentDensityMapNonSubsampledImages = VK_TRUE,
+      };
+      device_create_info_next = &fragment_density_map_features;
+    }
 
     VkDeviceCreateInfo device_create_info{};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext = device_create_info_next;
     device_create_info.queueCreateInfoCount = 1;
     device_create_info.pQueueCreateInfos = &queue_info;
     device_create_info.enabledLayerCount = 0;
     device_create_info.ppEnabledLayerNames = nullptr;
-    device_create_info.enabledExtensionCount = 0;
-    device_create_info.ppEnabledExtensionNames = nullptr;
+    device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+    device_create_info.ppEnabledExtensionNames = device_extensions.data();
     device_create_info.pEnabledFeatures = &features;
 
     XrVulkanDeviceCreateInfoKHR vulkan_device_create_info_khr{};
@@ -321,14 +464,19 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
 
     const std::vector<uint32_t> kVertexShader = {
 #include "vert.spv"
+    };
+    const std::vector<uint32_t> kMultiviewVertexShader = {
+#include "vert_multiview.spv"
     };
     const std::vector<uint32_t> kFragmentShader = {
 #include "frag.spv"
     };
 
-    auto vertex_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
-                                                                kVertexShader,
-                                                                "main");
+    // The multiview shader takes the model matrix and reads both view projections from a buffer.
+    auto vertex_shader = std::make_shared<vulkan::VulkanShader>(
+        rendering_context_,
+        multiview_enabled_ ? kMultiviewVertexShader : kVertexShader,
+        "main");
     auto fragment_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
                                                                   kFragmentShader,
                                                                   "main");
@@ -337,6 +485,27 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
     vertex_buffer_layout.Push({0, vulkan::DataType::FLOAT, 3});
     vertex_buffer_layout.Push({1, vulkan::DataType::FLOAT, 3});
 
+    // Positions get their own buffer binding so depth-only passes fetch nothing else.
+    vulkan::VertexBufferLayout stream_layout = vulkan::VertexBufferLayout();
+    stream_layout.Push({0, vulkan::DataType::FLOAT, 3, 0});
+    stream_layout.Push({1, vulkan::DataType::FLOAT, 3, 1});
+
+    // The geometry pool only pulls float attributes.
+    vulkan::VertexBufferLayout quantized_layout = vulkan::VertexBufferLayout();
+    quantized_layout.Push({0, vulkan::DataType::UNORM_16, 4, 0});
+    quantized_layout.Push({1, vulkan::DataType::BYTE, 4, 1});
+    const bool kQuantize = kUseQuantizedVertices && !kUseVertexPulling
+        && rendering_context_->IsVertexFormatSupported(
+            vulkan::GetVkFormat(vulkan::DataType::UNORM_16, 4))
+        && rendering_context_->IsVertexFormatSupported(
+            vulkan::GetVkFormat(vulkan::DataType::BYTE, 4));
+    if (kQuantize) {
+      stream_layout = quantized_layout;
+    }
+    vulkan::VertexBufferLayout depth_layout = vulkan::VertexBufferLayout();
+    depth_layout.Push(stream_layout.GetElements()[0]);
+    position_layout_ = depth_layout;
+
     auto pipeline_config = vulkan::RenderingPipelineConfig{
         .draw_mode = vulkan::DrawMode::TRIANGLE_LIST,
         .cull_mode = vulkan::CullMode::BACK,
@@ -344,28 +513,242 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
         .enable_depth_test = true,
         .depth_function = vulkan::CompareOp::LESS,
     };
+    if (kUseDepthPrepass) {
+      const std::vector<uint32_t> kDepthShader = {
+#include "depth.spv"
+      };
+      const std::vector<uint32_t> kMultiviewDepthShader = {
+#include "depth_multiview.spv"
+      };
+      auto depth_shader = std::make_shared<vulkan::VulkanShader>(
+          rendering_context_,
+          multiview_enabled_ ? kMultiviewDepthShader : kDepthShader,
+          "main");
+      depth_pipeline_ = std::make_shared<vulkan::VulkanRenderingPipeline>(
+          rendering_context_,
+          depth_shader,
+          depth_layout,
+          pipeline_config
+      );
+    }
+    auto color_config = pipeline_config;
+    if (depth_pipeline_ != nullptr) {
+      color_config.depth_function = vulkan::CompareOp::LESS_OR_EQUAL;
+    }
     pipeline_ = std::make_shared<vulkan::VulkanRenderingPipeline>(
         rendering_context_,
         vertex_shader,
         fragment_shader,
-        vertex_buffer_layout,
-        pipeline_config
+        stream_layout,
+        color_config
     );
-    auto vertex_buffer = std::make_shared<vulkan::VulkanBuffer>(
+    const size_t kVertexStride = vertex_buffer_layout.GetElementSize() / sizeof(float);
+    std::vector<float> cube_vertices = kCubePositions;
+    std::vector<uint32_t> cube_indices(kCubeIndices.begin(), kCubeIndices.end());
+    geometry::MeshOptimizationReport report = geometry::OptimizeMesh(cube_vertices,
+                                                                     kVertexStride,
+                                                                     0,
+                                                                     cube_indices);
+    spdlog::info("Optimized cube mesh: vertices {} -> {}, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+                 report.vertex_count_before,
+                 report.vertex_count_after,
+                 report.before.acmr,
+                 report.after.acmr,
+                 report.before.atvr,
+                 report.after.atvr);
+
+    const size_t kVertexCount = cube_vertices.size() / kVertexStride;
+    std::vector<glm::vec3> positions{};
+    std::vector<uint8_t> position_stream{};
+    std::vector<uint8_t> attribute_stream{};
+    if (kQuantize) {
+      geometry::QuantizedMesh quantized = geometry::QuantizeVertices(
+          cube_vertices,
+          kVertexStride,
+          {.position = 0, .color = 3, .color_components = 3});
+      spdlog::info("Quantized cube vertices: {} -> {} bytes per vertex",
+                   vertex_buffer_layout.GetElementSize(),
+                   quantized.stride);
+      position_stream = geometry::ExtractVertexStream(quantized.vertices.data(),
+                                                      kVertexCount,
+                                                      quantized.stride,
+                                                      quantized.offsets.position,
+                                                      stream_layout.GetStride(0));
+      attribute_stream = geometry::ExtractVertexStream(quantized.vertices.data(),
+                                                       kVertexCount,
+                                                       quantized.stride,
+                                                       quantized.offsets.color,
+                                                       stream_layout.GetStride(1));
+      // Meshlet bounds live in the quantized space so the culler sees what the shader draws.
+      positions = geometry::DecodeQuantizedPositions(quantized);
+      cube_dequantization_ = quantized.dequantization;
+    } else {
+      position_stream = geometry::ExtractVertexStream(cube_vertices.data(),
+                                                      kVertexCount,
+                                                      vertex_buffer_layout.GetElementSize(),
+                                                      0,
+                                                      stream_layout.GetStride(0));
+      attribute_stream = geometry::ExtractVertexStream(cube_vertices.data(),
+                                                       kVertexCount,
+                                                       vertex_buffer_layout.GetElementSize(),
+                                                       stream_layout.GetStride(0),
+                                                       stream_layout.GetStride(1));
+      for (size_t i = 0; i < cube_vertices.size(); i += kVertexStride) {
+        positions.emplace_back(cube_vertices[i], cube_vertices[i + 1], cube_vertices[i + 2]);
+      }
+      cube_dequantization_ = glm::identity<glm::mat4>();
+    }
+    spdlog::info("Cube vertex streams: depth passes fetch {} of {} bytes per vertex",
+                 stream_layout.GetStride(0),
+                 stream_layout.GetElementSize());
+    auto position_buffer = std::make_shared<vulkan::VulkanBuffer>(
         rendering_context_,
-        sizeof(float) * kCubePositions.size(),
+        position_stream.size(),
         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    vertex_buffer->Update(kCubePositions.data());
-    pipeline_->SetVertexBuffer(vertex_buffer);
-
-    auto index_buffer = std::make_shared<vulkan::VulkanBuffer>(
+    position_buffer->Update(position_stream.data());
+    cube_position_buffer_ = position_buffer;
+    auto attribute_buffer = std::make_shared<vulkan::VulkanBuffer>(
         rendering_context_,
-        sizeof(unsigned short) * kCubeIndices.size(),
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        attribute_stream.size(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    index_buffer->Update(kCubeIndices.data());
-    pipeline_->SetIndexBuffer(index_buffer, vulkan::DataType::UINT_16);
+    attribute_buffer->Update(attribute_stream.data());
+    pipeline_->SetVertexBuffer(position_buffer, 0);
+    pipeline_->SetVertexBuffer(attribute_buffer, 1);
+    if (multiview_enabled_) {
+      view_projection_buffer_ = std::make_shared<vulkan::VulkanBuffer>(
+          rendering_context_,
+          sizeof(glm::mat4) * kStereoViewCount,
+          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      pipeline_->SetBuffer(kViewProjectionBinding, view_projection_buffer_);
+    }
+    if (depth_pipeline_ != nullptr) {
+      depth_pipeline_->SetVertexBuffer(position_buffer, 0);
+      if (multiview_enabled_) {
+        depth_pipeline_->SetBuffer(kViewProjectionBinding, view_projection_buffer_);
+      }
+    }
+    std::vector<geometry::MeshLod> lods = geometry::BuildLodChain(cube_vertices,
+                                                                  kVertexStride,
+                                                                  0,
+                                                                  cube_indices);
+    std::vector<std::vector<uint32_t>> lod_indices{};
+    for (const auto &lod: lods) {
+      lod_indices.push_back(lod.indices);
+    }
+    std::vector<geometry::MeshletLodRange> lod_ranges{};
+    geometry::MeshletMesh meshlets = geometry::BuildMeshletLods(lod_indices, positions, lod_ranges);
+    std::vector<geometry::MeshletDrawRange> draw_ranges{};
+    std::vector<uint32_t> meshlet_indices = geometry::FlattenMeshletIndices(meshlets, draw_ranges);
+    spdlog::info("Split cube mesh into {} lods and {} meshlets", lods.size(), meshlets.meshlets.size());
+
+    cube_lods_.clear();
+    cube_lod_levels_.clear();
+    for (size_t i = 0; i < lods.size(); i++) {
+      // Flattening keeps the meshlets of a lod contiguous in the index buffer.
+      uint32_t index_count = 0;
+      for (uint32_t m = 0; m < lod_ranges[i].meshlet_count; m++) {
+        index_count += draw_ranges[lod_ranges[i].first_meshlet + m].index_count;
+      }
+      cube_lods_.push_back({
+          .first_index = draw_ranges[lod_ranges[i].first_meshlet].first_index,
+          .index_count = index_count,
+          .error = lods[i].error,
+      });
+      cube_lod_levels_.push_back({lods[i].error, index_count / 3});
+    }
+
+    std::shared_ptr<vulkan::VulkanBuffer> index_buffer = nullptr;
+    if (report.fits_uint16_indices) {
+      std::vector<uint16_t> narrow_indices = geometry::ToUint16Indices(meshlet_indices);
+      index_buffer = std::make_shared<vulkan::VulkanBuffer>(
+          rendering_context_,
+          sizeof(uint16_t) * narrow_indices.size(),
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      index_buffer->Update(narrow_indices.data());
+      pipeline_->SetIndexBuffer(index_buffer, vulkan::DataType::UINT_16);
+      cube_index_type_ = vulkan::DataType::UINT_16;
+      if (depth_pipeline_ != nullptr) {
+        depth_pipeline_->SetIndexBuffer(index_buffer, vulkan::DataType::UINT_16);
+      }
+    } else {
+      index_buffer = std::make_shared<vulkan::VulkanBuffer>(
+          rendering_context_,
+          sizeof(uint32_t) * meshlet_indices.size(),
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      index_buffer->Update(meshlet_indices.data());
+      pipeline_->SetIndexBuffer(index_buffer, vulkan::DataType::UINT_32);
+      cube_index_type_ = vulkan::DataType::UINT_32;
+      if (depth_pipeline_ != nullptr) {
+        depth_pipeline_->SetIndexBuffer(index_buffer, vulkan::DataType::UINT_32);
+      }
+    }
+    cube_index_buffer_ = index_buffer;
+
+    meshlet_culler_ = std::make_shared<VulkanMeshletCuller>(rendering_context_,
+                                                            meshlets,
+                                                            draw_ranges,
+                                                            lod_ranges,
+                                                            kMaxMeshletInstances);
+    hidden_area_mask_ = std::make_shared<VulkanHiddenAreaMask>(rendering_context_,
+                                                               kStereoViewCount);
+
+    if (kUseVertexPulling) {
+      InitializeVertexPulling(fragment_shader,
+                              pipeline_config,
+                              vertex_buffer_layout,
+                              cube_vertices,
+                              lods);
+    }
+  }
+
+  void InitializeVertexPulling(std::shared_ptr<vulkan::VulkanShader> fragment_shader,
+                               const vulkan::RenderingPipelineConfig &pipeline_config,
+                               const vulkan::VertexBufferLayout &cube_layout,
+                               const std::vector<float> &cube_vertices,
+                               const std::vector<geometry::MeshLod> &cube_lods) {
+    const std::vector<uint32_t> kPullShader = {
+#include "vert_pull.spv"
+    };
+    const std::vector<uint32_t> kPullDeviceAddressShader = {
+#include "vert_pull_bda.spv"
+    };
+
+    geometry_pool_ = std::make_shared<vulkan::VulkanGeometryPool>(rendering_context_,
+                                                                  kGeometryPoolVertexCapacity,
+                                                                  kGeometryPoolIndexCapacity,
+                                                                  kGeometryPoolMeshCapacity);
+    auto vertex_shader = std::make_shared<vulkan::VulkanShader>(
+        rendering_context_,
+        geometry_pool_->UsesDeviceAddress() ? kPullDeviceAddressShader : kPullShader,
+        "main");
+    pulling_pipeline_ = std::make_shared<vulkan::VulkanRenderingPipeline>(
+        rendering_context_,
+        vertex_shader,
+        fragment_shader,
+        vulkan::VertexBufferLayout(),
+        pipeline_config
+    );
+    pulling_pipeline_->SetIndexBuffer(geometry_pool_->GetIndexBuffer(), vulkan::DataType::UINT_32);
+    if (!geometry_pool_->UsesDeviceAddress()) {
+      pulling_pipeline_->SetBuffer(vulkan::kGeometryPoolVerticesBinding,
+                                   geometry_pool_->GetVertexBuffer());
+      pulling_pipeline_->SetBuffer(vulkan::kGeometryPoolMeshesBinding,
+                                   geometry_pool_->GetMeshBuffer());
+    }
+
+    cube_mesh_id_ = geometry_pool_->AddMesh(cube_vertices.data(),
+                                            cube_vertices.size() * sizeof(float)
+                                                / cube_layout.GetElementSize(),
+                                            cube_layout,
+                                            cube_lods[0].indices);
+    for (size_t i = 1; i < cube_lods.size(); i++) {
+      geometry_pool_->AddLod(cube_mesh_id_, cube_lods[i].indices, cube_lods[i].error);
+    }
   }
 
   [[nodiscard]] int64_t SelectSwapchainFormat(const std::vector<int64_t> &runtime_formats) override {
@@ -386,10 +769,17 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
     }
     rendering_context_ = std::make_shared<vulkan::VulkanRenderingContext>(
         physical_device_,
+        enabled_features_,
+        buffer_device_address_enabled_,
         logical_device_,
         graphic_queue_,
         graphics_command_pool_,
-        (VkFormat) (*swapchain_format_it));
+        (VkFormat) (*swapchain_format_it),
+        multiview_enabled_ ? kStereoViewCount : 1,
+        fragment_density_map_enabled_);
+    frame_submitter_ = std::make_shared<VulkanFrameSubmitter>(rendering_context_,
+                                                              kMaxFramesInFlight,
+                                                              timestamp_valid_bits_);
     InitializeResources();
     return *swapchain_format_it;
   }
@@ -402,9 +792,21 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
                                                             const XrSwapchainCreateInfo &swapchain_create_info) override {
     auto swapchain_context = std::make_shared<VulkanSwapchainContext>(rendering_context_,
                                                                       capacity,
-                                                                      swapchain_create_info);
+                                                                      swapchain_create_info,
+                                                                      kMaxFramesInFlight);
     auto images = swapchain_context->GetFirstImagePointer();
     image_to_context_mapping_.insert(std::make_pair(images, swapchain_context));
+    if (kUseFarFieldReprojection && !multiview_enabled_ && !fragment_density_map_enabled_
+        && far_field_ == nullptr) {
+      far_field_ = std::make_shared<VulkanFarFieldRenderer>(
+          rendering_context_,
+          static_cast<VkFormat>(swapchain_create_info.format),
+          VkExtent2D{
+              static_cast<uint32_t>(swapchain_create_info.width * kFarFieldExtentScale),
+              static_cast<uint32_t>(swapchain_create_info.height * kFarFieldExtentScale),
+          },
+          kMaxFramesInFlight);
+    }
     return images;
   }
 
@@ -414,35 +816,504 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
       throw std::runtime_error("trying to init same image twice");
     }
     context->InitSwapchainImageViews();
+    context->SetFoveationTiles(foveation_tiles_);
+    if (kUseTemporalUpsampling && !fragment_density_map_enabled_ && far_field_ == nullptr) {
+      context->EnableTemporalUpsampling(kTemporalInputScale);
+    }
+  }
+
+  [[nodiscard]] int64_t SelectPanelSwapchainFormat(
+      const std::vector<int64_t> &runtime_formats) override {
+    constexpr VkFormat kPanelSwapchainFormats[] = {
+        VK_FORMAT_R8G8B8A8_SRGB,
+        VK_FORMAT_R8G8B8A8_UNORM};
+    auto swapchain_format_it = std::find_first_of(runtime_formats.begin(), runtime_formats.end(),
+                                                  std::begin(kPanelSwapchainFormats),
+                                                  std::end(kPanelSwapchainFormats));
+    if (swapchain_format_it == runtime_formats.end()) {
+      throw std::runtime_error("No runtime swapchain format supported for panels");
+    }
+    return *swapchain_format_it;
+  }
+
+  XrSwapchainImageBaseHeader *AllocatePanelImageStructs(
+      uint32_t capacity,
+      const XrSwapchainCreateInfo &swapchain_create_info) override {
+    auto panel = std::make_shared<VulkanPanelSwapchain>(rendering_context_,
+                                                        capacity,
+                                                        swapchain_create_info,
+                                                        kMaxFramesInFlight);
+    auto images = panel->GetFirstImagePointer();
+    image_to_panel_mapping_.insert(std::make_pair(images, panel));
+    return images;
+  }
+
+  void UploadPanel(XrSwapchainImageBaseHeader *images,
+                   uint32_t image_index,
+                   const std::vector<uint32_t> &pixels) override {
+    frame_submitter_->AddCommandBuffer(image_to_panel_mapping_.at(images)->Upload(frame_index_,
+                                                                                  image_index,
+                                                                                  pixels));
+  }
+
+  [[nodiscard]] std::optional<int64_t> SelectDepthSwapchainFormat(
+      const std::vector<int64_t> &runtime_formats) override {
+    // The resolve writes floats, which only this format takes without conversion.
+    auto swapchain_format_it = std::find(runtime_formats.begin(),
+                                         runtime_formats.end(),
+                                         VK_FORMAT_D32_SFLOAT);
+    if (swapchain_format_it == runtime_formats.end()) {
+      return std::nullopt;
+    }
+    return *swapchain_format_it;
+  }
+
+  XrSwapchainImageBaseHeader *AllocateDepthImageStructs(
+      XrSwapchainImageBaseHeader *color_images,
+      uint32_t capacity,
+      const XrSwapchainCreateInfo &swapchain_create_info) override {
+    return image_to_context_mapping_.at(color_images)->AllocateDepthImageStructs(
+        capacity,
+        swapchain_create_info);
+  }
+
+  void SetDepthImageIndex(XrSwapchainImageBaseHeader *color_images,
+                          uint32_t image_index) override {
+    image_to_context_mapping_.at(color_images)->SetDepthImageIndex(image_index);
+  }
+
+  // The background layer starts at the split distance, the foreground and views with a shared
+  // far field end there.
+  [[nodiscard]] bool IsDepthKept(XrSwapchainImageBaseHeader *images) const override {
+    return image_to_context_mapping_.at(images)->IsDepthKept();
+  }
+
+  [[nodiscard]] std::pair<float, float> GetDepthRange(
+      XrSwapchainImageBaseHeader *images) const override {
+    switch (GetLayerContent(images)) {
+      case LayerContent::BACKGROUND:
+        return {kFarFieldSplitDistance, kFarDistance};
+      case LayerContent::FOREGROUND:
+        return {kNearDistance, kFarFieldSplitDistance};
+      case LayerContent::ALL:
+      default:
+        return {kNearDistance, far_field_ != nullptr ? kFarFieldSplitDistance : kFarDistance};
+    }
+  }
+
+  [[nodiscard]] std::optional<std::pair<int64_t, int64_t>> SelectSpaceWarpSwapchainFormats(
+      const std::vector<int64_t> &runtime_formats) override {
+    // Image views of the space warp depth only take the depth aspect, so no stencil formats.
+    constexpr VkFormat kDepthSwapchainFormats[] = {
+        VK_FORMAT_D32_SFLOAT,
+        VK_FORMAT_D16_UNORM};
+    auto motion_vector_format_it = std::find(runtime_formats.begin(),
+                                             runtime_formats.end(),
+                                             VK_FORMAT_R16G16B16A16_SFLOAT);
+    auto depth_format_it = std::find_first_of(runtime_formats.begin(), runtime_formats.end(),
+                                              std::begin(kDepthSwapchainFormats),
+                                              std::end(kDepthSwapchainFormats));
+    if (motion_vector_format_it == runtime_formats.end()
+        || depth_format_it == runtime_formats.end()) {
+      return std::nullopt;
+    }
+    return std::make_pair(*motion_vector_format_it, *depth_format_it);
+  }
+
+  std::pair<XrSwapchainImageBaseHeader *, XrSwapchainImageBaseHeader *>
+  AllocateSpaceWarpImageStructs(XrSwapchainImageBaseHeader *color_images,
+                                uint32_t motion_vector_capacity,
+                                const XrSwapchainCreateInfo &motion_vector_create_info,
+                                uint32_t depth_capacity,
+                                const XrSwapchainCreateInfo &depth_create_info) override {
+    if (image_to_space_warp_mapping_.find(color_images) != image_to_space_warp_mapping_.end()) {
+      throw std::runtime_error("space warp images are already allocated");
+    }
+    auto space_warp = std::make_shared<VulkanSpaceWarpRenderer>(rendering_context_,
+                                                                motion_vector_capacity,
+                                                                motion_vector_create_info,
+                                                                depth_capacity,
+                                                                depth_create_info,
+                                                                position_layout_,
+                                                                cube_position_buffer_,
+                                                                cube_index_buffer_,
+                                                                cube_index_type_,
+                                                                view_projection_buffer_,
+                                                                kMaxFramesInFlight);
+    image_to_space_warp_mapping_.insert(std::make_pair(color_images, space_warp));
+    return {space_warp->GetFirstMotionVectorImagePointer(),
+            space_warp->GetFirstDepthImagePointer()};
+  }
+
+  void SetSpaceWarpImageIndices(XrSwapchainImageBaseHeader *color_images,
+                                uint32_t motion_vector_image_index,
+                                uint32_t depth_image_index) override {
+    image_to_space_warp_mapping_.at(color_images)->SetImageIndices(motion_vector_image_index,
+                                                                   depth_image_index);
+  }
+
+  void SetLayerContent(XrSwapchainImageBaseHeader *images, LayerContent content) override {
+    layer_contents_[images] = content;
+    if (content == LayerContent::FOREGROUND) {
+      image_to_context_mapping_.at(images)->SetClearColor(glm::vec4(0.0f));
+    }
   }
-  void RenderView(const XrCompositionLayerProjectionView &layer_view,
+
+  [[nodiscard]] bool IsFragmentDensityMapSupported() const override {
+    return fragment_density_map_supported_;
+  }
+
+  void UseFragmentDensityMap() override {
+    if (!fragment_density_map_supported_) {
+      throw std::runtime_error("fragment density maps are not supported by the device");
+    }
+    if (rendering_context_ != nullptr) {
+      throw std::runtime_error("density maps have to be chosen before the render pass exists");
+    }
+    fragment_density_map_enabled_ = true;
+  }
+
+  void SetFoveationLevel(FoveationLevel level) override {
+    foveation_tiles_ = GetFoveationTiles(fragment_density_map_enabled_ ? FoveationLevel::OFF
+                                                                        : level);
+    for (auto &[images, context]: image_to_context_mapping_) {
+      context->SetFoveationTiles(foveation_tiles_);
+    }
+  }
+
+  void SetLodBias(float bias) override {
+    lod_selector_.SetPixelThreshold(kLodPixelThreshold * bias);
+  }
+
+  [[nodiscard]] bool IsMultiviewEnabled() const override {
+    return multiview_enabled_;
+  }
+
+  void BeginFrame() override {
+    frame_index_ = frame_submitter_->BeginFrame();
+    // Whatever the last frame rendered is where its objects move on from.
+    previous_cube_transforms_ = std::move(frame_cube_transforms_);
+    frame_cube_transforms_.clear();
+    lod_selector_.BeginFrame();
+    if (++frame_count_ % kLodStatisticsInterval == 0) {
+      const LodStatistics &statistics = lod_selector_.GetStatistics();
+      spdlog::debug("LOD: {} instances, {} of {} full detail triangles submitted",
+                    statistics.instance_count,
+                    statistics.submitted_triangles,
+                    statistics.full_detail_triangles);
+      vulkan::BindStatistics bind_statistics = far_field_bind_statistics_;
+      for (const auto &[images, context]: image_to_context_mapping_) {
+        bind_statistics.bind_count += context->GetBindStatistics().bind_count;
+        bind_statistics.skipped_bind_count += context->GetBindStatistics().skipped_bind_count;
+      }
+      spdlog::debug("Binds: {} recorded, {} skipped as redundant",
+                    bind_statistics.bind_count,
+                    bind_statistics.skipped_bind_count);
+    }
+  }
+
+  [[nodiscard]] std::optional<XrDuration> GetGpuFrameTime() const override {
+    const std::optional<uint64_t> kGpuFrameTime = frame_submitter_->GetGpuFrameTime();
+    if (!kGpuFrameTime.has_value()) {
+      return std::nullopt;
+    }
+    return static_cast<XrDuration>(*kGpuFrameTime);
+  }
+
+  void SetVisibilityMask(uint32_t view_index,
+                         const std::vector<XrVector2f> &vertices,
+                         const std::vector<uint32_t> &indices) override {
+    std::vector<glm::vec2> mask_vertices{};
+    mask_vertices.reserve(vertices.size());
+    for (const auto &vertex: vertices) {
+      mask_vertices.emplace_back(vertex.x, vertex.y);
+    }
+    hidden_area_mask_->SetViewMesh(view_index, mask_vertices, indices);
+    spdlog::info("Hidden area mesh of view {}: {} triangles", view_index, indices.size() / 3);
+  }
+
+  void SelectLods(const std::vector<XrCompositionLayerProjectionView> &layer_views,
+                  const std::vector<math::Transform> &cube_transforms) override {
+    // Selecting per view would feed the hysteresis of an object from both eyes in turn.
+    const glm::vec3 kCenter = math::XrVector3FToGlm(ComputeCenterView(layer_views).pose.position);
+    const float kProjectionScale = LodSelector::ComputeProjectionScale(
+        layer_views[0].fov,
+        static_cast<uint32_t>(layer_views[0].subImage.imageRect.extent.width));
+    frame_lods_.clear();
+    for (size_t i = 0; i < cube_transforms.size(); i++) {
+      const math::Transform &cube = cube_transforms[i];
+      const float kScale = std::max({cube.scale.x, cube.scale.y, cube.scale.z});
+      frame_lods_.push_back(lod_selector_.Select(i,
+                                                 cube_lod_levels_,
+                                                 glm::distance(cube.position, kCenter),
+                                                 kScale,
+                                                 kProjectionScale));
+    }
+  }
+
+  void RenderFarField(const std::vector<XrCompositionLayerProjectionView> &layer_views,
+                      const std::vector<math::Transform> &cube_transforms) override {
+    if (far_field_ == nullptr) {
+      return;
+    }
+    const XrCompositionLayerProjectionView kCenterView = ComputeCenterView(layer_views);
+    const VkExtent2D kExtent = far_field_->GetExtent();
+    const VkExtent2D kRenderExtent = {
+        std::min(kExtent.width,
+                 static_cast<uint32_t>(kCenterView.subImage.imageRect.extent.width)),
+        std::min(kExtent.height,
+                 static_cast<uint32_t>(kCenterView.subImage.imageRect.extent.height)),
+    };
+    const glm::mat4 kViewProjection = ComputeViewProjection(kCenterView,
+                                                            kFarFieldSplitDistance,
+                                                            kFarDistance);
+    const glm::vec3 kCenter = math::XrVector3FToGlm(kCenterView.pose.position);
+    CheckFrameLods(cube_transforms);
+
+    render_queue_.Clear();
+    draw_commands_.clear();
+    for (size_t i = 0; i < cube_transforms.size(); i++) {
+      const math::Transform &cube = cube_transforms[i];
+      const float kScale = std::max({cube.scale.x, cube.scale.y, cube.scale.z});
+      const float kDistance = glm::distance(cube.position, kCenter);
+      // Clip space w is the view space depth, the near plane clips at that depth too.
+      const float kDepth = (kViewProjection * glm::vec4(cube.position, 1.0f)).w;
+      if (IsOutsideDepthRange(kDepth, kCubeRadius * kScale, kFarFieldSplitDistance, kFarDistance)) {
+        continue;
+      }
+      const uint32_t kLod = frame_lods_[i];
+      DrawCommand draw{
+          .pipeline = kUseVertexPulling ? pulling_pipeline_ : pipeline_,
+          .geometry_pool = kUseVertexPulling ? geometry_pool_ : nullptr,
+          .mesh_id = cube_mesh_id_,
+          .lod = kLod,
+          .first_index = cube_lods_[kLod].first_index,
+          .index_count = cube_lods_[kLod].index_count,
+          .transform = kViewProjection * ComputeModel(cube),
+      };
+      render_queue_.Submit(RenderQueue::MakeKey(0,
+                                                kUseVertexPulling ? kPullingPipelineId
+                                                                  : kMainPipelineId,
+                                                0,
+                                                draw.mesh_id,
+                                                kDistance / kRenderQueueDepthRange),
+                           static_cast<uint32_t>(draw_commands_.size()));
+      draw_commands_.push_back(draw);
+    }
+    render_queue_.Sort();
+    VkCommandBuffer command_buffer = far_field_->BeginPass(frame_index_,
+                                                           kRenderExtent,
+                                                           kViewProjection);
+    vulkan::VulkanCommandEncoder encoder(command_buffer);
+    RecordDrawCommands(encoder, render_queue_, draw_commands_);
+    encoder.AddStatistics(far_field_bind_statistics_);
+    frame_submitter_->AddCommandBuffer(far_field_->EndPass());
+  }
+
+  void RenderView(uint32_t view_index,
+                  const XrCompositionLayerProjectionView &layer_view,
                   XrSwapchainImageBaseHeader *swapchain_images,
                   const uint32_t image_index,
                   const std::vector<math::Transform> &cube_transforms) override {
     if (layer_view.subImage.imageArrayIndex != 0) {
       throw std::runtime_error("Texture arrays not supported");
     }
-    glm::mat4 proj = math::CreateProjectionFov(layer_view.fov, 0.05f, 100.0f);
-    glm::mat4 view = math::InvertRigidBody(
-        glm::translate(glm::identity<glm::mat4>(), math::XrVector3FToGlm(layer_view.pose.position))
-            * glm::mat4_cast(math::XrQuaternionFToGlm(layer_view.pose.orientation))
-    );
-    std::vector<glm::mat4> transforms{};
-    for (const math::Transform &cube: cube_transforms) {
-      glm::mat4 model = glm::scale(glm::translate(glm::identity<glm::mat4>(), cube.position)
-                                       * glm::mat4_cast(cube.orientation), cube.scale);
-      transforms.emplace_back(proj * view * model);
+    auto swapchain_context = image_to_context_mapping_[swapchain_images];
+    swapchain_context->SetRenderArea(ToRenderArea(layer_view.subImage.imageRect));
+    const auto [kViewNearDistance, kViewFarDistance] = GetDepthRange(swapchain_images);
+    glm::mat4 view_projection = swapchain_context->ApplyTemporalJitter(
+        {ComputeViewProjection(layer_view, kViewNearDistance, kViewFarDistance)})[0];
+    if (far_field_ != nullptr && GetLayerContent(swapchain_images) == LayerContent::ALL) {
+      swapchain_context->SetFarField(far_field_, ComputeViewProjection(layer_view,
+                                                                       kFarFieldSplitDistance,
+                                                                       kFarDistance));
+    }
+    CheckFrameLods(cube_transforms);
+    MeshletInstances instances{
+        .view_projections = {view_projection},
+        .eye_positions = {math::XrVector3FToGlm(layer_view.pose.position)},
+    };
+    for (size_t i = 0; i < cube_transforms.size(); i++) {
+      const math::Transform &cube = cube_transforms[i];
+      const float kScale = std::max({cube.scale.x, cube.scale.y, cube.scale.z});
+      if (IsOutsideDepthRange((view_projection * glm::vec4(cube.position, 1.0f)).w,
+                              kCubeRadius * kScale,
+                              kViewNearDistance,
+                              kViewFarDistance)) {
+        continue;
+      }
+      glm::mat4 model = ComputeModel(cube);
+      instances.models.push_back(model);
+      instances.transforms.push_back(view_projection * model);
+      instances.lods.push_back(frame_lods_[i]);
+    }
+    std::optional<HiddenAreaPass> hidden_area = MakeHiddenAreaPass(view_index, {layer_view});
+    RenderSpaceWarp(swapchain_images, {view_projection}, cube_transforms);
+
+    if (!kUseVertexPulling && instances.models.size() <= meshlet_culler_->GetMaxInstances()) {
+      frame_submitter_->AddCommandBuffer(swapchain_context->DrawMeshlets(frame_index_,
+                                                                         image_index,
+                                                                         pipeline_,
+                                                                         meshlet_culler_,
+                                                                         instances,
+                                                                         depth_pipeline_,
+                                                                         nullptr,
+                                                                         hidden_area));
+      return;
+    }
+
+    const std::vector<glm::mat4> &transforms = instances.transforms;
+    const std::vector<uint32_t> &lods = instances.lods;
+    render_queue_.Clear();
+    draw_commands_.clear();
+    for (size_t i = 0; i < transforms.size(); i++) {
+      const glm::mat4 &transform = transforms[i];
+      DrawCommand draw{
+          .pipeline = kUseVertexPulling ? pulling_pipeline_ : pipeline_,
+          .geometry_pool = kUseVertexPulling ? geometry_pool_ : nullptr,
+          .mesh_id = cube_mesh_id_,
+          .lod = lods[i],
+          .first_index = cube_lods_[lods[i]].first_index,
+          .index_count = cube_lods_[lods[i]].index_count,
+          .transform = transform,
+      };
+      // Clip space w is the view space distance of the object's origin.
+      float depth = (transform * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).w / kRenderQueueDepthRange;
+      render_queue_.Submit(RenderQueue::MakeKey(0,
+                                                kUseVertexPulling ? kPullingPipelineId
+                                                                  : kMainPipelineId,
+                                                0,
+                                                draw.mesh_id,
+                                                depth),
+                           static_cast<uint32_t>(draw_commands_.size()));
+      draw_commands_.push_back(draw);
+    }
+    render_queue_.Sort();
+    frame_submitter_->AddCommandBuffer(swapchain_context->Draw(frame_index_,
+                                                               image_index,
+                                                               render_queue_,
+                                                               draw_commands_,
+                                                               nullptr,
+                                                               {},
+                                                               hidden_area));
+  }
+
+  void RenderMultiview(const std::vector<XrCompositionLayerProjectionView> &layer_views,
+                       XrSwapchainImageBaseHeader *swapchain_images,
+                       const uint32_t image_index,
+                       const std::vector<math::Transform> &cube_transforms) override {
+    if (!multiview_enabled_ || layer_views.size() != kStereoViewCount) {
+      throw std::runtime_error("multiview rendering is not available");
     }
     auto swapchain_context = image_to_context_mapping_[swapchain_images];
+    // The layers share one render area, the views are laid out alike.
+    swapchain_context->SetRenderArea(ToRenderArea(layer_views[0].subImage.imageRect));
+    const auto [kViewNearDistance, kViewFarDistance] = GetDepthRange(swapchain_images);
+    std::vector<glm::mat4> view_projections{};
+    std::vector<glm::vec3> eye_positions{};
+    glm::vec3 eye_center(0.0f);
+    for (const auto &layer_view: layer_views) {
+      view_projections.push_back(ComputeViewProjection(layer_view,
+                                                       kViewNearDistance,
+                                                       kViewFarDistance));
+      eye_positions.push_back(math::XrVector3FToGlm(layer_view.pose.position));
+      eye_center += eye_positions.back() / float(layer_views.size());
+    }
+    view_projections = swapchain_context->ApplyTemporalJitter(view_projections);
+    CheckFrameLods(cube_transforms);
+
+    // Culled against the union of the eye frusta, the multiview pipelines take the model alone.
+    MeshletInstances instances{
+        .view_projections = view_projections,
+        .eye_positions = eye_positions,
+    };
+    std::vector<float> distances{};
+    for (size_t i = 0; i < cube_transforms.size(); i++) {
+      const math::Transform &cube = cube_transforms[i];
+      const float kScale = std::max({cube.scale.x, cube.scale.y, cube.scale.z});
+      // Culled only when no layer sees it within the depth range.
+      bool outside = true;
+      for (const glm::mat4 &view_projection: view_projections) {
+        outside = outside && IsOutsideDepthRange(
+            (view_projection * glm::vec4(cube.position, 1.0f)).w,
+            kCubeRadius * kScale,
+            kViewNearDistance,
+            kViewFarDistance);
+      }
+      if (outside) {
+        continue;
+      }
+      instances.models.push_back(ComputeModel(cube));
+      instances.lods.push_back(frame_lods_[i]);
+      distances.push_back(glm::distance(cube.position, eye_center));
+    }
+    instances.transforms = instances.models;
+    std::optional<HiddenAreaPass> hidden_area = MakeHiddenAreaPass(0, layer_views);
+    RenderSpaceWarp(swapchain_images, view_projections, cube_transforms);
+
+    if (instances.models.size() <= meshlet_culler_->GetMaxInstances()) {
+      frame_submitter_->AddCommandBuffer(swapchain_context->DrawMeshlets(frame_index_,
+                                                                         image_index,
+                                                                         pipeline_,
+                                                                         meshlet_culler_,
+                                                                         instances,
+                                                                         depth_pipeline_,
+                                                                         view_projection_buffer_,
+                                                                         hidden_area));
+      return;
+    }
+
+    // Too many instances for the culler, whole LODs are drawn and the rasterizer clips them.
+    render_queue_.Clear();
+    draw_commands_.clear();
+    for (size_t i = 0; i < instances.models.size(); i++) {
+      const uint32_t kLod = instances.lods[i];
+      DrawCommand draw{
+          .pipeline = pipeline_,
+          .geometry_pool = nullptr,
+          .mesh_id = cube_mesh_id_,
+          .lod = kLod,
+          .first_index = cube_lods_[kLod].first_index,
+          .index_count = cube_lods_[kLod].index_count,
+          .transform = instances.models[i],
+      };
+      render_queue_.Submit(RenderQueue::MakeKey(0,
+                                                kMainPipelineId,
+                                                0,
+                                                draw.mesh_id,
+                                                distances[i] / kRenderQueueDepthRange),
+                           static_cast<uint32_t>(draw_commands_.size()));
+      draw_commands_.push_back(draw);
+    }
+    render_queue_.Sort();
+    frame_submitter_->AddCommandBuffer(swapchain_context->Draw(frame_index_,
+                                                               image_index,
+                                                               render_queue_,
+                                                               draw_commands_,
+                                                               view_projection_buffer_,
+                                                               view_projections,
+                                                               hidden_area));
+  }
 
-    swapchain_context->Draw(image_index,
-                            pipeline_,
-                            kCubeIndices.size(),
-                            transforms);
+  void EndFrame() override {
+    frame_submitter_->Submit();
   }
 
   void DeinitDevice() override {
+    frame_submitter_ = nullptr;
     image_to_context_mapping_.clear();
+    image_to_panel_mapping_.clear();
+    image_to_space_warp_mapping_.clear();
+    layer_contents_.clear();
+    far_field_ = nullptr;
+    meshlet_culler_ = nullptr;
+    hidden_area_mask_ = nullptr;
+    depth_pipeline_ = nullptr;
+    view_projection_buffer_ = nullptr;
+    cube_position_buffer_ = nullptr;
+    cube_index_buffer_ = nullptr;
+    pulling_pipeline_ = nullptr;
+    geometry_pool_ = nullptr;
     pipeline_ = nullptr;
     rendering_context_ = nullptr;
     vkDestroyCommandPool(logical_device_, graphics_command_pool_, nullptr);
@@ -454,22 +1325,193 @@ class VulkanGraphicsPlugin : public GraphicsPlugin {
   }
 
  private:
+  void CheckFrameLods(const std::vector<math::Transform> &cube_transforms) const {
+    if (frame_lods_.size() != cube_transforms.size()) {
+      throw std::runtime_error("lods have to be selected for the frame before rendering");
+    }
+  }
+
+  [[nodiscard]] static glm::mat4 ComputeProjection(
+      const XrCompositionLayerProjectionView &layer_view,
+      float near_distance = kNearDistance,
+      float far_distance = kFarDistance) {
+    return math::CreateProjectionFov(layer_view.fov, near_distance, far_distance);
+  }
+
+  [[nodiscard]] static glm::mat4 ComputeViewProjection(
+      const XrCompositionLayerProjectionView &layer_view,
+      float near_distance = kNearDistance,
+      float far_distance = kFarDistance) {
+    glm::mat4 proj = ComputeProjection(layer_view, near_distance, far_distance);
+    glm::mat4 view = math::InvertRigidBody(
+        glm::translate(glm::identity<glm::mat4>(), math::XrVector3FToGlm(layer_view.pose.position))
+            * glm::mat4_cast(math::XrQuaternionFToGlm(layer_view.pose.orientation))
+    );
+    return proj * view;
+  }
+
+  // Between the views and covering the fields of view of all of them, at the pixel density of the
+  // first. The views are taken as parallel, as the displays of the supported headsets are.
+  [[nodiscard]] static XrCompositionLayerProjectionView ComputeCenterView(
+      const std::vector<XrCompositionLayerProjectionView> &layer_views) {
+    XrCompositionLayerProjectionView center = layer_views.at(0);
+    glm::vec3 position(0.0f);
+    for (const auto &layer_view: layer_views) {
+      position += math::XrVector3FToGlm(layer_view.pose.position) / float(layer_views.size());
+      center.fov.angleLeft = std::min(center.fov.angleLeft, layer_view.fov.angleLeft);
+      center.fov.angleRight = std::max(center.fov.angleRight, layer_view.fov.angleRight);
+      center.fov.angleUp = std::max(center.fov.angleUp, layer_view.fov.angleUp);
+      center.fov.angleDown = std::min(center.fov.angleDown, layer_view.fov.angleDown);
+    }
+    center.pose.position = {position.x, position.y, position.z};
+    const XrFovf &kFov = layer_views[0].fov;
+    const XrExtent2Di &kExtent = layer_views[0].subImage.imageRect.extent;
+    center.subImage.imageRect = {
+        {0, 0},
+        {static_cast<int32_t>(std::lround(
+            kExtent.width * (std::tan(center.fov.angleRight) - std::tan(center.fov.angleLeft))
+                / (std::tan(kFov.angleRight) - std::tan(kFov.angleLeft)))),
+         static_cast<int32_t>(std::lround(
+             kExtent.height * (std::tan(center.fov.angleUp) - std::tan(center.fov.angleDown))
+                 / (std::tan(kFov.angleUp) - std::tan(kFov.angleDown))))},
+    };
+    return center;
+  }
+
+  [[nodiscard]] LayerContent GetLayerContent(XrSwapchainImageBaseHeader *images) const {
+    auto it = layer_contents_.find(images);
+    return it != layer_contents_.end() ? it->second : LayerContent::ALL;
+  }
+
+  // Whether a bounding sphere lies wholly before or behind a depth range, depth being the clip
+  // space w of its center.
+  [[nodiscard]] static bool IsOutsideDepthRange(float depth,
+                                                float radius,
+                                                float near_distance,
+                                                float far_distance) {
+    return depth + radius <= near_distance || depth - radius >= far_distance;
+  }
+
+  // The mask is only drawn once the runtime reported a mesh, first_view is ignored by multiview.
+  [[nodiscard]] std::optional<HiddenAreaPass> MakeHiddenAreaPass(
+      uint32_t first_view,
+      const std::vector<XrCompositionLayerProjectionView> &layer_views) const {
+    if (hidden_area_mask_ == nullptr || hidden_area_mask_->IsEmpty()) {
+      return std::nullopt;
+    }
+    HiddenAreaPass pass{.mask = hidden_area_mask_, .view_index = first_view};
+    for (const auto &layer_view: layer_views) {
+      pass.projections.push_back(ComputeProjection(layer_view));
+    }
+    return pass;
+  }
+
+  // Motion vectors and depth of the cubes within the depth range of the views, when the runtime
+  // synthesizes this frame's successor from those of swapchain_images. Cubes are matched to the previous frame by
+  // index, so a frame where some came or went is taken as standing still.
+  void RenderSpaceWarp(XrSwapchainImageBaseHeader *swapchain_images,
+                       const std::vector<glm::mat4> &view_projections,
+                       const std::vector<math::Transform> &cube_transforms) {
+    frame_cube_transforms_ = cube_transforms;
+    auto space_warp_it = image_to_space_warp_mapping_.find(swapchain_images);
+    if (space_warp_it == image_to_space_warp_mapping_.end()
+        || !space_warp_it->second->HasImageIndices()) {
+      return;
+    }
+    const auto [kViewNearDistance, kViewFarDistance] = GetDepthRange(swapchain_images);
+    const bool kSameCubes = previous_cube_transforms_.size() == cube_transforms.size();
+    std::vector<MotionVectorDraw> draws{};
+    for (size_t i = 0; i < cube_transforms.size(); i++) {
+      const math::Transform &cube = cube_transforms[i];
+      const float kScale = std::max({cube.scale.x, cube.scale.y, cube.scale.z});
+      bool outside = true;
+      for (const glm::mat4 &view_projection: view_projections) {
+        outside = outside && IsOutsideDepthRange(
+            (view_projection * glm::vec4(cube.position, 1.0f)).w,
+            kCubeRadius * kScale,
+            kViewNearDistance,
+            kViewFarDistance);
+      }
+      if (outside) {
+        continue;
+      }
+      glm::mat4 model = ComputeModel(cube);
+      glm::mat4 previous_model = kSameCubes ? ComputeModel(previous_cube_transforms_[i]) : model;
+      if (!multiview_enabled_) {
+        model = view_projections[0] * model;
+        previous_model = view_projections[0] * previous_model;
+      }
+      // The same LOD as the color pass, so the synthesized frames match the rendered depth.
+      const vulkan::GeometryPoolLod &kLod = cube_lods_[frame_lods_[i]];
+      draws.push_back({model, previous_model, kLod.first_index, kLod.index_count});
+    }
+    frame_submitter_->AddCommandBuffer(space_warp_it->second->Draw(frame_index_, draws));
+  }
+
+  [[nodiscard]] glm::mat4 ComputeModel(const math::Transform &cube) const {
+    return glm::scale(glm::translate(glm::identity<glm::mat4>(), cube.position)
+                          * glm::mat4_cast(cube.orientation), cube.scale)
+        * cube_dequantization_;
+  }
+
   XrGraphicsBindingVulkan2KHR graphics_binding_{};
 
   VkInstance vulkan_instance_ = VK_NULL_HANDLE;
   VkDebugUtilsMessengerEXT debug_messenger_ = VK_NULL_HANDLE;
   VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
+  VkPhysicalDeviceFeatures enabled_features_{};
+  bool buffer_device_address_enabled_ = false;
+  bool multiview_enabled_ = false;
+  bool fragment_density_map_supported_ = false;
+  bool fragment_density_map_enabled_ = false;
+  FoveationTiles foveation_tiles_ = GetFoveationTiles(FoveationLevel::OFF);
 
   std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_ = nullptr;
   std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline_ = nullptr;
+  std::shared_ptr<vulkan::VulkanRenderingPipeline> depth_pipeline_ = nullptr;
+  std::shared_ptr<vulkan::VulkanBuffer> view_projection_buffer_ = nullptr;
+  std::shared_ptr<VulkanMeshletCuller> meshlet_culler_ = nullptr;
+  std::shared_ptr<VulkanHiddenAreaMask> hidden_area_mask_ = nullptr;
+  std::shared_ptr<VulkanFarFieldRenderer> far_field_ = nullptr;
+  std::vector<vulkan::GeometryPoolLod> cube_lods_{};
+  std::vector<LodLevel> cube_lod_levels_{};
+  glm::mat4 cube_dequantization_ = glm::identity<glm::mat4>();
+  // Scene geometry the space warp passes draw the position stream of.
+  vulkan::VertexBufferLayout position_layout_ = vulkan::VertexBufferLayout();
+  std::shared_ptr<vulkan::VulkanBuffer> cube_position_buffer_ = nullptr;
+  std::shared_ptr<vulkan::VulkanBuffer> cube_index_buffer_ = nullptr;
+  vulkan::DataType cube_index_type_ = vulkan::DataType::UINT_16;
+  // Cubes of the frame being rendered and of the one before it, matched by index.
+  std::vector<math::Transform> frame_cube_transforms_{};
+  std::vector<math::Transform> previous_cube_transforms_{};
+  LodSelector lod_selector_{kLodPixelThreshold};
+  // LOD of every object of the current frame, from SelectLods.
+  std::vector<uint32_t> frame_lods_{};
+  uint64_t frame_count_ = 0;
+  std::shared_ptr<VulkanFrameSubmitter> frame_submitter_ = nullptr;
+  uint32_t frame_index_ = 0;
+  std::shared_ptr<vulkan::VulkanRenderingPipeline> pulling_pipeline_ = nullptr;
+  std::shared_ptr<vulkan::VulkanGeometryPool> geometry_pool_ = nullptr;
+  uint32_t cube_mesh_id_ = 0;
+
+  RenderQueue render_queue_{};
+  vulkan::BindStatistics far_field_bind_statistics_{};
+  std::vector<DrawCommand> draw_commands_{};
 
   VkDevice logical_device_ = VK_NULL_HANDLE;
   uint32_t graphics_queue_family_index_ = 0;
+  uint32_t timestamp_valid_bits_ = 0;
   VkQueue graphic_queue_ = VK_NULL_HANDLE;
   VkCommandPool graphics_command_pool_ = VK_NULL_HANDLE;
 
   std::map<XrSwapchainImageBaseHeader *, std::shared_ptr<VulkanSwapchainContext>>
       image_to_context_mapping_{};
+  std::map<XrSwapchainImageBaseHeader *, LayerContent> layer_contents_{};
+  std::map<XrSwapchainImageBaseHeader *, std::shared_ptr<VulkanPanelSwapchain>>
+      image_to_panel_mapping_{};
+  // Keyed by the color images the motion vectors belong to.
+  std::map<XrSwapchainImageBaseHeader *, std::shared_ptr<VulkanSpaceWarpRenderer>>
+      image_to_space_warp_mapping_{};
 };
 }  // namespace
 
@@ -0,0 +1,58 @@
+#include "lod_selector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+constexpr float kMinDistance = 0.001f;
+}
+
+LodSelector::LodSelector(float pixel_threshold, float hysteresis) :
+    pixel_threshold_(pixel_threshold),
+    hysteresis_(hysteresis) {
+}
+
+float LodSelector::ComputeProjectionScale(const XrFovf &fov, uint32_t viewport_width) {
+  return static_cast<float>(viewport_width) / (std::tan(fov.angleRight) - std::tan(fov.angleLeft));
+}
+
+void LodSelector::SetPixelThreshold(float pixel_threshold) {
+  pixel_threshold_ = pixel_threshold;
+}
+
+void LodSelector::BeginFrame() {
+  last_frame_statistics_ = frame_statistics_;
+  frame_statistics_ = {};
+}
+
+uint32_t LodSelector::Select(uint64_t instance_id,
+                             const std::vector<LodLevel> &levels,
+                             float distance,
+                             float object_scale,
+                             float projection_scale) {
+  if (levels.empty()) {
+    throw std::invalid_argument("lod selection needs at least one level");
+  }
+  const float kPixelsPerUnit = object_scale * projection_scale / std::max(distance, kMinDistance);
+  auto pixel_error = [&](uint32_t lod) { return levels[lod].error * kPixelsPerUnit; };
+
+  const auto kLastLod = static_cast<uint32_t>(levels.size() - 1);
+  uint32_t &lod = current_lods_[instance_id];
+  lod = std::min(lod, kLastLod);
+  while (lod > 0 && pixel_error(lod) > pixel_threshold_) {
+    lod--;
+  }
+  while (lod < kLastLod && pixel_error(lod + 1) <= pixel_threshold_ * (1.0f - hysteresis_)) {
+    lod++;
+  }
+
+  frame_statistics_.submitted_triangles += levels[lod].triangle_count;
+  frame_statistics_.full_detail_triangles += levels[0].triangle_count;
+  frame_statistics_.instance_count++;
+  return lod;
+}
+
+const LodStatistics &LodSelector::GetStatistics() const {
+  return last_frame_statistics_;
+}
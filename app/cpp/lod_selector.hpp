@@ -0,0 +1,52 @@
+#pragma once
+
+#include "openxr-include.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct LodLevel {
+  // Object space simplification error of the level.
+  float error;
+  uint32_t triangle_count;
+};
+
+struct LodStatistics {
+  uint64_t submitted_triangles;
+  uint64_t full_detail_triangles;
+  uint32_t instance_count;
+};
+
+// Picks the coarsest LOD whose simplification error projects to less than the pixel threshold on
+// the eye buffer. A coarser LOD is only taken once its error fits the threshold shrunk by the
+// hysteresis factor, so instances close to a switching distance do not pop back and forth.
+class LodSelector {
+ private:
+  float pixel_threshold_;
+  float hysteresis_;
+  std::unordered_map<uint64_t, uint32_t> current_lods_{};
+  LodStatistics frame_statistics_{};
+  LodStatistics last_frame_statistics_{};
+
+ public:
+  explicit LodSelector(float pixel_threshold = 1.0f, float hysteresis = 0.25f);
+
+  // Pixels covered by one object space unit at unit distance along the view direction.
+  static float ComputeProjectionScale(const XrFovf &fov, uint32_t viewport_width);
+
+  // Takes effect with the next selection, the hysteresis carries over.
+  void SetPixelThreshold(float pixel_threshold);
+
+  void BeginFrame();
+
+  // instance_id has to stay stable across frames for the hysteresis to work.
+  uint32_t Select(uint64_t instance_id,
+                  const std::vector<LodLevel> &levels,
+                  float distance,
+                  float object_scale,
+                  float projection_scale);
+
+  // Statistics of the last completed frame.
+  [[nodiscard]] const LodStatistics &GetStatistics() const;
+};
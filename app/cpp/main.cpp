@@ -5,12 +5,14 @@
 #include "platform_data.hpp"
 #include "platform.hpp"
 
+#include "openxr_extensions.hpp"
 #include "openxr_program.hpp"
 
 #include <spdlog/sinks/android_sink.h>
 #include <spdlog/spdlog.h>
 
 #include <unistd.h>
+#include <vector>
 
 #include "openxr_wrapper/graphics_plugin/graphics_plugin_vulkan.h"
 #include "application.h"
@@ -22,6 +24,9 @@
 #include "openxr_wrapper/space/space.h"
 #include "openxr_wrapper/util/check.h"
 
+// Interval the runtime's events are polled at while the session is idle.
+constexpr int kIdlePollMilliseconds = 100;
+
 struct AndroidAppState {
   bool resumed = false;
 };
@@ -75,12 +80,28 @@ class VrApp {
  public:
   VrApp() = default;
 
+  ~VrApp() {
+    // Swapchains have to go before the session.
+    if (_skyboxSwapchain != XR_NULL_HANDLE) {
+      xrDestroySwapchain(_skyboxSwapchain);
+    }
+  }
+
   Status init(void* applicationVm, void* applicationActivity, AAssetManager* assetManager) {
     xrw::AndroidData data = {applicationVm, applicationActivity};
     _platform = std::make_unique<xrw::AndroidPlatform>(data);
     _graphicsPlugin = std::make_unique<xrw::VulkanApplication>(debugCallback, assetManager, std::make_unique<AndroidFileLoader>(assetManager));
 
-    ASSIGN_OR_RETURN(_instance, xrw::Instance::create("BejzakEngine", *_platform, *_graphicsPlugin));
+    // Without the cube layer the skybox stays rasterized into the eye buffers.
+    std::vector<const char*> extensions;
+    const bool skyboxLayerAvailable = kUseSkyboxLayer &&
+        IsInstanceExtensionAvailable(XR_KHR_COMPOSITION_LAYER_CUBE_EXTENSION_NAME);
+    if (skyboxLayerAvailable) {
+      extensions.push_back(XR_KHR_COMPOSITION_LAYER_CUBE_EXTENSION_NAME);
+    }
+    spdlog::info("Skybox cube layer {}", skyboxLayerAvailable ? "enabled" : "unsupported");
+
+    ASSIGN_OR_RETURN(_instance, xrw::Instance::create("BejzakEngine", *_platform, *_graphicsPlugin, extensions));
     ASSIGN_OR_RETURN(_system, xrw::System::create(*_instance));
     RETURN_IF_ERROR(_graphicsPlugin->initialize(_instance->getXrInstance(), _system->getXrSystemId()));
     ASSIGN_OR_RETURN(_session, xrw::Session::create(*_system, *_graphicsPlugin));
@@ -89,6 +110,12 @@ class VrApp {
         .withViewConfigType(kConfigType)
         .build(*_session, *_graphicsPlugin));
     RETURN_IF_ERROR(_graphicsPlugin->createResources());
+    if (skyboxLayerAvailable) {
+      ASSIGN_OR_RETURN(_skyboxSwapchain, _graphicsPlugin->createSkyboxSwapchain(_session->getXrSession()));
+      if (_skyboxSwapchain == XR_NULL_HANDLE) {
+        spdlog::warn("No swapchain format for the skybox cube layer, the skybox stays rasterized");
+      }
+    }
     ASSIGN_OR_RETURN(_space,  xrw::Space::create(_session->getXrSession(),
                                                  XR_REFERENCE_SPACE_TYPE_LOCAL));
     return StatusOk();
@@ -189,6 +216,26 @@ class VrApp {
     return _sessionRunning;
   }
 
+  // Releases the GPU copies of the assets while the app is in the background, the instance,
+  // session and device stay. Frames rendered meanwhile only submit the loading layer.
+  Status suspend() {
+    if (_suspended) {
+      return StatusOk();
+    }
+    _suspended = true;
+    _restorePending = false;
+    return _graphicsPlugin->releaseResources();
+  }
+
+  // The assets are uploaded again after the next frame, which only submits the loading layer.
+  void resume() {
+    if (!_suspended) {
+      return;
+    }
+    _suspended = false;
+    _restorePending = true;
+  }
+
   Status renderFrame() {
     if (_session->getXrSession() == XR_NULL_HANDLE) {
       throw std::runtime_error("session can not be null");
@@ -211,9 +258,28 @@ class VrApp {
     XrCompositionLayerProjection layer{
         .type = XR_TYPE_COMPOSITION_LAYER_PROJECTION,
     };
+    XrCompositionLayerCubeKHR skybox_layer{
+        .type = XR_TYPE_COMPOSITION_LAYER_CUBE_KHR,
+        .space = _space->getXrSpace(),
+        .eyeVisibility = XR_EYE_VISIBILITY_BOTH,
+        .swapchain = _skyboxSwapchain,
+        .imageArrayIndex = 0,
+        .orientation = {0.0f, 0.0f, 0.0f, 1.0f},
+    };
     std::vector<XrCompositionLayerProjectionView> projection_layer_views{};
-    if (frame_state.shouldRender == XR_TRUE) {
+    // Without the assets, released while paused and until restored, the sky or nothing without its
+    // layer stands in for the scene. The session can keep running through both.
+    if (frame_state.shouldRender == XR_TRUE && (_suspended || _restorePending)) {
+      if (_skyboxSwapchain != XR_NULL_HANDLE) {
+        layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader *>(&skybox_layer));
+      }
+    } else if (frame_state.shouldRender == XR_TRUE) {
        if (renderLayer(frame_state.predictedDisplayTime, projection_layer_views, layer)) {
+         // The sky goes below, the eye buffers are blended over it.
+         if (_skyboxSwapchain != XR_NULL_HANDLE) {
+           layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader *>(&skybox_layer));
+           layer.layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT;
+         }
          layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader *>(&layer));
        }
     }
@@ -225,6 +291,12 @@ class VrApp {
     frame_end_info.layerCount = static_cast<uint32_t>(layers.size());
     frame_end_info.layers = layers.data();
     CHECK_XRCMD(xrEndFrame(_session->getXrSession(), &frame_end_info));
+
+    // Between xrEndFrame and the next xrWaitFrame nothing else submits to the graphics queue.
+    if (_restorePending) {
+      RETURN_IF_ERROR(_graphicsPlugin->restoreResources());
+      _restorePending = false;
+    }
     return StatusOk();
   }
 
@@ -359,18 +431,25 @@ class VrApp {
 
  private:
   std::unique_ptr<xrw::Platform> _platform;
-  std::unique_ptr<xrw::GraphicsPlugin> _graphicsPlugin;
+  std::unique_ptr<xrw::VulkanApplication> _graphicsPlugin;
 
   std::unique_ptr<xrw::Instance> _instance;
   std::unique_ptr<xrw::System> _system;
   std::unique_ptr<xrw::Session> _session;
   std::vector<xrw::Swapchain> _swapchains;
   std::unique_ptr<xrw::Space> _space;
+  // Static cube swapchain of the skybox, null while it is rasterized.
+  XrSwapchain _skyboxSwapchain = XR_NULL_HANDLE;
+  // Set by resume until renderFrame uploaded the assets again.
+  bool _restorePending = false;
+  bool _suspended = false;
 
   XrEventDataBuffer _eventDataBuffer;
   XrSessionState _sessionState; // MaybeLocal
   bool _sessionRunning = false;
   static constexpr inline XrViewConfigurationType kConfigType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+  // Hand the skybox to the compositor as a cube layer when the runtime supports it.
+  static constexpr inline bool kUseSkyboxLayer = true;
   InputState _input;
 };
 
@@ -407,9 +486,10 @@ void android_main(struct android_app *app) {
         spdlog::warn("BEJZAK");
         int events;
         struct android_poll_source *source;
-        const int kTimeoutMilliseconds =
-            (!app_state.resumed && !application.isSessionRunning() &&
-                app->destroyRequested == 0) ? -1 : 0;
+        // Without a running session there is nothing to render: paused it blocks until the next
+        // command, resumed it only wakes up to poll the runtime's events.
+        const int kTimeoutMilliseconds = application.isSessionRunning() || app->destroyRequested != 0
+                                         ? 0 : (app_state.resumed ? kIdlePollMilliseconds : -1);
         if (ALooper_pollOnce(kTimeoutMilliseconds, nullptr, &events, (void **) &source) < 0) {
           break;
         }
@@ -418,13 +498,23 @@ void android_main(struct android_app *app) {
         }
       }
 
+      // The assets follow the activity, released while paused and restored after.
+      if (app_state.resumed) {
+        application.resume();
+      } else if (!application.suspend()) {
+        spdlog::error("Releasing the assets failed, they stay resident");
+      }
+
       application.pollEvents();
       if (!application.isSessionRunning()) {
         continue;
       }
 
       application.pollActions();
-      application.renderFrame();
+      // Also reports a failed upload of the assets after a resume, which is retried next frame.
+      if (!application.renderFrame()) {
+        spdlog::error("Rendering a frame failed");
+      }
     }
 
     app->activity->vm->DetachCurrentThread();
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Whether the runtime offers the instance extension, answerable before an instance exists. Free
+// of the CHECK_XRCMD of openxr_utils.hpp, so it also fits next to the engine's wrappers.
+bool IsInstanceExtensionAvailable(const std::string &extension_name);
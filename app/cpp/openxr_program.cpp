@@ -10,7 +10,10 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
+#include <optional>
+#include <utility>
 #include <vector>
 
 static inline XrVector3f XrVector3f_Zero() {
@@ -52,6 +55,51 @@ XrPosef RotateCCWAboutYAxis(float radians, XrVector3f translation) {
 }  // namespace Math::Pose
 
 namespace {
+// Lowest dynamic resolution, relative to the recommended image rect.
+constexpr float kMinResolutionScale = 0.5f;
+// Render what lies beyond the renderer's split distance into a projection layer of its own below
+// the main one, at kBackgroundResolutionScale of the recommended size and only every
+// kBackgroundFrameInterval frames. The compositor reprojects it in between.
+constexpr bool kUseBackgroundLayer = false;
+constexpr float kBackgroundResolutionScale = 0.5f;
+constexpr uint64_t kBackgroundFrameInterval = 2;
+// Submit the eye depth with the projection layers when the runtime supports it, so the
+// compositor can reproject positionally instead of only rotationally.
+constexpr bool kUseDepthLayer = true;
+// Render at half the display rate and let the runtime synthesize every other frame from motion
+// vectors and depth (XR_FB_space_warp), but only while the GPU time exceeds the display period at
+// the lowest resolution scale. Lighter scenes keep the full rate.
+constexpr bool kUseSpaceWarp = true;
+// Frames in a row the load has to stay over the period to engage space warp, or under
+// kSpaceWarpReleaseLoad of it to release it again.
+constexpr uint32_t kSpaceWarpSwitchFrames = 30;
+constexpr double kSpaceWarpReleaseLoad = 0.75;
+// Switch between the display refresh rates of XR_FB_display_refresh_rate to the highest one the
+// frames reliably fit into.
+constexpr bool kUseRefreshRateControl = true;
+// Ask for CPU and GPU performance levels by workload and trade quality for headroom on the
+// runtime's XR_EXT_performance_settings warnings before it throttles.
+constexpr bool kUsePerformanceSettings = true;
+
+XrFoveationLevelFB ToXrFoveationLevel(FoveationLevel level) {
+  switch (level) {
+    case FoveationLevel::LOW:
+      return XR_FOVEATION_LEVEL_LOW_FB;
+    case FoveationLevel::MEDIUM:
+      return XR_FOVEATION_LEVEL_MEDIUM_FB;
+    case FoveationLevel::HIGH:
+      return XR_FOVEATION_LEVEL_HIGH_FB;
+    case FoveationLevel::OFF:
+    default:
+      return XR_FOVEATION_LEVEL_NONE_FB;
+  }
+}
+
+XrDuration GetNanosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
 bool EqualsIgnoreCase(const std::string &a, const std::string &b) {
   return std::equal(a.begin(), a.end(),
                     b.begin(), b.end(),
@@ -123,6 +171,60 @@ void OpenXrProgram::CreateInstance() {
                  std::back_inserter(extensions),
                  [](const std::string &ext) { return ext.c_str(); });
 
+  // Optional, without it the whole eye buffer is shaded.
+  visibility_mask_enabled_ = IsInstanceExtensionAvailable(XR_KHR_VISIBILITY_MASK_EXTENSION_NAME);
+  if (visibility_mask_enabled_) {
+    extensions.push_back(XR_KHR_VISIBILITY_MASK_EXTENSION_NAME);
+  }
+  spdlog::info("Visibility mask {}", visibility_mask_enabled_ ? "enabled" : "unsupported");
+
+  // Optional, without it the dynamic spaces are located one by one.
+  locate_spaces_enabled_ = IsInstanceExtensionAvailable(XR_KHR_LOCATE_SPACES_EXTENSION_NAME);
+  if (locate_spaces_enabled_) {
+    extensions.push_back(XR_KHR_LOCATE_SPACES_EXTENSION_NAME);
+  }
+  spdlog::info("Batched space location {}", locate_spaces_enabled_ ? "enabled" : "unsupported");
+
+  depth_layer_enabled_ = kUseDepthLayer
+      && IsInstanceExtensionAvailable(XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
+  if (depth_layer_enabled_) {
+    extensions.push_back(XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
+  }
+
+  space_warp_enabled_ = kUseSpaceWarp
+      && IsInstanceExtensionAvailable(XR_FB_SPACE_WARP_EXTENSION_NAME);
+  if (space_warp_enabled_) {
+    extensions.push_back(XR_FB_SPACE_WARP_EXTENSION_NAME);
+  }
+
+  display_refresh_rate_enabled_ = kUseRefreshRateControl
+      && IsInstanceExtensionAvailable(XR_FB_DISPLAY_REFRESH_RATE_EXTENSION_NAME);
+  if (display_refresh_rate_enabled_) {
+    extensions.push_back(XR_FB_DISPLAY_REFRESH_RATE_EXTENSION_NAME);
+  }
+
+  performance_settings_enabled_ = kUsePerformanceSettings
+      && IsInstanceExtensionAvailable(XR_EXT_PERFORMANCE_SETTINGS_EXTENSION_NAME);
+  if (performance_settings_enabled_) {
+    extensions.push_back(XR_EXT_PERFORMANCE_SETTINGS_EXTENSION_NAME);
+  }
+
+  // Runtime foveation needs all of them, the renderer falls back to tiles otherwise.
+  const std::array<const char *, 4> kFoveationExtensions = {
+      XR_FB_FOVEATION_EXTENSION_NAME,
+      XR_FB_FOVEATION_CONFIGURATION_EXTENSION_NAME,
+      XR_FB_SWAPCHAIN_UPDATE_STATE_EXTENSION_NAME,
+      XR_FB_FOVEATION_VULKAN_EXTENSION_NAME,
+  };
+  fb_foveation_available_ = std::all_of(kFoveationExtensions.begin(),
+                                        kFoveationExtensions.end(),
+                                        [](const char *extension) {
+                                          return IsInstanceExtensionAvailable(extension);
+                                        });
+  if (fb_foveation_available_) {
+    extensions.insert(extensions.end(), kFoveationExtensions.begin(), kFoveationExtensions.end());
+  }
+
   XrInstanceCreateInfo create_info{};
   create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
   create_info.next = platform_->GetInstanceCreateExtension();
@@ -157,7 +259,50 @@ void OpenXrProgram::InitializeSystem() {
 
   LogViewConfigurations(instance_, system_id_);
 
+  if (space_warp_enabled_) {
+    space_warp_properties_.type = XR_TYPE_SYSTEM_SPACE_WARP_PROPERTIES_FB;
+    XrSystemProperties system_properties{};
+    system_properties.type = XR_TYPE_SYSTEM_PROPERTIES;
+    system_properties.next = &space_warp_properties_;
+    CHECK_XRCMD(xrGetSystemProperties(instance_, system_id_, &system_properties));
+    spdlog::info("Space warp motion vectors: Width={} Height={}",
+                 space_warp_properties_.recommendedMotionVectorImageRectWidth,
+                 space_warp_properties_.recommendedMotionVectorImageRectHeight);
+  }
+
+  if (visibility_mask_enabled_) {
+    CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                      "xrGetVisibilityMaskKHR",
+                                      reinterpret_cast<PFN_xrVoidFunction *>(
+                                          &xr_get_visibility_mask_khr_)));
+  }
+
+  if (locate_spaces_enabled_) {
+    CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                      "xrLocateSpacesKHR",
+                                      reinterpret_cast<PFN_xrVoidFunction *>(
+                                          &xr_locate_spaces_khr_)));
+  }
+
   graphics_plugin_->InitializeDevice(instance_, system_id_);
+
+  fb_foveation_enabled_ = fb_foveation_available_
+      && graphics_plugin_->IsFragmentDensityMapSupported();
+  if (fb_foveation_enabled_) {
+    graphics_plugin_->UseFragmentDensityMap();
+    CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                      "xrCreateFoveationProfileFB",
+                                      reinterpret_cast<PFN_xrVoidFunction *>(
+                                          &xr_create_foveation_profile_fb_)));
+    CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                      "xrDestroyFoveationProfileFB",
+                                      reinterpret_cast<PFN_xrVoidFunction *>(
+                                          &xr_destroy_foveation_profile_fb_)));
+    CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                      "xrUpdateSwapchainFB",
+                                      reinterpret_cast<PFN_xrVoidFunction *>(
+                                          &xr_update_swapchain_fb_)));
+  }
 }
 
 void OpenXrProgram::InitializeSession() {
@@ -177,14 +322,135 @@ void OpenXrProgram::InitializeSession() {
     CHECK_XRCMD(xrCreateSession(instance_, &create_info, &session_));
   }
   LogReferenceSpaces(session_);
+  if (display_refresh_rate_enabled_) {
+    InitializeRefreshRates();
+  }
+  if (performance_settings_enabled_) {
+    CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                      "xrPerfSettingsSetPerformanceLevelEXT",
+                                      reinterpret_cast<PFN_xrVoidFunction *>(
+                                          &xr_perf_settings_set_performance_level_ext_)));
+    // Boosted until the first frame, the swapchains and pipelines are still to be created.
+    ApplyPerformanceLevels();
+  }
   InitializeActions();
-  CreateVisualizedSpaces();
 
   {
     XrReferenceSpaceCreateInfo
         reference_space_create_info = GetXrReferenceSpaceCreateInfo("Local");
     CHECK_XRCMD(xrCreateReferenceSpace(session_, &reference_space_create_info, &app_space_));
   }
+  space_locator_ = std::make_shared<SpaceLocator>(session_, app_space_, xr_locate_spaces_khr_);
+  for (auto hand: {side::LEFT, side::RIGHT}) {
+    hand_locator_indices_[hand] = space_locator_->AddSpace(input_.hand_space[hand]);
+  }
+  CreateVisualizedSpaces();
+}
+
+void OpenXrProgram::InitializeRefreshRates() {
+  PFN_xrEnumerateDisplayRefreshRatesFB xr_enumerate_display_refresh_rates_fb = nullptr;
+  PFN_xrGetDisplayRefreshRateFB xr_get_display_refresh_rate_fb = nullptr;
+  CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                    "xrEnumerateDisplayRefreshRatesFB",
+                                    reinterpret_cast<PFN_xrVoidFunction *>(
+                                        &xr_enumerate_display_refresh_rates_fb)));
+  CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                    "xrGetDisplayRefreshRateFB",
+                                    reinterpret_cast<PFN_xrVoidFunction *>(
+                                        &xr_get_display_refresh_rate_fb)));
+  CHECK_XRCMD(xrGetInstanceProcAddr(instance_,
+                                    "xrRequestDisplayRefreshRateFB",
+                                    reinterpret_cast<PFN_xrVoidFunction *>(
+                                        &xr_request_display_refresh_rate_fb_)));
+
+  uint32_t rate_count = 0;
+  CHECK_XRCMD(xr_enumerate_display_refresh_rates_fb(session_, 0, &rate_count, nullptr));
+  std::vector<float> refresh_rates(rate_count);
+  CHECK_XRCMD(xr_enumerate_display_refresh_rates_fb(session_,
+                                                    rate_count,
+                                                    &rate_count,
+                                                    refresh_rates.data()));
+  refresh_rates.resize(rate_count);
+  CHECK_XRCMD(xr_get_display_refresh_rate_fb(session_, &requested_refresh_rate_));
+  refresh_rate_controller_ = RefreshRateController(refresh_rates, requested_refresh_rate_);
+  for (float refresh_rate: refresh_rates) {
+    spdlog::info("Display refresh rate {} Hz", refresh_rate);
+  }
+  spdlog::info("Running at {} Hz", requested_refresh_rate_);
+}
+
+void OpenXrProgram::UpdateRefreshRate(XrDuration gpu_frame_time, XrDuration display_period) {
+  if (xr_request_display_refresh_rate_fb_ == nullptr) {
+    return;
+  }
+  // Unfocused frames are lighter and paced at the lowest rate, they say nothing about the scene.
+  // The controller only measures focused ones and resumes from its last rate, which the first
+  // windows after focus returns confirm or drop.
+  const float kControllerRate = quality_policy_.IsFocused()
+                                ? refresh_rate_controller_.Update(cpu_frame_time_,
+                                                                  gpu_frame_time,
+                                                                  display_period)
+                                : refresh_rate_controller_.GetRefreshRate();
+  const float kRefreshRate = quality_settings_.lowest_refresh_rate
+                             ? refresh_rate_controller_.GetLowestRefreshRate() : kControllerRate;
+  if (kRefreshRate == requested_refresh_rate_) {
+    return;
+  }
+  spdlog::info("Requesting display refresh rate {} -> {} Hz",
+               requested_refresh_rate_,
+               kRefreshRate);
+  CHECK_XRCMD(xr_request_display_refresh_rate_fb_(session_, kRefreshRate));
+  requested_refresh_rate_ = kRefreshRate;
+}
+
+void OpenXrProgram::UpdateSpaceWarp(XrDuration gpu_frame_time, XrDuration display_period) {
+  if (space_warp_swapchains_.empty() || gpu_frame_time <= 0 || display_period <= 0) {
+    return;
+  }
+  // While engaged the frames may be paced at twice the period, the release is measured against the
+  // one that engaged it.
+  const bool kSwitch = space_warp_active_
+                       ? gpu_frame_time < kSpaceWarpReleaseLoad
+                           * static_cast<double>(space_warp_display_period_)
+                       : gpu_frame_time > display_period && resolution_controller_.IsAtMinScale();
+  space_warp_switch_frames_ = kSwitch ? space_warp_switch_frames_ + 1 : 0;
+  if (space_warp_switch_frames_ < kSpaceWarpSwitchFrames) {
+    return;
+  }
+  space_warp_active_ = !space_warp_active_;
+  space_warp_display_period_ = display_period;
+  space_warp_switch_frames_ = 0;
+  spdlog::info("Space warp {}", space_warp_active_ ? "engaged" : "released");
+}
+
+void OpenXrProgram::ApplyPerformanceLevels() {
+  if (xr_perf_settings_set_performance_level_ext_ == nullptr) {
+    return;
+  }
+  for (XrPerfSettingsDomainEXT domain: {XR_PERF_SETTINGS_DOMAIN_CPU_EXT,
+                                        XR_PERF_SETTINGS_DOMAIN_GPU_EXT}) {
+    const XrPerfSettingsLevelEXT kLevel = quality_policy_.GetPerformanceLevel(domain);
+    const auto kRequested = requested_performance_levels_.find(domain);
+    if (kRequested != requested_performance_levels_.end() && kRequested->second == kLevel) {
+      continue;
+    }
+    spdlog::info("Performance level {} {}",
+                 magic_enum::enum_name(domain),
+                 magic_enum::enum_name(kLevel));
+    CHECK_XRCMD(xr_perf_settings_set_performance_level_ext_(session_, domain, kLevel));
+    requested_performance_levels_[domain] = kLevel;
+  }
+}
+
+void OpenXrProgram::ApplyQualitySettings() {
+  quality_settings_ = quality_policy_.GetSettings();
+  spdlog::info("Quality: resolution scale up to {}, foveation at least {}, LOD bias {}",
+               quality_settings_.max_resolution_scale,
+               magic_enum::enum_name(quality_settings_.min_foveation_level),
+               quality_settings_.lod_bias);
+  resolution_controller_.SetMaxScale(quality_settings_.max_resolution_scale);
+  graphics_plugin_->SetLodBias(quality_settings_.lod_bias);
+  ApplyFoveationLevel();
 }
 
 void OpenXrProgram::InitializeActions() {
@@ -353,6 +619,7 @@ void OpenXrProgram::CreateVisualizedSpaces() {
       {"ViewFront", "Local", "Stage", "StageLeft", "StageRight", "StageLeftRotated",
        "StageRightRotated"};
 
+  visualized_space_graph_ = SpaceGraph(space_locator_, app_space_);
   for (const auto &visualized_space: visualized_spaces) {
     XrReferenceSpaceCreateInfo
         reference_space_create_info = GetXrReferenceSpaceCreateInfo(visualized_space);
@@ -360,6 +627,10 @@ void OpenXrProgram::CreateVisualizedSpaces() {
     XrResult res = xrCreateReferenceSpace(session_, &reference_space_create_info, &space);
     if (XR_SUCCEEDED(res)) {
       visualized_spaces_.push_back(space);
+      // The app space is a reference space as well, only the head moves against it.
+      visualized_space_graph_.AddSpace(
+          space,
+          reference_space_create_info.referenceSpaceType != XR_REFERENCE_SPACE_TYPE_VIEW);
     } else {
       spdlog::warn("Failed to create reference space {} with error {}",
                    visualized_space,
@@ -389,6 +660,21 @@ void OpenXrProgram::CreateSwapchains() {
                                           &swapchain_format_count,
                                           swapchain_formats.data()));
   uint32_t swapchain_color_format = graphics_plugin_->SelectSwapchainFormat(swapchain_formats);
+  panel_swapchain_format_ = graphics_plugin_->SelectPanelSwapchainFormat(swapchain_formats);
+  if (depth_layer_enabled_) {
+    depth_swapchain_format_ =
+        graphics_plugin_->SelectDepthSwapchainFormat(swapchain_formats).value_or(0);
+  }
+  spdlog::info("Depth layer {}", depth_swapchain_format_ != 0 ? "enabled" : "unsupported");
+  if (space_warp_enabled_) {
+    const auto kSpaceWarpFormats = graphics_plugin_->SelectSpaceWarpSwapchainFormats(
+        swapchain_formats);
+    if (kSpaceWarpFormats.has_value()) {
+      motion_vector_swapchain_format_ = kSpaceWarpFormats->first;
+      space_warp_depth_swapchain_format_ = kSpaceWarpFormats->second;
+    }
+  }
+  spdlog::info("Space warp {}", motion_vector_swapchain_format_ != 0 ? "enabled" : "unsupported");
 
   if (view_config_type_ != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
     throw std::runtime_error("only stereo is supported");
@@ -410,44 +696,318 @@ void OpenXrProgram::CreateSwapchains() {
                                                 config_views_.data()));
 
   views_.resize(view_count, {XR_TYPE_VIEW});
-  for (const auto &view_config_view: config_views_) {
-    spdlog::info("Creating swapchain with dimensions Width={} Height={} SampleCount={}",
-                 view_config_view.recommendedImageRectWidth,
-                 view_config_view.recommendedImageRectHeight,
-                 view_config_view.recommendedSwapchainSampleCount);
+  for (uint32_t i = 0; i < view_count; i++) {
+    UpdateVisibilityMask(i);
+  }
+
+  // Swapchains are allocated at the largest image rect, every frame renders the part of it the
+  // GPU keeps up with, starting at the recommended size.
+  const XrViewConfigurationView &kConfigView = config_views_[0];
+  const float kRecommendedScale = static_cast<float>(kConfigView.recommendedImageRectWidth)
+      / static_cast<float>(std::max(kConfigView.maxImageRectWidth,
+                                    kConfigView.recommendedImageRectWidth));
+  resolution_controller_ = DynamicResolutionController(kMinResolutionScale * kRecommendedScale,
+                                                       1.0f,
+                                                       kRecommendedScale);
+  if (graphics_plugin_->IsMultiviewEnabled()) {
+    CreateMultiviewSwapchain(swapchain_color_format);
+  } else {
+    CreateViewSwapchains(swapchain_color_format);
+  }
+  if (motion_vector_swapchain_format_ != 0) {
+    const uint32_t kArraySize = graphics_plugin_->IsMultiviewEnabled()
+                                ? static_cast<uint32_t>(config_views_.size()) : 1;
+    for (const Swapchain &swapchain: swapchains_) {
+      CreateSpaceWarpSwapchains(swapchain, kArraySize);
+    }
+  }
+  if (kUseBackgroundLayer) {
+    CreateBackgroundSwapchains(swapchain_color_format);
+  }
+  ApplyQualitySettings();
+}
 
+void OpenXrProgram::CreateViewSwapchains(int64_t swapchain_color_format) {
+  for (const auto &view_config_view: config_views_) {
     XrSwapchainCreateInfo swapchain_create_info{};
     swapchain_create_info.type = XR_TYPE_SWAPCHAIN_CREATE_INFO;
     swapchain_create_info.arraySize = 1;
     swapchain_create_info.format = swapchain_color_format;
-    swapchain_create_info.width = view_config_view.recommendedImageRectWidth;
-    swapchain_create_info.height = view_config_view.recommendedImageRectHeight;
+    swapchain_create_info.width = std::max(view_config_view.maxImageRectWidth,
+                                           view_config_view.recommendedImageRectWidth);
+    swapchain_create_info.height = std::max(view_config_view.maxImageRectHeight,
+                                            view_config_view.recommendedImageRectHeight);
     swapchain_create_info.mipCount = 1;
     swapchain_create_info.faceCount = 1;
     swapchain_create_info.sampleCount = view_config_view.recommendedSwapchainSampleCount;
     swapchain_create_info.usageFlags =
         XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
-    Swapchain swapchain{};
-    swapchain.width = swapchain_create_info.width;
-    swapchain.height = swapchain_create_info.height;
-    CHECK_XRCMD(xrCreateSwapchain(session_, &swapchain_create_info, &swapchain.handle));
+    ChainFoveationCreateInfo(swapchain_create_info);
+    spdlog::info("Creating swapchain with dimensions Width={} Height={} SampleCount={}",
+                 swapchain_create_info.width,
+                 swapchain_create_info.height,
+                 swapchain_create_info.sampleCount);
+    swapchains_.push_back(CreateSwapchain(swapchain_create_info));
+  }
+}
 
-    swapchains_.push_back(swapchain);
+void OpenXrProgram::CreateBackgroundSwapchains(int64_t swapchain_color_format) {
+  // Laid out like the main swapchains at a fixed fraction of the recommended size, dynamic
+  // resolution only scales the foreground.
+  const bool kMultiview = graphics_plugin_->IsMultiviewEnabled();
+  const uint32_t kViewCount = static_cast<uint32_t>(config_views_.size());
+  for (uint32_t i = 0; i < (kMultiview ? 1 : kViewCount); i++) {
+    const XrViewConfigurationView &kConfigView = config_views_[i];
+    XrSwapchainCreateInfo swapchain_create_info{};
+    swapchain_create_info.type = XR_TYPE_SWAPCHAIN_CREATE_INFO;
+    swapchain_create_info.arraySize = kMultiview ? kViewCount : 1;
+    swapchain_create_info.format = swapchain_color_format;
+    swapchain_create_info.width = std::max(1u, static_cast<uint32_t>(std::lround(
+        kConfigView.recommendedImageRectWidth * kBackgroundResolutionScale)));
+    swapchain_create_info.height = std::max(1u, static_cast<uint32_t>(std::lround(
+        kConfigView.recommendedImageRectHeight * kBackgroundResolutionScale)));
+    swapchain_create_info.mipCount = 1;
+    swapchain_create_info.faceCount = 1;
+    swapchain_create_info.sampleCount = kConfigView.recommendedSwapchainSampleCount;
+    swapchain_create_info.usageFlags =
+        XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+    ChainFoveationCreateInfo(swapchain_create_info);
+    spdlog::info("Creating background swapchain with dimensions Width={} Height={} Layers={}",
+                 swapchain_create_info.width,
+                 swapchain_create_info.height,
+                 swapchain_create_info.arraySize);
+    Swapchain swapchain = CreateSwapchain(swapchain_create_info);
+    graphics_plugin_->SetLayerContent(swapchain_images_[swapchain.handle],
+                                      LayerContent::BACKGROUND);
+    background_swapchains_.push_back(swapchain);
+  }
+  for (const Swapchain &swapchain: swapchains_) {
+    graphics_plugin_->SetLayerContent(swapchain_images_[swapchain.handle],
+                                      LayerContent::FOREGROUND);
+  }
+}
 
-    uint32_t image_count;
-    CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain.handle, 0, &image_count, nullptr));
+Swapchain OpenXrProgram::CreateSwapchain(const XrSwapchainCreateInfo &swapchain_create_info) {
+  Swapchain swapchain{};
+  swapchain.width = swapchain_create_info.width;
+  swapchain.height = swapchain_create_info.height;
+  CHECK_XRCMD(xrCreateSwapchain(session_, &swapchain_create_info, &swapchain.handle));
+
+  uint32_t image_count;
+  CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain.handle, 0, &image_count, nullptr));
+
+  XrSwapchainImageBaseHeader *swapchain_images =
+      graphics_plugin_->AllocateSwapchainImageStructs(image_count, swapchain_create_info);
+  CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain.handle,
+                                         image_count,
+                                         &image_count,
+                                         swapchain_images));
+
+  if (depth_swapchain_format_ != 0) {
+    XrSwapchainCreateInfo depth_create_info = swapchain_create_info;
+    depth_create_info.next = nullptr;
+    depth_create_info.format = depth_swapchain_format_;
+    depth_create_info.usageFlags =
+        XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+    Swapchain depth_swapchain = swapchain;
+    CHECK_XRCMD(xrCreateSwapchain(session_, &depth_create_info, &depth_swapchain.handle));
+
+    uint32_t depth_image_count;
+    CHECK_XRCMD(xrEnumerateSwapchainImages(depth_swapchain.handle,
+                                           0,
+                                           &depth_image_count,
+                                           nullptr));
+    XrSwapchainImageBaseHeader *depth_images = graphics_plugin_->AllocateDepthImageStructs(
+        swapchain_images,
+        depth_image_count,
+        depth_create_info);
+    CHECK_XRCMD(xrEnumerateSwapchainImages(depth_swapchain.handle,
+                                           depth_image_count,
+                                           &depth_image_count,
+                                           depth_images));
+    depth_swapchains_.insert(std::make_pair(swapchain.handle, depth_swapchain));
+  }
+  graphics_plugin_->SwapchainImageStructsReady(swapchain_images);
+  swapchain_images_.insert(std::make_pair(swapchain.handle, swapchain_images));
+  return swapchain;
+}
 
-    XrSwapchainImageBaseHeader *swapchain_images =
-        graphics_plugin_->AllocateSwapchainImageStructs(image_count, swapchain_create_info);
-    CHECK_XRCMD(xrEnumerateSwapchainImages(swapchain.handle,
-                                           image_count,
-                                           &image_count,
-                                           swapchain_images));
-    graphics_plugin_->SwapchainImageStructsReady(swapchain_images);
-    swapchain_images_.insert(std::make_pair(swapchain.handle, swapchain_images));
+void OpenXrProgram::ChainDepthInfos(
+    std::vector<XrCompositionLayerProjectionView> &layer_views,
+    std::vector<XrCompositionLayerDepthInfoKHR> &depth_infos) {
+  if (depth_swapchains_.empty()) {
+    return;
+  }
+  depth_infos.resize(layer_views.size());
+  for (size_t i = 0; i < layer_views.size(); i++) {
+    const XrSwapchainSubImage &kColorImage = layer_views[i].subImage;
+    // A cleared depth would pin the whole view to the far plane in the compositor's reprojection.
+    if (!graphics_plugin_->IsDepthKept(swapchain_images_[kColorImage.swapchain])) {
+      continue;
+    }
+    const auto [kNearZ, kFarZ] =
+        graphics_plugin_->GetDepthRange(swapchain_images_[kColorImage.swapchain]);
+    depth_infos[i] = {
+        .type = XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR,
+        .subImage = {
+            .swapchain = depth_swapchains_.at(kColorImage.swapchain).handle,
+            .imageRect = kColorImage.imageRect,
+            .imageArrayIndex = kColorImage.imageArrayIndex,
+        },
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+        .nearZ = kNearZ,
+        .farZ = kFarZ,
+    };
+    layer_views[i].next = &depth_infos[i];
   }
 }
 
+void OpenXrProgram::CreateSpaceWarpSwapchains(const Swapchain &color_swapchain,
+                                              uint32_t array_size) {
+  XrSwapchainCreateInfo motion_vector_create_info{};
+  motion_vector_create_info.type = XR_TYPE_SWAPCHAIN_CREATE_INFO;
+  motion_vector_create_info.arraySize = array_size;
+  motion_vector_create_info.format = motion_vector_swapchain_format_;
+  motion_vector_create_info.width = space_warp_properties_.recommendedMotionVectorImageRectWidth;
+  motion_vector_create_info.height = space_warp_properties_.recommendedMotionVectorImageRectHeight;
+  motion_vector_create_info.mipCount = 1;
+  motion_vector_create_info.faceCount = 1;
+  motion_vector_create_info.sampleCount = 1;
+  motion_vector_create_info.usageFlags =
+      XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+  XrSwapchainCreateInfo depth_create_info = motion_vector_create_info;
+  depth_create_info.format = space_warp_depth_swapchain_format_;
+  depth_create_info.usageFlags =
+      XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+  SpaceWarpSwapchains swapchains{};
+  swapchains.motion_vector.width = static_cast<int32_t>(motion_vector_create_info.width);
+  swapchains.motion_vector.height = static_cast<int32_t>(motion_vector_create_info.height);
+  swapchains.depth = swapchains.motion_vector;
+  CHECK_XRCMD(xrCreateSwapchain(session_,
+                                &motion_vector_create_info,
+                                &swapchains.motion_vector.handle));
+  CHECK_XRCMD(xrCreateSwapchain(session_, &depth_create_info, &swapchains.depth.handle));
+
+  uint32_t motion_vector_image_count;
+  CHECK_XRCMD(xrEnumerateSwapchainImages(swapchains.motion_vector.handle,
+                                         0,
+                                         &motion_vector_image_count,
+                                         nullptr));
+  uint32_t depth_image_count;
+  CHECK_XRCMD(xrEnumerateSwapchainImages(swapchains.depth.handle,
+                                         0,
+                                         &depth_image_count,
+                                         nullptr));
+  const auto [kMotionVectorImages, kDepthImages] = graphics_plugin_->AllocateSpaceWarpImageStructs(
+      swapchain_images_.at(color_swapchain.handle),
+      motion_vector_image_count,
+      motion_vector_create_info,
+      depth_image_count,
+      depth_create_info);
+  CHECK_XRCMD(xrEnumerateSwapchainImages(swapchains.motion_vector.handle,
+                                         motion_vector_image_count,
+                                         &motion_vector_image_count,
+                                         kMotionVectorImages));
+  CHECK_XRCMD(xrEnumerateSwapchainImages(swapchains.depth.handle,
+                                         depth_image_count,
+                                         &depth_image_count,
+                                         kDepthImages));
+  space_warp_swapchains_.insert(std::make_pair(color_swapchain.handle, swapchains));
+}
+
+void OpenXrProgram::ChainSpaceWarpInfos(
+    std::vector<XrCompositionLayerProjectionView> &layer_views) {
+  if (!space_warp_active_ || space_warp_swapchains_.empty()) {
+    return;
+  }
+  space_warp_infos_.resize(layer_views.size());
+  for (size_t i = 0; i < layer_views.size(); i++) {
+    const XrSwapchainSubImage &kColorImage = layer_views[i].subImage;
+    const SpaceWarpSwapchains &kSwapchains = space_warp_swapchains_.at(kColorImage.swapchain);
+    const auto [kNearZ, kFarZ] =
+        graphics_plugin_->GetDepthRange(swapchain_images_[kColorImage.swapchain]);
+    // The whole images cover the field of view of the view, whatever part of the color image is
+    // rendered. The app space stays put, only the objects in it move.
+    const XrRect2Di kImageRect = {
+        {0, 0},
+        {kSwapchains.motion_vector.width, kSwapchains.motion_vector.height},
+    };
+    space_warp_infos_[i] = {
+        .type = XR_TYPE_COMPOSITION_LAYER_SPACE_WARP_INFO_FB,
+        .next = layer_views[i].next,
+        .layerFlags = 0,
+        .motionVectorSubImage = {
+            .swapchain = kSwapchains.motion_vector.handle,
+            .imageRect = kImageRect,
+            .imageArrayIndex = kColorImage.imageArrayIndex,
+        },
+        .appSpaceDeltaPose = XrPosef_Identity(),
+        .depthSubImage = {
+            .swapchain = kSwapchains.depth.handle,
+            .imageRect = kImageRect,
+            .imageArrayIndex = kColorImage.imageArrayIndex,
+        },
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+        .nearZ = kNearZ,
+        .farZ = kFarZ,
+    };
+    layer_views[i].next = &space_warp_infos_[i];
+  }
+}
+
+uint32_t OpenXrProgram::CreateUiPanel(uint32_t width,
+                                     uint32_t height,
+                                     const XrPosef &pose,
+                                     const XrExtent2Df &size) {
+  if (swapchains_.empty()) {
+    throw std::runtime_error("panels must be created after the swapchains");
+  }
+  XrSwapchainCreateInfo swapchain_create_info{};
+  swapchain_create_info.type = XR_TYPE_SWAPCHAIN_CREATE_INFO;
+  swapchain_create_info.arraySize = 1;
+  swapchain_create_info.format = panel_swapchain_format_;
+  swapchain_create_info.width = width;
+  swapchain_create_info.height = height;
+  swapchain_create_info.mipCount = 1;
+  swapchain_create_info.faceCount = 1;
+  swapchain_create_info.sampleCount = 1;
+  swapchain_create_info.usageFlags =
+      XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+  spdlog::info("Creating panel swapchain with dimensions Width={} Height={}", width, height);
+
+  UiPanel panel{};
+  panel.swapchain.width = static_cast<int32_t>(width);
+  panel.swapchain.height = static_cast<int32_t>(height);
+  panel.pose = pose;
+  panel.size = size;
+  CHECK_XRCMD(xrCreateSwapchain(session_, &swapchain_create_info, &panel.swapchain.handle));
+
+  uint32_t image_count;
+  CHECK_XRCMD(xrEnumerateSwapchainImages(panel.swapchain.handle, 0, &image_count, nullptr));
+  XrSwapchainImageBaseHeader *swapchain_images =
+      graphics_plugin_->AllocatePanelImageStructs(image_count, swapchain_create_info);
+  CHECK_XRCMD(xrEnumerateSwapchainImages(panel.swapchain.handle,
+                                         image_count,
+                                         &image_count,
+                                         swapchain_images));
+  swapchain_images_.insert(std::make_pair(panel.swapchain.handle, swapchain_images));
+
+  ui_panels_.push_back(panel);
+  return static_cast<uint32_t>(ui_panels_.size() - 1);
+}
+
+void OpenXrProgram::SetUiPanelPixels(uint32_t panel_id, std::vector<uint32_t> pixels) {
+  UiPanel &panel = ui_panels_.at(panel_id);
+  if (pixels.size() != static_cast<size_t>(panel.swapchain.width) * panel.swapchain.height) {
+    throw std::invalid_argument("panel pixels do not match its swapchain");
+  }
+  panel.pixels = std::move(pixels);
+  panel.dirty = true;
+}
+
 void OpenXrProgram::PollEvents() {
   while (const XrEventDataBaseHeader *event = TryReadNextEvent()) {
     switch (event->type) {
@@ -470,7 +1030,49 @@ void OpenXrProgram::PollEvents() {
         LogActionSourceName(session_, input_.vibrate_action, "Vibrate");
       }
         break;
-      case XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING:
+      case XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR: {
+        const auto &mask_changed =
+            *reinterpret_cast<const XrEventDataVisibilityMaskChangedKHR *>(event);
+        if (mask_changed.session == session_
+            && mask_changed.viewConfigurationType == view_config_type_) {
+          UpdateVisibilityMask(mask_changed.viewIndex);
+        }
+        break;
+      }
+      case XR_TYPE_EVENT_DATA_DISPLAY_REFRESH_RATE_CHANGED_FB: {
+        const auto &rate_changed =
+            *reinterpret_cast<const XrEventDataDisplayRefreshRateChangedFB *>(event);
+        spdlog::info("Display refresh rate changed {} -> {} Hz",
+                     rate_changed.fromDisplayRefreshRate,
+                     rate_changed.toDisplayRefreshRate);
+        break;
+      }
+      case XR_TYPE_EVENT_DATA_PERF_SETTINGS_EXT: {
+        const auto &perf_settings = *reinterpret_cast<const XrEventDataPerfSettingsEXT *>(event);
+        spdlog::warn("Performance settings {} {}: {} -> {}",
+                     magic_enum::enum_name(perf_settings.domain),
+                     magic_enum::enum_name(perf_settings.subDomain),
+                     magic_enum::enum_name(perf_settings.fromLevel),
+                     magic_enum::enum_name(perf_settings.toLevel));
+        quality_policy_.SetNotificationLevel(perf_settings.domain,
+                                             perf_settings.subDomain,
+                                             perf_settings.toLevel);
+        // Less work first, the sustained level then asks for clocks that fit it.
+        ApplyQualitySettings();
+        ApplyPerformanceLevels();
+        break;
+      }
+      case XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING: {
+        const auto &space_change =
+            *reinterpret_cast<const XrEventDataReferenceSpaceChangePending *>(event);
+        spdlog::info("Reference space {} changes at {}",
+                     magic_enum::enum_name(space_change.referenceSpaceType),
+                     space_change.changeTime);
+        if (space_change.session == session_) {
+          visualized_space_graph_.Invalidate(space_change.changeTime);
+        }
+        break;
+      }
       default: {
         spdlog::debug("Ignoring event type {}", magic_enum::enum_name(event->type));
         break;
@@ -509,6 +1111,14 @@ void OpenXrProgram::HandleSessionStateChangedEvent(const XrEventDataSessionState
     return;
   }
   session_state_ = state_changed_event.state;
+  // Input and the user's attention are only there while focused. IDLE needs nothing here: the
+  // session is not running, so the loop stops rendering and sleeps on the looper.
+  const bool kFocused = session_state_ == XR_SESSION_STATE_FOCUSED;
+  if (kFocused != quality_policy_.IsFocused()) {
+    quality_policy_.SetFocused(kFocused);
+    ApplyQualitySettings();
+    ApplyPerformanceLevels();
+  }
   switch (session_state_) {
     case XR_SESSION_STATE_READY: {
       XrSessionBeginInfo session_begin_info{};
@@ -601,6 +1211,10 @@ void OpenXrProgram::RenderFrame() {
       .type = XR_TYPE_FRAME_STATE,
   };
   CHECK_XRCMD(xrWaitFrame(session_, &frame_wait_info, &frame_state));
+  // The CPU time of a frame leaves out every wait on the compositor or the GPU: xrWaitFrame above,
+  // the fence of its frame slot, the swapchain image waits and xrEndFrame.
+  const auto kFrameStart = std::chrono::steady_clock::now();
+  frame_wait_time_ = 0;
 
   XrFrameBeginInfo frame_begin_info{
       .type = XR_TYPE_FRAME_BEGIN_INFO,
@@ -611,10 +1225,47 @@ void OpenXrProgram::RenderFrame() {
   XrCompositionLayerProjection layer{
       .type = XR_TYPE_COMPOSITION_LAYER_PROJECTION,
   };
+  XrCompositionLayerProjection background_layer{
+      .type = XR_TYPE_COMPOSITION_LAYER_PROJECTION,
+  };
   std::vector<XrCompositionLayerProjectionView> projection_layer_views{};
+  std::vector<XrCompositionLayerQuad> quad_layers{};
   if (frame_state.shouldRender == XR_TRUE) {
-    if (RenderLayer(frame_state.predictedDisplayTime, projection_layer_views, layer)) {
+    if (RenderLayer(frame_state.predictedDisplayTime,
+                    frame_state.predictedDisplayPeriod,
+                    projection_layer_views,
+                    layer)) {
+      // Layers are composited in order, the first one at the bottom.
+      if (!background_layer_views_.empty()) {
+        background_layer.space = app_space_;
+        background_layer.viewCount = static_cast<uint32_t>(background_layer_views_.size());
+        background_layer.views = background_layer_views_.data();
+        layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader *>(&background_layer));
+        layer.layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT;
+      }
       layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader *>(&layer));
+
+      for (const UiPanel &panel: ui_panels_) {
+        if (!panel.uploaded) {
+          continue;
+        }
+        quad_layers.push_back({
+            .type = XR_TYPE_COMPOSITION_LAYER_QUAD,
+            .layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT,
+            .space = app_space_,
+            .eyeVisibility = XR_EYE_VISIBILITY_BOTH,
+            .subImage = {
+                .swapchain = panel.swapchain.handle,
+                .imageRect = {{0, 0}, {panel.swapchain.width, panel.swapchain.height}},
+                .imageArrayIndex = 0,
+            },
+            .pose = panel.pose,
+            .size = panel.size,
+        });
+      }
+      for (XrCompositionLayerQuad &quad_layer: quad_layers) {
+        layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader *>(&quad_layer));
+      }
     }
   }
 
@@ -624,10 +1275,123 @@ void OpenXrProgram::RenderFrame() {
   frame_end_info.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
   frame_end_info.layerCount = static_cast<uint32_t>(layers.size());
   frame_end_info.layers = layers.data();
+  const auto kEndFrameStart = std::chrono::steady_clock::now();
   CHECK_XRCMD(xrEndFrame(session_, &frame_end_info));
+  frame_wait_time_ += GetNanosecondsSince(kEndFrameStart);
+  if (quality_policy_.IsLoading() && !layers.empty()) {
+    quality_policy_.SetLoading(false);
+    ApplyPerformanceLevels();
+  }
+  cpu_frame_time_ = GetNanosecondsSince(kFrameStart) - frame_wait_time_;
+}
+
+void OpenXrProgram::CreateMultiviewSwapchain(int64_t swapchain_color_format) {
+  // Every view renders into its own layer of one swapchain, so the layers share the largest size.
+  XrSwapchainCreateInfo swapchain_create_info{};
+  swapchain_create_info.type = XR_TYPE_SWAPCHAIN_CREATE_INFO;
+  swapchain_create_info.arraySize = static_cast<uint32_t>(config_views_.size());
+  swapchain_create_info.format = swapchain_color_format;
+  swapchain_create_info.mipCount = 1;
+  swapchain_create_info.faceCount = 1;
+  swapchain_create_info.sampleCount = config_views_[0].recommendedSwapchainSampleCount;
+  swapchain_create_info.usageFlags =
+      XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+  ChainFoveationCreateInfo(swapchain_create_info);
+  for (const auto &view_config_view: config_views_) {
+    swapchain_create_info.width = std::max({swapchain_create_info.width,
+                                            view_config_view.maxImageRectWidth,
+                                            view_config_view.recommendedImageRectWidth});
+    swapchain_create_info.height = std::max({swapchain_create_info.height,
+                                             view_config_view.maxImageRectHeight,
+                                             view_config_view.recommendedImageRectHeight});
+  }
+  spdlog::info("Creating multiview swapchain with dimensions Width={} Height={} Layers={}",
+               swapchain_create_info.width,
+               swapchain_create_info.height,
+               swapchain_create_info.arraySize);
+  swapchains_.push_back(CreateSwapchain(swapchain_create_info));
+}
+
+void OpenXrProgram::ChainFoveationCreateInfo(XrSwapchainCreateInfo &swapchain_create_info) {
+  if (fb_foveation_enabled_) {
+    swapchain_foveation_info_.type = XR_TYPE_SWAPCHAIN_CREATE_INFO_FOVEATION_FB;
+    swapchain_foveation_info_.flags = XR_SWAPCHAIN_CREATE_FOVEATION_FRAGMENT_DENSITY_MAP_BIT_FB;
+    swapchain_create_info.next = &swapchain_foveation_info_;
+  } else {
+    // The tile fallback upscales its periphery into the swapchain image.
+    swapchain_create_info.usageFlags |= XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+  }
+}
+
+void OpenXrProgram::SetFoveationLevel(FoveationLevel level) {
+  foveation_level_ = level;
+  ApplyFoveationLevel();
+}
+
+void OpenXrProgram::ApplyFoveationLevel() {
+  FoveationLevel level = SelectFoveationLevel(foveation_level_,
+                                              quality_settings_.min_foveation_level);
+  graphics_plugin_->SetFoveationLevel(level);
+  spdlog::info("Foveation level {} through {}",
+               magic_enum::enum_name(level),
+               fb_foveation_enabled_ ? "runtime density map" : "tiles");
+  if (!fb_foveation_enabled_ || swapchains_.empty()) {
+    return;
+  }
+  // Profiles are only needed while they are applied, the swapchains keep their state.
+  XrFoveationLevelProfileCreateInfoFB level_profile_info{};
+  level_profile_info.type = XR_TYPE_FOVEATION_LEVEL_PROFILE_CREATE_INFO_FB;
+  level_profile_info.level = ToXrFoveationLevel(level);
+  level_profile_info.verticalOffset = 0.0f;
+  level_profile_info.dynamic = XR_FOVEATION_DYNAMIC_DISABLED_FB;
+  XrFoveationProfileCreateInfoFB profile_info{};
+  profile_info.type = XR_TYPE_FOVEATION_PROFILE_CREATE_INFO_FB;
+  profile_info.next = &level_profile_info;
+  XrFoveationProfileFB profile = XR_NULL_HANDLE;
+  CHECK_XRCMD(xr_create_foveation_profile_fb_(session_, &profile_info, &profile));
+  for (const auto *swapchains: {&swapchains_, &background_swapchains_}) {
+    for (const Swapchain &swapchain: *swapchains) {
+      XrSwapchainStateFoveationFB foveation_state{};
+      foveation_state.type = XR_TYPE_SWAPCHAIN_STATE_FOVEATION_FB;
+      foveation_state.profile = profile;
+      CHECK_XRCMD(xr_update_swapchain_fb_(
+          swapchain.handle,
+          reinterpret_cast<const XrSwapchainStateBaseHeaderFB *>(&foveation_state)));
+    }
+  }
+  CHECK_XRCMD(xr_destroy_foveation_profile_fb_(profile));
+}
+
+void OpenXrProgram::UpdateVisibilityMask(uint32_t view_index) {
+  if (xr_get_visibility_mask_khr_ == nullptr) {
+    return;
+  }
+  XrVisibilityMaskKHR visibility_mask{};
+  visibility_mask.type = XR_TYPE_VISIBILITY_MASK_KHR;
+  CHECK_XRCMD(xr_get_visibility_mask_khr_(session_,
+                                          view_config_type_,
+                                          view_index,
+                                          XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR,
+                                          &visibility_mask));
+
+  std::vector<XrVector2f> vertices(visibility_mask.vertexCountOutput);
+  std::vector<uint32_t> indices(visibility_mask.indexCountOutput);
+  visibility_mask.vertexCapacityInput = static_cast<uint32_t>(vertices.size());
+  visibility_mask.vertices = vertices.data();
+  visibility_mask.indexCapacityInput = static_cast<uint32_t>(indices.size());
+  visibility_mask.indices = indices.data();
+  CHECK_XRCMD(xr_get_visibility_mask_khr_(session_,
+                                          view_config_type_,
+                                          view_index,
+                                          XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR,
+                                          &visibility_mask));
+  vertices.resize(visibility_mask.vertexCountOutput);
+  indices.resize(visibility_mask.indexCountOutput);
+  graphics_plugin_->SetVisibilityMask(view_index, vertices, indices);
 }
 
 bool OpenXrProgram::RenderLayer(XrTime predicted_display_time,
+                                XrDuration predicted_display_period,
                                 std::vector<XrCompositionLayerProjectionView> &projection_layer_views,
                                 XrCompositionLayerProjection &layer) {
   XrViewState view_state{};
@@ -656,84 +1420,206 @@ bool OpenXrProgram::RenderLayer(XrTime predicted_display_time,
   // For each locatable space that we want to visualize, render a 25cm cube.
   std::vector<math::Transform> cubes{};
 
-  for (XrSpace visualized_space: visualized_spaces_) {
-    XrSpaceLocation space_location{};
-    space_location.type = XR_TYPE_SPACE_LOCATION;
-    auto res = xrLocateSpace(visualized_space, app_space_, predicted_display_time, &space_location);
-    if (XR_UNQUALIFIED_SUCCESS(res)) {
-      if ((space_location.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
-          (space_location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0) {
-        cubes.push_back(math::Transform{
-            math::XrQuaternionFToGlm(space_location.pose.orientation),
-            math::XrVector3FToGlm(space_location.pose.position),
-            {0.25f, 0.25f, 0.25f}});
-      }
-    } else {
-      spdlog::debug("Unable to locate a visualized reference space in app space: {}",
-                    magic_enum::enum_name(res));
+  for (const std::optional<XrPosef> &pose: visualized_space_graph_.Locate(predicted_display_time)) {
+    if (pose.has_value()) {
+      cubes.push_back(math::Transform{
+          math::XrQuaternionFToGlm(pose->orientation),
+          math::XrVector3FToGlm(pose->position),
+          {0.25f, 0.25f, 0.25f}});
     }
   }
 
   // Render a 10cm cube scaled by grab_action for each hand. Note renderHand will only be true when the application has focus.
+  // The visualized spaces above already located the hands along with the head-locked ones.
+  const SpaceLocations &kLocations = space_locator_->Locate(predicted_display_time);
   for (auto hand: {side::LEFT, side::RIGHT}) {
-    XrSpaceLocation space_location{};
-    space_location.type = XR_TYPE_SPACE_LOCATION;
-    auto res =
-        xrLocateSpace(input_.hand_space[hand], app_space_, predicted_display_time, &space_location);
-    if (XR_UNQUALIFIED_SUCCESS(res)) {
-      if ((space_location.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
-          (space_location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0) {
-        float scale = 0.1f * input_.hand_scale[hand];
-        cubes.push_back(math::Transform{
-            math::XrQuaternionFToGlm(space_location.pose.orientation),
-            math::XrVector3FToGlm(space_location.pose.position),
-            {scale, scale, scale}});
-      }
-    } else {
+    const size_t kIndex = hand_locator_indices_[hand];
+    if (kLocations.valid[kIndex] != 0) {
+      float scale = 0.1f * input_.hand_scale[hand];
+      cubes.push_back(math::Transform{
+          math::XrQuaternionFToGlm(kLocations.poses[kIndex].orientation),
+          math::XrVector3FToGlm(kLocations.poses[kIndex].position),
+          {scale, scale, scale}});
+    } else if (input_.hand_active[hand] == XR_TRUE) {
       // Tracking loss is expected when the hand is not active so only log a message if the hand is active.
-      if (input_.hand_active[hand] == XR_TRUE) {
-        const char *hand_name[] = {"left", "right"};
-        spdlog::debug("Unable to locate {} hand action space in app space: {}",
-                      hand_name[hand],
-                      magic_enum::enum_name(res));
-      }
+      const char *hand_name[] = {"left", "right"};
+      spdlog::debug("Unable to locate {} hand action space in app space", hand_name[hand]);
     }
   }
 
-  // Render view to the appropriate part of the swapchain image.
-  for (uint32_t i = 0; i < view_count_output; i++) {
-    Swapchain view_swapchain = swapchains_[i];
+  // Multiview renders every view into the layers of a single swapchain.
+  const bool kMultiview = graphics_plugin_->IsMultiviewEnabled();
+  const uint32_t kSwapchainCount = kMultiview ? 1 : view_count_output;
+  // Frames that skip the background leave its swapchains alone, the compositor keeps showing the
+  // images last released into them.
+  const bool kRenderBackground = !background_swapchains_.empty()
+      && (background_layer_views_.empty()
+          || (quality_settings_.background_updates && frame_count_ % kBackgroundFrameInterval == 0));
+  frame_count_++;
+  std::vector<Swapchain> frame_swapchains = swapchains_;
+  if (kRenderBackground) {
+    frame_swapchains.insert(frame_swapchains.end(),
+                            background_swapchains_.begin(),
+                            background_swapchains_.end());
+  }
+  // Panels only cost a copy in the frames after their content changed.
+  std::vector<UiPanel *> dirty_panels{};
+  for (UiPanel &panel: ui_panels_) {
+    if (panel.dirty) {
+      dirty_panels.push_back(&panel);
+      frame_swapchains.push_back(panel.swapchain);
+    }
+  }
+  const size_t kFirstPanelSwapchain = frame_swapchains.size() - dirty_panels.size();
+  // The projection swapchains rendered this frame write their depth along.
+  std::vector<XrSwapchain> depth_color_swapchains{};
+  const size_t kFirstDepthSwapchain = frame_swapchains.size();
+  for (size_t i = 0; i < kFirstPanelSwapchain; i++) {
+    auto depth_it = depth_swapchains_.find(frame_swapchains[i].handle);
+    if (depth_it != depth_swapchains_.end()) {
+      depth_color_swapchains.push_back(frame_swapchains[i].handle);
+      frame_swapchains.push_back(depth_it->second);
+    }
+  }
 
+  // Waits for the frame slot, which also yields the GPU time of the frame that used it before.
+  const auto kSlotWaitStart = std::chrono::steady_clock::now();
+  graphics_plugin_->BeginFrame();
+  frame_wait_time_ += GetNanosecondsSince(kSlotWaitStart);
+  // Resolution answers the GPU time first, the refresh rate only drops once it can not.
+  const std::optional<XrDuration> kGpuFrameTime = graphics_plugin_->GetGpuFrameTime();
+  if (kGpuFrameTime.has_value()) {
+    resolution_controller_.Update(*kGpuFrameTime, predicted_display_period);
+  }
+  UpdateRefreshRate(kGpuFrameTime.value_or(0), predicted_display_period);
+  UpdateSpaceWarp(kGpuFrameTime.value_or(0), predicted_display_period);
+  const float kResolutionScale = resolution_controller_.GetScale();
+
+  // While engaged the main swapchains also write motion vectors and depth for the runtime's frame
+  // synthesis.
+  const size_t kFirstSpaceWarpSwapchain = frame_swapchains.size();
+  if (space_warp_active_) {
+    for (const auto &[color_swapchain, space_warp_swapchains]: space_warp_swapchains_) {
+      frame_swapchains.push_back(space_warp_swapchains.motion_vector);
+      frame_swapchains.push_back(space_warp_swapchains.depth);
+    }
+  }
+
+  // Acquire all images up front so the views can be recorded while the compositor may still
+  // be reading them, only the single submit has to wait.
+  std::vector<uint32_t> swapchain_image_indices(frame_swapchains.size());
+  for (uint32_t i = 0; i < frame_swapchains.size(); i++) {
     XrSwapchainImageAcquireInfo acquire_info{};
     acquire_info.type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO;
-
-    uint32_t swapchain_image_index = 0;
-    CHECK_XRCMD(xrAcquireSwapchainImage(view_swapchain.handle,
+    CHECK_XRCMD(xrAcquireSwapchainImage(frame_swapchains[i].handle,
                                         &acquire_info,
-                                        &swapchain_image_index));
-
-    XrSwapchainImageWaitInfo wait_info{};
-    wait_info.type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO;
-    wait_info.timeout = XR_INFINITE_DURATION;
-    CHECK_XRCMD(xrWaitSwapchainImage(view_swapchain.handle, &wait_info));
+                                        &swapchain_image_indices[i]));
+  }
+  for (size_t i = 0; i < depth_color_swapchains.size(); i++) {
+    graphics_plugin_->SetDepthImageIndex(swapchain_images_[depth_color_swapchains[i]],
+                                         swapchain_image_indices[kFirstDepthSwapchain + i]);
+  }
+  if (space_warp_active_) {
+    size_t space_warp_swapchain = kFirstSpaceWarpSwapchain;
+    for (const auto &[color_swapchain, space_warp_swapchains]: space_warp_swapchains_) {
+      graphics_plugin_->SetSpaceWarpImageIndices(swapchain_images_[color_swapchain],
+                                                 swapchain_image_indices[space_warp_swapchain],
+                                                 swapchain_image_indices[space_warp_swapchain + 1]);
+      space_warp_swapchain += 2;
+    }
+  }
 
+  for (uint32_t i = 0; i < view_count_output; i++) {
+    Swapchain view_swapchain = swapchains_[kMultiview ? 0 : i];
     projection_layer_views[i].type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW;
     projection_layer_views[i].pose = views_[i].pose;
     projection_layer_views[i].fov = views_[i].fov;
     projection_layer_views[i].subImage.swapchain = view_swapchain.handle;
+    // The renderer takes its viewport from the same rect, so both always agree.
     projection_layer_views[i].subImage.imageRect.offset = {0, 0};
-    projection_layer_views[i].subImage.imageRect.extent =
-        {view_swapchain.width, view_swapchain.height};
+    projection_layer_views[i].subImage.imageRect.extent = {
+        std::max(1, static_cast<int32_t>(std::lround(view_swapchain.width * kResolutionScale))),
+        std::max(1, static_cast<int32_t>(std::lround(view_swapchain.height * kResolutionScale))),
+    };
+    projection_layer_views[i].subImage.imageArrayIndex = kMultiview ? i : 0;
+  }
+  ChainDepthInfos(projection_layer_views, depth_infos_);
+  ChainSpaceWarpInfos(projection_layer_views);
+  graphics_plugin_->SelectLods(projection_layer_views, cubes);
+
+  if (kMultiview) {
+    graphics_plugin_->RenderMultiview(projection_layer_views,
+                                      swapchain_images_[swapchains_[0].handle],
+                                      swapchain_image_indices[0],
+                                      cubes);
+  } else {
+    // The background layer takes the place of the shared far field.
+    if (background_swapchains_.empty()) {
+      graphics_plugin_->RenderFarField(projection_layer_views, cubes);
+    }
+    // Render view to the appropriate part of the swapchain image.
+    for (uint32_t i = 0; i < view_count_output; i++) {
+      graphics_plugin_->RenderView(i,
+                                   projection_layer_views[i],
+                                   swapchain_images_[swapchains_[i].handle],
+                                   swapchain_image_indices[i],
+                                   cubes);
+    }
+  }
+
+  if (kRenderBackground) {
+    // Same poses as the foreground, over the whole of the smaller images.
+    background_layer_views_ = projection_layer_views;
+    for (uint32_t i = 0; i < view_count_output; i++) {
+      Swapchain view_swapchain = background_swapchains_[kMultiview ? 0 : i];
+      background_layer_views_[i].next = nullptr;
+      background_layer_views_[i].subImage.swapchain = view_swapchain.handle;
+      background_layer_views_[i].subImage.imageRect = {
+          {0, 0},
+          {view_swapchain.width, view_swapchain.height},
+      };
+    }
+    ChainDepthInfos(background_layer_views_, background_depth_infos_);
+    if (kMultiview) {
+      graphics_plugin_->RenderMultiview(background_layer_views_,
+                                        swapchain_images_[background_swapchains_[0].handle],
+                                        swapchain_image_indices[kSwapchainCount],
+                                        cubes);
+    } else {
+      for (uint32_t i = 0; i < view_count_output; i++) {
+        graphics_plugin_->RenderView(i,
+                                     background_layer_views_[i],
+                                     swapchain_images_[background_swapchains_[i].handle],
+                                     swapchain_image_indices[kSwapchainCount + i],
+                                     cubes);
+      }
+    }
+  }
 
-    auto swapchain_image = swapchain_images_[view_swapchain.handle];
-    graphics_plugin_->RenderView(projection_layer_views[i],
-                                 swapchain_image,
-                                 swapchain_image_index,
-                                 cubes);
+  for (size_t i = 0; i < dirty_panels.size(); i++) {
+    graphics_plugin_->UploadPanel(swapchain_images_[dirty_panels[i]->swapchain.handle],
+                                  swapchain_image_indices[kFirstPanelSwapchain + i],
+                                  dirty_panels[i]->pixels);
+  }
 
+  const auto kImageWaitStart = std::chrono::steady_clock::now();
+  for (const Swapchain &swapchain: frame_swapchains) {
+    XrSwapchainImageWaitInfo wait_info{};
+    wait_info.type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO;
+    wait_info.timeout = XR_INFINITE_DURATION;
+    CHECK_XRCMD(xrWaitSwapchainImage(swapchain.handle, &wait_info));
+  }
+  frame_wait_time_ += GetNanosecondsSince(kImageWaitStart);
+  graphics_plugin_->EndFrame();
+
+  for (const Swapchain &swapchain: frame_swapchains) {
     XrSwapchainImageReleaseInfo release_info{};
     release_info.type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO;
-    CHECK_XRCMD(xrReleaseSwapchainImage(view_swapchain.handle, &release_info));
+    CHECK_XRCMD(xrReleaseSwapchainImage(swapchain.handle, &release_info));
+  }
+  for (UiPanel *panel: dirty_panels) {
+    panel->dirty = false;
+    panel->uploaded = true;
   }
 
   layer.space = app_space_;
@@ -752,6 +1638,19 @@ OpenXrProgram::~OpenXrProgram() {
   for (Swapchain swapchain: swapchains_) {
     xrDestroySwapchain(swapchain.handle);
   }
+  for (Swapchain swapchain: background_swapchains_) {
+    xrDestroySwapchain(swapchain.handle);
+  }
+  for (const UiPanel &panel: ui_panels_) {
+    xrDestroySwapchain(panel.swapchain.handle);
+  }
+  for (const auto &[color_swapchain, depth_swapchain]: depth_swapchains_) {
+    xrDestroySwapchain(depth_swapchain.handle);
+  }
+  for (const auto &[color_swapchain, space_warp_swapchains]: space_warp_swapchains_) {
+    xrDestroySwapchain(space_warp_swapchains.motion_vector.handle);
+    xrDestroySwapchain(space_warp_swapchains.depth.handle);
+  }
   graphics_plugin_->DeinitDevice();
   for (XrSpace visualized_space: visualized_spaces_) {
     xrDestroySpace(visualized_space);
@@ -2,7 +2,13 @@
 
 #include "platform.hpp"
 
+#include "dynamic_resolution.hpp"
+#include "foveation.hpp"
 #include "graphics_plugin.hpp"
+#include "quality_policy.hpp"
+#include "refresh_rate_controller.hpp"
+#include "space_graph.hpp"
+#include "space_locator.hpp"
 
 #include <array>
 #include <map>
@@ -19,6 +25,24 @@ struct Swapchain {
   int32_t height;
 };
 
+// Motion vectors and depth of a projection swapchain for XR_FB_space_warp.
+struct SpaceWarpSwapchains {
+  Swapchain motion_vector;
+  Swapchain depth;
+};
+
+// 2D content the compositor samples as an XrCompositionLayerQuad from a swapchain of its own,
+// which is only written in the frames after the content changed.
+struct UiPanel {
+  Swapchain swapchain;
+  XrPosef pose;
+  XrExtent2Df size;
+  std::vector<uint32_t> pixels;
+  bool dirty = false;
+  // Panels are submitted once their swapchain holds a released image.
+  bool uploaded = false;
+};
+
 struct InputState {
   XrActionSet action_set = XR_NULL_HANDLE;
   XrAction grab_action = XR_NULL_HANDLE;
@@ -46,14 +70,60 @@ class OpenXrProgram {
 
   bool IsSessionRunning() const;
 
+  // Applied without recreating the swapchains, through the runtime's density map when available.
+  // The quality policy may raise it while the device runs hot.
+  void SetFoveationLevel(FoveationLevel level);
+
+  // Adds a panel of width by height pixels, size meters large at pose in the app space, after
+  // the swapchains are created. Returns the id its content is set with.
+  uint32_t CreateUiPanel(uint32_t width,
+                         uint32_t height,
+                         const XrPosef &pose,
+                         const XrExtent2Df &size);
+
+  // RGBA8 texels row after row, uploaded by the next rendered frame.
+  void SetUiPanelPixels(uint32_t panel_id, std::vector<uint32_t> pixels);
+
   ~OpenXrProgram();
  private:
   void InitializeActions();
+  // Enumerates the display refresh rates and starts the controller at the current one.
+  void InitializeRefreshRates();
+  // Takes the timings of the last completed frame, requests a new rate when the controller picks
+  // one.
+  void UpdateRefreshRate(XrDuration gpu_frame_time, XrDuration display_period);
+  // Engages space warp once the GPU time stays over the display period at the lowest resolution
+  // scale, and releases it once the frames fit again.
+  void UpdateSpaceWarp(XrDuration gpu_frame_time, XrDuration display_period);
+  // Requests the levels the quality policy asks for where they changed.
+  void ApplyPerformanceLevels();
+  // Hands the quality policy's settings to the resolution controller, renderer and foveation.
+  void ApplyQualitySettings();
+  void ApplyFoveationLevel();
   void CreateVisualizedSpaces();
+  void CreateViewSwapchains(int64_t swapchain_color_format);
+  void CreateMultiviewSwapchain(int64_t swapchain_color_format);
+  void CreateBackgroundSwapchains(int64_t swapchain_color_format);
+  // Creates the swapchain and hands its images to the graphics plugin, along with a depth
+  // swapchain of the same layout when the layers are submitted with depth.
+  Swapchain CreateSwapchain(const XrSwapchainCreateInfo &swapchain_create_info);
+  // Points every view at the depth swapchain of its color one, over the same image rect. Views
+  // rendered without depth are left without.
+  void ChainDepthInfos(std::vector<XrCompositionLayerProjectionView> &layer_views,
+                       std::vector<XrCompositionLayerDepthInfoKHR> &depth_infos);
+  // Motion vector and depth swapchains at the runtime's recommended size, laid out like the
+  // projection swapchain they belong to.
+  void CreateSpaceWarpSwapchains(const Swapchain &color_swapchain, uint32_t array_size);
+  // Hands every view's motion vectors and depth to the runtime ahead of its other chained infos.
+  void ChainSpaceWarpInfos(std::vector<XrCompositionLayerProjectionView> &layer_views);
+  void ChainFoveationCreateInfo(XrSwapchainCreateInfo &swapchain_create_info);
+  // Fetches the hidden area mesh of a view, once at startup and again when the runtime changes it.
+  void UpdateVisibilityMask(uint32_t view_index);
 
   const XrEventDataBaseHeader *TryReadNextEvent();
   void HandleSessionStateChangedEvent(const XrEventDataSessionStateChanged &state_changed_event);
   bool RenderLayer(XrTime predicted_display_time,
+                   XrDuration predicted_display_period,
                    std::vector<XrCompositionLayerProjectionView> &projection_layer_views,
                    XrCompositionLayerProjection &layer);
  public:
@@ -69,16 +139,85 @@ class OpenXrProgram {
 
   std::vector<XrSpace> visualized_spaces_{};
   XrSpace app_space_ = XR_NULL_HANDLE;
+  // Dynamic spaces in the app space. Every consumer of a frame shares one batched location at its
+  // display time.
+  std::shared_ptr<SpaceLocator> space_locator_;
+  std::array<size_t, side::COUNT> hand_locator_indices_{};
+  bool locate_spaces_enabled_ = false;
+  PFN_xrLocateSpacesKHR xr_locate_spaces_khr_ = nullptr;
+  // Visualized spaces in the app space, only the head-locked ones are located every frame.
+  SpaceGraph visualized_space_graph_{};
 
   XrViewConfigurationType view_config_type_ = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
   std::vector<XrViewConfigurationView> config_views_;
   std::vector<XrView> views_;
 
+  // Swapchains hold the largest image rect, scaled down per frame to the rendered one.
   std::vector<Swapchain> swapchains_;
+  DynamicResolutionController resolution_controller_{};
   std::map<XrSwapchain, XrSwapchainImageBaseHeader *> swapchain_images_;
 
+  // Optional projection layer below the main one, laid out like swapchains_. Its views keep the
+  // poses it was last rendered with, so frames that skip it submit them again.
+  std::vector<Swapchain> background_swapchains_;
+  std::vector<XrCompositionLayerProjectionView> background_layer_views_;
+  uint64_t frame_count_ = 0;
+
+  // XR_KHR_composition_layer_depth, keyed by the color swapchain the depth belongs to. The depth
+  // infos are chained behind the views of the main and background layers.
+  bool depth_layer_enabled_ = false;
+  int64_t depth_swapchain_format_ = 0;
+  std::map<XrSwapchain, Swapchain> depth_swapchains_;
+  std::vector<XrCompositionLayerDepthInfoKHR> depth_infos_;
+  std::vector<XrCompositionLayerDepthInfoKHR> background_depth_infos_;
+
+  // XR_FB_space_warp on the main layer, keyed by its color swapchains. While the views carry space
+  // warp infos the runtime paces the frames at half the display rate and synthesizes the others,
+  // which only happens while space_warp_active_.
+  bool space_warp_enabled_ = false;
+  bool space_warp_active_ = false;
+  uint32_t space_warp_switch_frames_ = 0;
+  XrDuration space_warp_display_period_ = 0;
+  XrSystemSpaceWarpPropertiesFB space_warp_properties_{};
+  int64_t motion_vector_swapchain_format_ = 0;
+  int64_t space_warp_depth_swapchain_format_ = 0;
+  std::map<XrSwapchain, SpaceWarpSwapchains> space_warp_swapchains_;
+  std::vector<XrCompositionLayerSpaceWarpInfoFB> space_warp_infos_;
+
+  // Quad layers above the projection, in the order they are submitted.
+  std::vector<UiPanel> ui_panels_;
+  int64_t panel_swapchain_format_ = 0;
+
   XrEventDataBuffer event_data_buffer_{};
 
+  bool visibility_mask_enabled_ = false;
+  PFN_xrGetVisibilityMaskKHR xr_get_visibility_mask_khr_ = nullptr;
+
+  // XR_FB_display_refresh_rate, driven by the CPU time of the last frame and the GPU time of the
+  // last completed one. The CPU time is the frame's wall time less frame_wait_time_, what it spent
+  // blocked on the GPU and the compositor.
+  bool display_refresh_rate_enabled_ = false;
+  PFN_xrRequestDisplayRefreshRateFB xr_request_display_refresh_rate_fb_ = nullptr;
+  RefreshRateController refresh_rate_controller_{};
+  float requested_refresh_rate_ = 0.0f;
+  XrDuration cpu_frame_time_ = 0;
+  XrDuration frame_wait_time_ = 0;
+
+  // XR_EXT_performance_settings, the policy also decides the quality without the extension.
+  bool performance_settings_enabled_ = false;
+  PFN_xrPerfSettingsSetPerformanceLevelEXT xr_perf_settings_set_performance_level_ext_ = nullptr;
+  QualityPolicy quality_policy_{};
+  QualitySettings quality_settings_{};
+  std::map<XrPerfSettingsDomainEXT, XrPerfSettingsLevelEXT> requested_performance_levels_;
+
+  bool fb_foveation_available_ = false;
+  bool fb_foveation_enabled_ = false;
+  FoveationLevel foveation_level_ = FoveationLevel::MEDIUM;
+  XrSwapchainCreateInfoFoveationFB swapchain_foveation_info_{};
+  PFN_xrCreateFoveationProfileFB xr_create_foveation_profile_fb_ = nullptr;
+  PFN_xrDestroyFoveationProfileFB xr_destroy_foveation_profile_fb_ = nullptr;
+  PFN_xrUpdateSwapchainFB xr_update_swapchain_fb_ = nullptr;
+
   XrSessionState session_state_ = XR_SESSION_STATE_UNKNOWN;
   bool session_running_ = false;
 };
@@ -4,6 +4,7 @@
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <vector>
 
 void CheckResult(XrResult result, const std::string &file, uint32_t line) {
@@ -79,6 +80,29 @@ void LogLayersAndExtensions() {
   }
 }
 
+bool IsInstanceExtensionAvailable(const std::string &extension_name) {
+  uint32_t instance_extension_count;
+  CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr,
+                                                     0,
+                                                     &instance_extension_count,
+                                                     nullptr));
+
+  std::vector<XrExtensionProperties> extensions(instance_extension_count);
+  for (XrExtensionProperties &extension: extensions) {
+    extension.type = XR_TYPE_EXTENSION_PROPERTIES;
+  }
+
+  CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr,
+                                                     extensions.size(),
+                                                     &instance_extension_count,
+                                                     extensions.data()));
+  return std::any_of(extensions.begin(),
+                     extensions.end(),
+                     [&extension_name](const XrExtensionProperties &extension) {
+                       return extension_name == extension.extensionName;
+                     });
+}
+
 void LogInstanceInfo(XrInstance instance) {
   if (instance == XR_NULL_HANDLE) {
     throw std::runtime_error("instance is xr null handle");
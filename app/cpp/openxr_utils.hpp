@@ -1,6 +1,7 @@
 #pragma once
 
 #include "openxr-include.hpp"
+#include "openxr_extensions.hpp"
 
 #include <string>
 
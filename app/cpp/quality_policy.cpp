@@ -0,0 +1,95 @@
+#include "quality_policy.hpp"
+
+#include <algorithm>
+
+namespace {
+// Quality per notification level of the GPU domain: resolution cap and foveation floor.
+constexpr float kWarningResolutionScale = 0.85f;
+constexpr float kImpairedResolutionScale = 0.7f;
+// LOD bias per notification level of the CPU domain.
+constexpr float kWarningLodBias = 2.0f;
+constexpr float kImpairedLodBias = 4.0f;
+// Quality while the session is not focused, the user looks at system UI over the scene.
+constexpr float kUnfocusedResolutionScale = 0.5f;
+constexpr float kUnfocusedLodBias = 4.0f;
+}
+
+XrPerfSettingsNotificationLevelEXT QualityPolicy::GetNotificationLevel(
+    XrPerfSettingsDomainEXT domain) const {
+  XrPerfSettingsNotificationLevelEXT level = XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT;
+  for (const auto &[key, notification_level]: notification_levels_) {
+    if (key.first == domain) {
+      level = std::max(level, notification_level);
+    }
+  }
+  return level;
+}
+
+void QualityPolicy::SetNotificationLevel(XrPerfSettingsDomainEXT domain,
+                                         XrPerfSettingsSubDomainEXT sub_domain,
+                                         XrPerfSettingsNotificationLevelEXT level) {
+  notification_levels_[{domain, sub_domain}] = level;
+}
+
+void QualityPolicy::SetLoading(bool loading) {
+  loading_ = loading;
+}
+
+bool QualityPolicy::IsLoading() const {
+  return loading_;
+}
+
+void QualityPolicy::SetFocused(bool focused) {
+  focused_ = focused;
+}
+
+bool QualityPolicy::IsFocused() const {
+  return focused_;
+}
+
+QualitySettings QualityPolicy::GetSettings() const {
+  QualitySettings settings{};
+  switch (GetNotificationLevel(XR_PERF_SETTINGS_DOMAIN_GPU_EXT)) {
+    case XR_PERF_SETTINGS_NOTIF_LEVEL_WARNING_EXT:
+      settings.max_resolution_scale = kWarningResolutionScale;
+      settings.min_foveation_level = FoveationLevel::MEDIUM;
+      break;
+    case XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT:
+      settings.max_resolution_scale = kImpairedResolutionScale;
+      settings.min_foveation_level = FoveationLevel::HIGH;
+      break;
+    default:
+      break;
+  }
+  switch (GetNotificationLevel(XR_PERF_SETTINGS_DOMAIN_CPU_EXT)) {
+    case XR_PERF_SETTINGS_NOTIF_LEVEL_WARNING_EXT:
+      settings.lod_bias = kWarningLodBias;
+      break;
+    case XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT:
+      settings.lod_bias = kImpairedLodBias;
+      break;
+    default:
+      break;
+  }
+  if (!focused_) {
+    settings.max_resolution_scale = std::min(settings.max_resolution_scale,
+                                             kUnfocusedResolutionScale);
+    settings.min_foveation_level = FoveationLevel::HIGH;
+    settings.lod_bias = std::max(settings.lod_bias, kUnfocusedLodBias);
+    settings.background_updates = false;
+    settings.lowest_refresh_rate = true;
+  }
+  return settings;
+}
+
+XrPerfSettingsLevelEXT QualityPolicy::GetPerformanceLevel(XrPerfSettingsDomainEXT domain) const {
+  if (loading_) {
+    return XR_PERF_SETTINGS_LEVEL_BOOST_EXT;
+  }
+  if (!focused_) {
+    return XR_PERF_SETTINGS_LEVEL_POWER_SAVINGS_EXT;
+  }
+  return GetNotificationLevel(domain) == XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT
+         ? XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT
+         : XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "foveation.hpp"
+#include "openxr-include.hpp"
+
+#include <map>
+#include <utility>
+
+// Quality the frames are rendered at, the defaults are the full one.
+struct QualitySettings {
+  // Caps the dynamic resolution scale.
+  float max_resolution_scale = 1.0f;
+  // Foveation stays at least this strong, whatever level is asked for.
+  FoveationLevel min_foveation_level = FoveationLevel::OFF;
+  // Scales the pixel error the LODs may show, above 1 coarser LODs are taken closer.
+  float lod_bias = 1.0f;
+  // Re-renders the background layer every few frames, otherwise its last images stay submitted.
+  bool background_updates = true;
+  // Runs at the lowest display refresh rate instead of the one the frames fit into.
+  bool lowest_refresh_rate = false;
+};
+
+// Turns the runtime's XR_EXT_performance_settings notifications into the quality to render at and
+// the performance levels to ask for. The worst sub-domain decides for a domain: GPU warnings cost
+// resolution and foveation, CPU warnings LOD detail, and the domain is asked to settle at a
+// sustainable level, while the runtime is still warning rather than after it throttled the
+// clocks. Loading boosts both domains.
+//
+// While the session is visible but not focused, e.g. behind the system menu, the frames are
+// rendered at the lowest quality and refresh rate and both domains are asked to save power. The
+// resolution then ramps back up through the dynamic resolution controller once focus returns.
+class QualityPolicy {
+ private:
+  std::map<std::pair<XrPerfSettingsDomainEXT, XrPerfSettingsSubDomainEXT>,
+           XrPerfSettingsNotificationLevelEXT> notification_levels_{};
+  bool loading_ = true;
+  bool focused_ = true;
+
+  [[nodiscard]] XrPerfSettingsNotificationLevelEXT GetNotificationLevel(
+      XrPerfSettingsDomainEXT domain) const;
+
+ public:
+  void SetNotificationLevel(XrPerfSettingsDomainEXT domain,
+                            XrPerfSettingsSubDomainEXT sub_domain,
+                            XrPerfSettingsNotificationLevelEXT level);
+
+  // Loading lasts from the start until the first frame is submitted.
+  void SetLoading(bool loading);
+
+  [[nodiscard]] bool IsLoading() const;
+
+  void SetFocused(bool focused);
+
+  [[nodiscard]] bool IsFocused() const;
+
+  [[nodiscard]] QualitySettings GetSettings() const;
+
+  [[nodiscard]] XrPerfSettingsLevelEXT GetPerformanceLevel(XrPerfSettingsDomainEXT domain) const;
+};
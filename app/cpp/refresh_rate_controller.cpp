@@ -0,0 +1,88 @@
+#include "refresh_rate_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+constexpr size_t kWindowFrames = 120;
+constexpr double kPercentile = 0.95;
+// Share of the display period the percentile may take before the rate drops.
+constexpr double kMissLoad = 0.95;
+// Share of the next higher rate's period the percentile has to stay below to raise the rate.
+constexpr double kRaiseLoad = 0.75;
+constexpr uint64_t kInitialBackoffFrames = 600;
+constexpr uint64_t kMaxBackoffFrames = 16 * kInitialBackoffFrames;
+
+int64_t GetPercentile(std::vector<int64_t> frame_times) {
+  if (frame_times.empty()) {
+    return 0;
+  }
+  auto nth = frame_times.begin()
+      + static_cast<std::ptrdiff_t>(kPercentile * static_cast<double>(frame_times.size() - 1));
+  std::nth_element(frame_times.begin(), nth, frame_times.end());
+  return *nth;
+}
+}
+
+RefreshRateController::RefreshRateController(std::vector<float> refresh_rates,
+                                             float current_rate) :
+    refresh_rates_(std::move(refresh_rates)) {
+  std::sort(refresh_rates_.begin(), refresh_rates_.end());
+  refresh_rates_.erase(std::unique(refresh_rates_.begin(), refresh_rates_.end()),
+                       refresh_rates_.end());
+  for (size_t i = 1; i < refresh_rates_.size(); i++) {
+    if (std::abs(refresh_rates_[i] - current_rate)
+        < std::abs(refresh_rates_[rate_index_] - current_rate)) {
+      rate_index_ = i;
+    }
+  }
+  retry_frames_.resize(refresh_rates_.size(), 0);
+  backoff_frames_.resize(refresh_rates_.size(), kInitialBackoffFrames);
+  cpu_frame_times_.reserve(kWindowFrames);
+  gpu_frame_times_.reserve(kWindowFrames);
+}
+
+float RefreshRateController::Update(int64_t cpu_frame_time,
+                                    int64_t gpu_frame_time,
+                                    int64_t display_period) {
+  if (refresh_rates_.empty() || cpu_frame_time <= 0 || display_period <= 0) {
+    return GetRefreshRate();
+  }
+  frame_count_++;
+  cpu_frame_times_.push_back(cpu_frame_time);
+  if (gpu_frame_time > 0) {
+    gpu_frame_times_.push_back(gpu_frame_time);
+  }
+  if (cpu_frame_times_.size() < kWindowFrames) {
+    return GetRefreshRate();
+  }
+
+  const auto kFrameTime = static_cast<double>(std::max(GetPercentile(cpu_frame_times_),
+                                                       GetPercentile(gpu_frame_times_)));
+  // Every window is judged at the rate it was paced at, so a change starts a new one.
+  cpu_frame_times_.clear();
+  gpu_frame_times_.clear();
+  if (kFrameTime > kMissLoad * static_cast<double>(display_period) && rate_index_ > 0) {
+    // Leaving a rate pushes its next try further out.
+    retry_frames_[rate_index_] = frame_count_ + backoff_frames_[rate_index_];
+    backoff_frames_[rate_index_] = std::min(2 * backoff_frames_[rate_index_], kMaxBackoffFrames);
+    rate_index_--;
+  } else if (rate_index_ + 1 < refresh_rates_.size()
+      && frame_count_ >= retry_frames_[rate_index_ + 1]) {
+    const double kHigherPeriod = static_cast<double>(display_period) * refresh_rates_[rate_index_]
+        / refresh_rates_[rate_index_ + 1];
+    if (kFrameTime < kRaiseLoad * kHigherPeriod) {
+      rate_index_++;
+    }
+  }
+  return GetRefreshRate();
+}
+
+float RefreshRateController::GetRefreshRate() const {
+  return refresh_rates_.empty() ? 0.0f : refresh_rates_[rate_index_];
+}
+
+float RefreshRateController::GetLowestRefreshRate() const {
+  return refresh_rates_.empty() ? 0.0f : refresh_rates_.front();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Picks the display refresh rate the frames reliably fit into. The CPU and GPU times of a window
+// of frames are compared at a high percentile against the display period: a window missing it
+// drops to the next lower rate, a window with room to spare for the next higher period raises it.
+// Every change starts a new window, and a rate that had to be left is only retried after a
+// backoff that doubles each time it fails again.
+class RefreshRateController {
+ private:
+  // Ascending.
+  std::vector<float> refresh_rates_;
+  size_t rate_index_ = 0;
+  std::vector<int64_t> cpu_frame_times_{};
+  std::vector<int64_t> gpu_frame_times_{};
+  // Frames to wait before raising to a rate, per rate, and the wait after its next failure.
+  std::vector<uint64_t> retry_frames_{};
+  std::vector<uint64_t> backoff_frames_{};
+  uint64_t frame_count_ = 0;
+
+ public:
+  // Starts at the available rate closest to current_rate.
+  explicit RefreshRateController(std::vector<float> refresh_rates = {},
+                                 float current_rate = 0.0f);
+
+  // Takes the CPU and GPU time of a completed frame and the display period it was paced at, all
+  // in nanoseconds, and returns the rate to run at. A GPU time of zero is left out.
+  float Update(int64_t cpu_frame_time, int64_t gpu_frame_time, int64_t display_period);
+
+  // Zero without any rates to choose from.
+  [[nodiscard]] float GetRefreshRate() const;
+
+  [[nodiscard]] float GetLowestRefreshRate() const;
+};
@@ -0,0 +1,70 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kRadixBuckets = 1u << kRadixBits;
+
+uint64_t PackField(uint64_t key, uint32_t value, uint32_t bits) {
+  if (value >= (1u << bits)) {
+    throw std::out_of_range("render queue key field out of range");
+  }
+  return (key << bits) | value;
+}
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t pass,
+                              uint32_t pipeline,
+                              uint32_t material,
+                              uint32_t mesh,
+                              float depth) {
+  constexpr uint32_t kMaxDepth = (1u << kDepthBits) - 1;
+  auto quantized_depth = static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * kMaxDepth);
+  uint64_t key = 0;
+  key = PackField(key, pass, kPassBits);
+  key = PackField(key, pipeline, kPipelineBits);
+  key = PackField(key, material, kMaterialBits);
+  key = PackField(key, mesh, kMeshBits);
+  key = PackField(key, quantized_depth, kDepthBits);
+  return key;
+}
+
+void RenderQueue::Clear() {
+  items_.clear();
+}
+
+void RenderQueue::Submit(uint64_t key, uint32_t payload) {
+  items_.push_back({key, payload});
+}
+
+void RenderQueue::Sort() {
+  scratch_.resize(items_.size());
+  for (uint32_t shift = 0; shift < 64; shift += kRadixBits) {
+    std::array<size_t, kRadixBuckets> offsets{};
+    for (const auto &item: items_) {
+      offsets[(item.key >> shift) & (kRadixBuckets - 1)]++;
+    }
+    // Every key shares this digit, the pass would not move anything.
+    if (std::any_of(offsets.begin(), offsets.end(),
+                    [this](size_t count) { return count == items_.size(); })) {
+      continue;
+    }
+    size_t sum = 0;
+    for (auto &offset: offsets) {
+      size_t count = offset;
+      offset = sum;
+      sum += count;
+    }
+    for (const auto &item: items_) {
+      scratch_[offsets[(item.key >> shift) & (kRadixBuckets - 1)]++] = item;
+    }
+    items_.swap(scratch_);
+  }
+}
+
+const std::vector<RenderQueueItem> &RenderQueue::GetItems() const {
+  return items_;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct RenderQueueItem {
+  uint64_t key;
+  uint32_t payload;
+};
+
+// Draws are submitted with a packed sort key and an opaque payload (usually an index into the
+// caller's draw list) and radix-sorted once per frame. From the most significant bits down the
+// key holds the pass, pipeline, material, mesh and quantized depth, so state changes are grouped
+// and draws sharing the same state are ordered front to back.
+class RenderQueue {
+ private:
+  std::vector<RenderQueueItem> items_{};
+  std::vector<RenderQueueItem> scratch_{};
+
+ public:
+  static constexpr uint32_t kPassBits = 4;
+  static constexpr uint32_t kPipelineBits = 12;
+  static constexpr uint32_t kMaterialBits = 12;
+  static constexpr uint32_t kMeshBits = 16;
+  static constexpr uint32_t kDepthBits = 20;
+
+  // depth is normalized to [0, 1]; values outside are clamped.
+  static uint64_t MakeKey(uint32_t pass,
+                          uint32_t pipeline,
+                          uint32_t material,
+                          uint32_t mesh,
+                          float depth);
+
+  void Clear();
+
+  void Submit(uint64_t key, uint32_t payload);
+
+  void Sort();
+
+  [[nodiscard]] const std::vector<RenderQueueItem> &GetItems() const;
+};
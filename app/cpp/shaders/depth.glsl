@@ -0,0 +1,16 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec4 position;
+
+layout(push_constant, std140) uniform UniformBufferObject {
+    mat4 mvp;
+};
+
+// Must match the color pass bit for bit so its EQUAL-or-less depth test passes.
+invariant gl_Position;
+
+void main() {
+    gl_Position = mvp * position;
+}
@@ -0,0 +1,21 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_multiview : require
+
+layout(location = 0) in vec4 position;
+
+layout(std140, set = 0, binding = 0) uniform Views {
+    mat4 view_projection[2];
+};
+
+layout(push_constant, std140) uniform UniformBufferObject {
+    mat4 model;
+};
+
+// Must match vert_multiview bit for bit so the color pass's EQUAL-or-less depth test passes.
+invariant gl_Position;
+
+void main() {
+    gl_Position = view_projection[gl_ViewIndex] * model * position;
+}
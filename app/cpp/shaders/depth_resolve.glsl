@@ -0,0 +1,29 @@
+#version 460
+#pragma shader_stage(compute)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2DMSArray source_depth;
+
+layout(std430, binding = 1) writeonly buffer ResolvedDepth {
+    float resolved_depth[];
+};
+
+layout(push_constant, std430) uniform PushConstants {
+    ivec2 source_offset;// rendered part of the source images
+    vec2 source_scale;// source texels per target texel
+    uvec2 target_extent;
+};
+
+void main() {
+    uvec3 pixel = gl_GlobalInvocationID;
+    if (any(greaterThanEqual(pixel.xy, target_extent))) {
+        return;
+    }
+    ivec2 source_texel = source_offset + ivec2((vec2(pixel.xy) + 0.5) * source_scale);
+    // Sample zero like VK_RESOLVE_MODE_SAMPLE_ZERO_BIT, averaging would invent depths between
+    // the surfaces of an edge.
+    float depth = texelFetch(source_depth, ivec3(source_texel, pixel.z), 0).r;
+    resolved_depth[(pixel.z * target_extent.y + pixel.y) * target_extent.x + pixel.x] = depth;
+}
@@ -0,0 +1,60 @@
+#version 460
+#pragma shader_stage(fragment)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 ndc;
+
+layout(location = 0) out vec4 out_color;
+
+layout(binding = 0) uniform sampler2D far_color;
+layout(binding = 1) uniform sampler2DMS far_depth;
+
+layout(push_constant, std430) uniform PushConstants {
+    mat4 reprojection;// clip space of this view to the one of the far field, same depth range
+    vec2 uv_scale;// rendered part of the far field images
+    uint max_steps;
+};
+
+vec2 ToUv(vec2 point_ndc) {
+    // The viewport is flipped, so uv y grows downwards while clip space y grows upwards.
+    return vec2(0.5 + 0.5 * point_ndc.x, 0.5 - 0.5 * point_ndc.y) * uv_scale;
+}
+
+float SurfaceDepth(vec2 uv) {
+    ivec2 depth_size = textureSize(far_depth);
+    ivec2 depth_texel = clamp(ivec2(uv * vec2(depth_size)), ivec2(0), depth_size - 1);
+    return texelFetch(far_depth, depth_texel, 0).r;
+}
+
+void main() {
+    // The ray of this pixel from the split distance at depth 0 to the far plane at depth 1.
+    vec4 near_clip = reprojection * vec4(ndc, 0.0, 1.0);
+    vec4 far_clip = reprojection * vec4(ndc, 1.0, 1.0);
+    vec2 near_uv = ToUv(near_clip.xy / near_clip.w);
+    vec2 far_uv = ToUv(far_clip.xy / far_clip.w);
+
+    // About one step per depth texel the ray crosses in the far field.
+    vec2 span = abs(far_uv - near_uv) * vec2(textureSize(far_depth));
+    uint steps = clamp(uint(ceil(max(span.x, span.y))), 1u, max_steps);
+
+    // The far plane always stops the search, so the ray ends on the background at worst.
+    vec2 hit_uv = far_uv;
+    vec2 previous_uv = near_uv;
+    float previous_depth = 0.0;
+    for (uint i = 0; i <= steps; i++) {
+        vec4 clip = mix(near_clip, far_clip, float(i) / float(steps));
+        vec3 point = clip.xyz / clip.w;
+        vec2 uv = ToUv(point.xy);
+        float surface = SurfaceDepth(uv);
+        if (surface <= point.z) {
+            // A surface nearer than the ray was one step before was never crossed: the ray went
+            // behind an occluder into what the center view could not see. The background side of
+            // the edge fills it rather than the occluder smearing over it.
+            hit_uv = i > 0 && surface < previous_depth ? previous_uv : uv;
+            break;
+        }
+        previous_uv = uv;
+        previous_depth = point.z;
+    }
+    out_color = vec4(textureLod(far_color, hit_uv, 0.0).rgb, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 460
+#pragma shader_stage(fragment)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec4 v_position;
+layout(location = 1) in vec4 v_previous_position;
+
+layout(location = 0) out vec4 motion;
+
+// XR_FB_space_warp takes the motion since the previous frame in normalized device coordinates.
+void main() {
+    motion = vec4(v_position.xyz / v_position.w - v_previous_position.xyz / v_previous_position.w, 0.0);
+}
@@ -0,0 +1,11 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) out vec2 ndc;
+
+void main() {
+    // One triangle over the whole viewport, on the far plane so the scene draws over it.
+    ndc = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2.0 - 1.0;
+    gl_Position = vec4(ndc, 1.0, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_multiview : require
+
+// xy on the z = -1 plane of view space, z holds the view index.
+layout(location = 0) in vec3 position;
+
+layout(push_constant, std140) uniform UniformBufferObject {
+    mat4 projection[2];
+};
+
+void main() {
+    if (uint(position.z) != gl_ViewIndex) {
+        // Triangles of the other view collapse outside of the clip volume.
+        gl_Position = vec4(2.0, 2.0, 0.0, 1.0);
+        return;
+    }
+    vec4 clip = projection[gl_ViewIndex] * vec4(position.xy, -1.0, 1.0);
+    gl_Position = vec4(clip.xy, 0.0, clip.w);
+}
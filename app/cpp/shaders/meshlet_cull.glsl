@@ -0,0 +1,86 @@
+#version 460
+#pragma shader_stage(compute)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(local_size_x = 64) in;
+
+struct MeshletBounds {
+    vec3 center;
+    float radius;
+    vec3 cone_apex;
+    float padding;
+    vec3 cone_axis;
+    float cone_cutoff;
+};
+
+struct DrawIndexedIndirectCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+layout(std430, binding = 0) readonly buffer Bounds {
+    MeshletBounds bounds[];
+};
+
+layout(std430, binding = 1) readonly buffer DrawRanges {
+    uvec2 draw_ranges[];
+};
+
+layout(std430, binding = 2) writeonly buffer DrawCommands {
+    DrawIndexedIndirectCommand draw_commands[];
+};
+
+layout(std430, binding = 3) readonly buffer Views {
+    mat4 view_projections[];
+};
+
+layout(push_constant, std430) uniform PushConstants {
+    mat4 model;
+    vec4 camera_positions[2];// object space, one per view
+    uint meshlet_count;
+    uint draw_offset;
+    uint first_meshlet;// first meshlet of the selected lod
+    uint view_count;
+};
+
+bool IsOutsideFrustum(mat4 mvp, vec3 center, float radius) {
+    mat4 m = transpose(mvp);
+    vec4 planes[5] = vec4[](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2]);
+    for (int i = 0; i < 5; i++) {
+        float plane_length = length(planes[i].xyz);
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius * plane_length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IsBackfacing(MeshletBounds meshlet, vec3 camera_position) {
+    return dot(normalize(meshlet.cone_apex - camera_position), meshlet.cone_axis) >= meshlet.cone_cutoff;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= meshlet_count) {
+        return;
+    }
+    uint meshlet_index = first_meshlet + index;
+    MeshletBounds meshlet = bounds[meshlet_index];
+    // Multiview draws every view from the same commands, so any view seeing it keeps it.
+    bool visible = false;
+    for (uint view = 0; view < view_count; view++) {
+        visible = visible || (!IsOutsideFrustum(view_projections[view] * model, meshlet.center, meshlet.radius)
+            && !IsBackfacing(meshlet, camera_positions[view].xyz));
+    }
+
+    DrawIndexedIndirectCommand command;
+    command.index_count = draw_ranges[meshlet_index].y;
+    command.instance_count = visible ? 1 : 0;
+    command.first_index = draw_ranges[meshlet_index].x;
+    command.vertex_offset = 0;
+    command.first_instance = 0;
+    draw_commands[draw_offset + index] = command;
+}
@@ -0,0 +1,62 @@
+#version 460
+#pragma shader_stage(compute)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2DArray input_color;
+layout(binding = 1) uniform sampler2DMSArray input_depth;
+layout(binding = 2) uniform sampler2DArray history;
+layout(binding = 3, rgba16f) uniform writeonly image2DArray resolved;
+
+layout(push_constant, std430) uniform PushConstants {
+    mat4 reprojection;// clip space of this frame to the one of the history
+    vec2 input_uv_scale;// rendered part of the input images
+    vec2 history_uv_scale;// part of the history resolved by the previous frame
+    vec2 jitter;// sample offset of this frame in uv of the rendered part
+    float history_weight;
+    uint layer;
+    uvec2 output_extent;
+};
+
+void main() {
+    uvec2 pixel = gl_GlobalInvocationID.xy;
+    if (any(greaterThanEqual(pixel, output_extent))) {
+        return;
+    }
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(output_extent);
+
+    // The scene moved by the jitter, so it is sampled where this pixel ended up.
+    vec2 input_uv = (uv + jitter) * input_uv_scale;
+    vec2 input_texel = 1.0 / vec2(textureSize(input_color, 0).xy);
+    vec4 current = textureLod(input_color, vec3(input_uv, layer), 0.0);
+
+    // The history may only contribute what the neighbourhood of the current frame could hold.
+    vec4 low = current;
+    vec4 high = current;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec2 neighbour_uv = input_uv + vec2(x, y) * input_texel;
+            vec4 neighbour = textureLod(input_color, vec3(neighbour_uv, layer), 0.0);
+            low = min(low, neighbour);
+            high = max(high, neighbour);
+        }
+    }
+
+    ivec2 depth_size = textureSize(input_depth).xy;
+    ivec2 depth_texel = clamp(ivec2(input_uv * vec2(depth_size)), ivec2(0), depth_size - 1);
+    float depth = texelFetch(input_depth, ivec3(depth_texel, layer), 0).r;
+    // The viewport is flipped, so uv y grows downwards while clip space y grows upwards.
+    vec4 previous = reprojection * vec4(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, depth, 1.0);
+    vec2 previous_ndc = previous.xy / previous.w;
+    vec2 history_uv = vec2(0.5 + 0.5 * previous_ndc.x, 0.5 - 0.5 * previous_ndc.y);
+
+    // Alpha is resolved like the color, a layer above another keeps its coverage.
+    vec4 result = current;
+    if (history_weight > 0.0 && previous.w > 0.0
+        && all(greaterThanEqual(history_uv, vec2(0.0))) && all(lessThanEqual(history_uv, vec2(1.0)))) {
+        vec4 previous_color = textureLod(history, vec3(history_uv * history_uv_scale, layer), 0.0);
+        result = mix(current, clamp(previous_color, low, high), history_weight);
+    }
+    imageStore(resolved, ivec3(pixel, layer), result);
+}
@@ -11,6 +11,8 @@ layout(push_constant, std140) uniform UniformBufferObject {
 
 layout(location = 0) out vec4 v_color;
 
+invariant gl_Position;
+
 void main() {
     v_color = color;
     gl_Position = mvp * position;
@@ -0,0 +1,22 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec4 position;
+
+// The object in this and in the previous rendered frame, both seen from this frame's view.
+layout(push_constant, std140) uniform UniformBufferObject {
+    mat4 mvp;
+    mat4 previous_mvp;
+};
+
+layout(location = 0) out vec4 v_position;
+layout(location = 1) out vec4 v_previous_position;
+
+invariant gl_Position;
+
+void main() {
+    v_position = mvp * position;
+    v_previous_position = previous_mvp * position;
+    gl_Position = v_position;
+}
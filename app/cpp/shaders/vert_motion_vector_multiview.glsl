@@ -0,0 +1,27 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_multiview : require
+
+layout(location = 0) in vec4 position;
+
+layout(std140, set = 0, binding = 0) uniform Views {
+    mat4 view_projection[2];
+};
+
+// The object in this and in the previous rendered frame, both seen from this frame's views.
+layout(push_constant, std140) uniform UniformBufferObject {
+    mat4 model;
+    mat4 previous_model;
+};
+
+layout(location = 0) out vec4 v_position;
+layout(location = 1) out vec4 v_previous_position;
+
+invariant gl_Position;
+
+void main() {
+    v_position = view_projection[gl_ViewIndex] * model * position;
+    v_previous_position = view_projection[gl_ViewIndex] * previous_model * position;
+    gl_Position = v_position;
+}
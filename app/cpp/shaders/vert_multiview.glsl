@@ -0,0 +1,24 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_multiview : require
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+
+layout(std140, set = 0, binding = 0) uniform Views {
+    mat4 view_projection[2];
+};
+
+layout(push_constant, std140) uniform UniformBufferObject {
+    mat4 model;
+};
+
+layout(location = 0) out vec4 v_color;
+
+invariant gl_Position;
+
+void main() {
+    v_color = color;
+    gl_Position = view_projection[gl_ViewIndex] * model * position;
+}
@@ -0,0 +1,45 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+
+struct Mesh {
+    uint position_offset;
+    uint attribute_offset;
+    uint attribute_stride;
+    uint color_offset;
+    uint color_components;
+    uint first_index;
+    uint index_count;
+    uint padding;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Vertices {
+    float vertices[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Meshes {
+    Mesh meshes[];
+};
+
+layout(push_constant, std140) uniform UniformBufferObject {
+    mat4 mvp;
+};
+
+layout(location = 0) out vec4 v_color;
+
+void main() {
+    // The draw's firstInstance carries the mesh id.
+    Mesh mesh = meshes[gl_InstanceIndex];
+    uint position = mesh.position_offset + uint(gl_VertexIndex) * 3;
+    vec4 vertex_position = vec4(vertices[position], vertices[position + 1], vertices[position + 2], 1.0);
+
+    v_color = vec4(1.0);
+    if (mesh.color_offset != 0xFFFFFFFFu) {
+        uint color = mesh.attribute_offset + uint(gl_VertexIndex) * mesh.attribute_stride
+            + mesh.color_offset;
+        for (uint i = 0; i < min(mesh.color_components, 4u); i++) {
+            v_color[i] = vertices[color + i];
+        }
+    }
+    gl_Position = mvp * vertex_position;
+}
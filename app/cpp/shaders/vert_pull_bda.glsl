@@ -0,0 +1,51 @@
+#version 460
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_buffer_reference : require
+
+struct Mesh {
+    uint position_offset;
+    uint attribute_offset;
+    uint attribute_stride;
+    uint color_offset;
+    uint color_components;
+    uint first_index;
+    uint index_count;
+    uint padding;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer Vertices {
+    float vertices[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer Meshes {
+    Mesh meshes[];
+};
+
+layout(push_constant, std430) uniform PushConstants {
+    mat4 mvp;
+    Vertices vertex_data;
+    Meshes mesh_data;
+};
+
+layout(location = 0) out vec4 v_color;
+
+void main() {
+    // The draw's firstInstance carries the mesh id.
+    Mesh mesh = mesh_data.meshes[gl_InstanceIndex];
+    uint position = mesh.position_offset + uint(gl_VertexIndex) * 3;
+    vec4 vertex_position = vec4(vertex_data.vertices[position],
+                                vertex_data.vertices[position + 1],
+                                vertex_data.vertices[position + 2],
+                                1.0);
+
+    v_color = vec4(1.0);
+    if (mesh.color_offset != 0xFFFFFFFFu) {
+        uint color = mesh.attribute_offset + uint(gl_VertexIndex) * mesh.attribute_stride
+            + mesh.color_offset;
+        for (uint i = 0; i < min(mesh.color_components, 4u); i++) {
+            v_color[i] = vertex_data.vertices[color + i];
+        }
+    }
+    gl_Position = mvp * vertex_position;
+}
@@ -0,0 +1,61 @@
+#include "space_graph.hpp"
+
+#include "magic_enum.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <utility>
+
+SpaceGraph::SpaceGraph(std::shared_ptr<SpaceLocator> locator, XrSpace base_space) :
+    locator_(std::move(locator)), base_space_(base_space) {}
+
+size_t SpaceGraph::AddSpace(XrSpace space, bool is_static) {
+  std::optional<size_t> locator_index{};
+  if (!is_static) {
+    locator_index = locator_->AddSpace(space);
+  }
+  nodes_.push_back({space, locator_index, std::nullopt});
+  return nodes_.size() - 1;
+}
+
+std::vector<std::optional<XrPosef>> SpaceGraph::Locate(XrTime time) {
+  std::vector<std::optional<XrPosef>> poses(nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    Node &node = nodes_[i];
+    if (node.cached_pose.has_value()) {
+      poses[i] = node.cached_pose;
+      continue;
+    }
+    if (node.locator_index.has_value()) {
+      const SpaceLocations &kLocations = locator_->Locate(time);
+      if (kLocations.valid[*node.locator_index] != 0) {
+        poses[i] = kLocations.poses[*node.locator_index];
+      }
+      continue;
+    }
+    XrSpaceLocation space_location{};
+    space_location.type = XR_TYPE_SPACE_LOCATION;
+    const XrResult kResult = xrLocateSpace(node.space, base_space_, time, &space_location);
+    if (!XR_UNQUALIFIED_SUCCESS(kResult)) {
+      spdlog::debug("Unable to locate a space in the base space: {}",
+                    magic_enum::enum_name(kResult));
+      continue;
+    }
+    if ((space_location.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) == 0
+        || (space_location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) == 0) {
+      continue;
+    }
+    poses[i] = space_location.pose;
+    if (time >= change_time_) {
+      node.cached_pose = space_location.pose;
+    }
+  }
+  return poses;
+}
+
+void SpaceGraph::Invalidate(XrTime change_time) {
+  change_time_ = change_time;
+  for (Node &node: nodes_) {
+    node.cached_pose.reset();
+  }
+}
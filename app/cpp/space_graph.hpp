@@ -0,0 +1,43 @@
+#pragma once
+
+#include "openxr-include.hpp"
+#include "space_locator.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Poses of spaces relative to a base space. Static spaces, e.g. LOCAL and STAGE reference spaces
+// against each other, only move on a recenter or boundary change, so they are located once and
+// kept until the runtime announces a change with XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING.
+// Dynamic spaces, e.g. VIEW ones, are located on every call through the locator, which has to
+// share the graph's base space.
+class SpaceGraph {
+ private:
+  struct Node {
+    XrSpace space;
+    // Set for dynamic spaces.
+    std::optional<size_t> locator_index;
+    std::optional<XrPosef> cached_pose;
+  };
+
+  std::shared_ptr<SpaceLocator> locator_;
+  XrSpace base_space_ = XR_NULL_HANDLE;
+  std::vector<Node> nodes_{};
+  // Locations before the last change may still be the old ones, they are not cached.
+  XrTime change_time_ = 0;
+
+ public:
+  SpaceGraph() = default;
+  SpaceGraph(std::shared_ptr<SpaceLocator> locator, XrSpace base_space);
+
+  // The graph does not own the space. Returns its index into the poses of Locate.
+  size_t AddSpace(XrSpace space, bool is_static);
+
+  // Pose of every space in the base space at time, empty where it can not be located.
+  std::vector<std::optional<XrPosef>> Locate(XrTime time);
+
+  // Drops the cached poses, the static spaces are located again from change_time on.
+  void Invalidate(XrTime change_time);
+};
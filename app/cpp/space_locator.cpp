@@ -0,0 +1,85 @@
+#include "space_locator.hpp"
+
+#include "magic_enum.hpp"
+
+#include <spdlog/spdlog.h>
+
+SpaceLocator::SpaceLocator(XrSession session,
+                           XrSpace base_space,
+                           PFN_xrLocateSpacesKHR locate_spaces) :
+    session_(session), base_space_(base_space), xr_locate_spaces_khr_(locate_spaces) {}
+
+size_t SpaceLocator::AddSpace(XrSpace space) {
+  spaces_.push_back(space);
+  located_ = false;
+  return spaces_.size() - 1;
+}
+
+const SpaceLocations &SpaceLocator::Locate(XrTime time) {
+  if (located_ && locations_.time == time) {
+    return locations_;
+  }
+  locations_.time = time;
+  locations_.poses.assign(spaces_.size(), XrPosef{{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}});
+  locations_.location_flags.assign(spaces_.size(), 0);
+  locations_.valid.assign(spaces_.size(), 0);
+  if (xr_locate_spaces_khr_ != nullptr) {
+    LocateBatched(time);
+  } else {
+    LocateOneByOne(time);
+  }
+  for (size_t i = 0; i < spaces_.size(); i++) {
+    const XrSpaceLocationFlags kFlags = locations_.location_flags[i];
+    locations_.valid[i] = (kFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0
+        && (kFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0;
+  }
+  located_ = true;
+  return locations_;
+}
+
+void SpaceLocator::LocateBatched(XrTime time) {
+  if (spaces_.empty()) {
+    return;
+  }
+  location_data_.resize(spaces_.size());
+  XrSpacesLocateInfoKHR locate_info{};
+  locate_info.type = XR_TYPE_SPACES_LOCATE_INFO_KHR;
+  locate_info.baseSpace = base_space_;
+  locate_info.time = time;
+  locate_info.spaceCount = static_cast<uint32_t>(spaces_.size());
+  locate_info.spaces = spaces_.data();
+  XrSpaceLocationsKHR space_locations{};
+  space_locations.type = XR_TYPE_SPACE_LOCATIONS_KHR;
+  space_locations.locationCount = static_cast<uint32_t>(location_data_.size());
+  space_locations.locations = location_data_.data();
+  // A failed batch leaves every space invalid for this time instead of ending the frame.
+  const XrResult kResult = xr_locate_spaces_khr_(session_, &locate_info, &space_locations);
+  if (!XR_UNQUALIFIED_SUCCESS(kResult)) {
+    spdlog::debug("Unable to locate {} spaces in the base space: {}",
+                  spaces_.size(),
+                  magic_enum::enum_name(kResult));
+    return;
+  }
+  for (size_t i = 0; i < spaces_.size(); i++) {
+    locations_.location_flags[i] = location_data_[i].locationFlags;
+    if (location_data_[i].locationFlags != 0) {
+      locations_.poses[i] = location_data_[i].pose;
+    }
+  }
+}
+
+void SpaceLocator::LocateOneByOne(XrTime time) {
+  for (size_t i = 0; i < spaces_.size(); i++) {
+    XrSpaceLocation space_location{};
+    space_location.type = XR_TYPE_SPACE_LOCATION;
+    // A space that can not be located right now, e.g. an inactive hand, stays invalid.
+    const XrResult kResult = xrLocateSpace(spaces_[i], base_space_, time, &space_location);
+    if (!XR_UNQUALIFIED_SUCCESS(kResult)) {
+      spdlog::debug("Unable to locate a space in the base space: {}",
+                    magic_enum::enum_name(kResult));
+      continue;
+    }
+    locations_.location_flags[i] = space_location.locationFlags;
+    locations_.poses[i] = space_location.pose;
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "openxr-include.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Locations of the registered spaces at one display time, a structure of arrays in registration
+// order.
+struct SpaceLocations {
+  XrTime time = 0;
+  std::vector<XrPosef> poses{};
+  std::vector<XrSpaceLocationFlags> location_flags{};
+  // 1 where both position and orientation are valid, the pose is identity otherwise.
+  std::vector<uint8_t> valid{};
+};
+
+// Locates every registered space in a base space with a single xrLocateSpacesKHR call when
+// XR_KHR_locate_spaces is enabled, one xrLocateSpace per space otherwise. The locations are
+// memoized for the last display time, so every consumer of a frame shares one batch.
+class SpaceLocator {
+ private:
+  XrSession session_ = XR_NULL_HANDLE;
+  XrSpace base_space_ = XR_NULL_HANDLE;
+  PFN_xrLocateSpacesKHR xr_locate_spaces_khr_ = nullptr;
+  std::vector<XrSpace> spaces_{};
+  std::vector<XrSpaceLocationDataKHR> location_data_{};
+  SpaceLocations locations_{};
+  bool located_ = false;
+
+  void LocateBatched(XrTime time);
+  void LocateOneByOne(XrTime time);
+
+ public:
+  SpaceLocator() = default;
+  // locate_spaces is null without XR_KHR_locate_spaces.
+  SpaceLocator(XrSession session, XrSpace base_space, PFN_xrLocateSpacesKHR locate_spaces);
+
+  // The locator does not own the space. Returns its index into the locations.
+  size_t AddSpace(XrSpace space);
+
+  // Valid until the next call for another time or the next AddSpace. Spaces the runtime fails to
+  // locate are left invalid.
+  const SpaceLocations &Locate(XrTime time);
+};
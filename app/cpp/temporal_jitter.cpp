@@ -0,0 +1,40 @@
+#include "temporal_jitter.hpp"
+
+namespace {
+// Higher converges to more detail but reacts slower.
+constexpr float kHistoryWeight = 0.9f;
+
+float Halton(uint32_t index, uint32_t base) {
+  float fraction = 1.0f;
+  float result = 0.0f;
+  while (index > 0) {
+    fraction /= static_cast<float>(base);
+    result += fraction * static_cast<float>(index % base);
+    index /= base;
+  }
+  return result;
+}
+}
+
+TemporalJitter ComputeTemporalJitter(uint64_t frame_index, glm::uvec2 input_extent) {
+  // Index 0 of the sequence is the pixel corner, it is skipped.
+  const uint32_t kPhase = static_cast<uint32_t>(frame_index % kTemporalJitterPhases) + 1;
+  const glm::vec2 kClip = {
+      (Halton(kPhase, 2) - 0.5f) * 2.0f / static_cast<float>(input_extent.x),
+      (Halton(kPhase, 3) - 0.5f) * 2.0f / static_cast<float>(input_extent.y),
+  };
+  // Clip space y up moves the image up in uv.
+  return {
+      .clip = kClip,
+      .uv = {0.5f * kClip.x, -0.5f * kClip.y},
+  };
+}
+
+glm::mat4 ComputeHistoryReprojection(const glm::mat4 &previous_view_projection,
+                                     const glm::mat4 &view_projection) {
+  return previous_view_projection * glm::inverse(view_projection);
+}
+
+float GetHistoryWeight(bool history_valid) {
+  return history_valid ? kHistoryWeight : 0.0f;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Frames of the jitter sequence before it repeats.
+constexpr uint32_t kTemporalJitterPhases = 8;
+
+struct TemporalJitter {
+  // Translation applied to the view projections, in clip space.
+  glm::vec2 clip;
+  // The same offset in the uv space of the rendered image, whose viewport is flipped.
+  glm::vec2 uv;
+};
+
+// Halton (2, 3) offset within one pixel of an input_extent image, cycling every
+// kTemporalJitterPhases frames.
+[[nodiscard]] TemporalJitter ComputeTemporalJitter(uint64_t frame_index, glm::uvec2 input_extent);
+
+// Moves clip space positions of the current frame to where the previous frame saw them, both view
+// projections unjittered.
+[[nodiscard]] glm::mat4 ComputeHistoryReprojection(const glm::mat4 &previous_view_projection,
+                                                   const glm::mat4 &view_projection);
+
+// Share of the reprojected history in every output pixel, none while it is invalid.
+[[nodiscard]] float GetHistoryWeight(bool history_valid);
@@ -4,10 +4,27 @@
 
 size_t vulkan::GetDataTypeSizeInBytes(DataType type) {
   switch (type) {
-    case DataType::BYTE:return 1;
-    case DataType::UINT_16:return 2;
+    case DataType::BYTE:
+    case DataType::SNORM_8:return 1;
+    case DataType::UINT_16:
+    case DataType::UNORM_16:
+    case DataType::SNORM_16:
+    case DataType::HALF_FLOAT:return 2;
     case DataType::UINT_32:
-    case DataType::FLOAT:return 4;
+    case DataType::FLOAT:
+    case DataType::A2B10G10R10_UNORM:
+    case DataType::A2B10G10R10_SNORM:return 4;
     default: throw std::runtime_error("unsupported enum");
   }
 }
+
+bool vulkan::IsPackedDataType(DataType type) {
+  return type == DataType::A2B10G10R10_UNORM || type == DataType::A2B10G10R10_SNORM;
+}
+
+size_t vulkan::GetAttributeSizeInBytes(DataType type, size_t count) {
+  if (IsPackedDataType(type)) {
+    return GetDataTypeSizeInBytes(type);
+  }
+  return count * GetDataTypeSizeInBytes(type);
+}
@@ -9,6 +9,13 @@ enum class DataType {
   UINT_16,//SHORT
   UINT_32,
   FLOAT,
+  SNORM_8,
+  UNORM_16,
+  SNORM_16,
+  HALF_FLOAT,
+  // Packed types hold all four components in a single 32-bit word.
+  A2B10G10R10_UNORM,
+  A2B10G10R10_SNORM,
 };
 
 typedef enum BufferUsage {
@@ -31,4 +38,8 @@ enum class ShaderType {
 };
 
 size_t GetDataTypeSizeInBytes(DataType type);
+
+[[nodiscard]] bool IsPackedDataType(DataType type);
+
+size_t GetAttributeSizeInBytes(DataType type, size_t count);
 }
@@ -1,5 +1,7 @@
 #include "vertex_buffer_layout.hpp"
 
+#include <algorithm>
+
 const std::vector<vulkan::VertexAttribute> &vulkan::VertexBufferLayout::GetElements() const {
   return elements_;
 }
@@ -11,7 +13,27 @@ void vulkan::VertexBufferLayout::Push(vulkan::VertexAttribute attribute) {
 size_t vulkan::VertexBufferLayout::GetElementSize() const {
   size_t size = 0;
   for (auto elem: elements_) {
-    size += elem.count * GetDataTypeSizeInBytes(elem.type);
+    size += GetAttributeSizeInBytes(elem.type, elem.count);
   }
   return size;
 }
+
+size_t vulkan::VertexBufferLayout::GetStride(uint32_t buffer_binding) const {
+  size_t size = 0;
+  for (auto elem: elements_) {
+    if (elem.buffer_binding == buffer_binding) {
+      size += GetAttributeSizeInBytes(elem.type, elem.count);
+    }
+  }
+  return size;
+}
+
+std::vector<uint32_t> vulkan::VertexBufferLayout::GetBindings() const {
+  std::vector<uint32_t> bindings{};
+  for (auto elem: elements_) {
+    bindings.push_back(elem.buffer_binding);
+  }
+  std::sort(bindings.begin(), bindings.end());
+  bindings.erase(std::unique(bindings.begin(), bindings.end()), bindings.end());
+  return bindings;
+}
@@ -7,9 +7,12 @@
 
 namespace vulkan {
 struct VertexAttribute {
+  // Shader input location.
   unsigned int binding_index;
   DataType type;
   size_t count;
+  // Vertex buffer the attribute is fetched from; attributes of one buffer are interleaved.
+  uint32_t buffer_binding = 0;
 };
 
 class VertexBufferLayout {
@@ -20,8 +23,14 @@ class VertexBufferLayout {
 
   void Push(VertexAttribute attribute);
 
+  // Size of one vertex summed over all buffer bindings.
   [[nodiscard]] size_t GetElementSize() const;
 
+  [[nodiscard]] size_t GetStride(uint32_t buffer_binding) const;
+
+  // Buffer bindings used by the attributes in ascending order.
+  [[nodiscard]] std::vector<uint32_t> GetBindings() const;
+
   [[nodiscard]] const std::vector<VertexAttribute> &GetElements() const;
 };
 }
@@ -72,3 +72,7 @@ vulkan::VulkanBuffer::~VulkanBuffer() {
 size_t vulkan::VulkanBuffer::GetSizeInBytes() const {
   return size_in_bytes_;
 }
+
+VkDeviceAddress vulkan::VulkanBuffer::GetDeviceAddress() const {
+  return context_->GetBufferDeviceAddress(buffer_);
+}
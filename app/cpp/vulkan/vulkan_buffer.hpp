@@ -22,6 +22,7 @@ class VulkanBuffer {
                 size_t dst_offset);
   [[nodiscard]] VkBuffer GetBuffer() const;
   [[nodiscard]] size_t GetSizeInBytes() const;
+  [[nodiscard]] VkDeviceAddress GetDeviceAddress() const;
   virtual ~VulkanBuffer();
  protected:
   std::shared_ptr<VulkanRenderingContext> context_;
@@ -0,0 +1,94 @@
+#include "vulkan_command_encoder.hpp"
+
+vulkan::VulkanCommandEncoder::VulkanCommandEncoder(VkCommandBuffer command_buffer) :
+    command_buffer_(command_buffer) {
+}
+
+void vulkan::VulkanCommandEncoder::BindPipeline(const VulkanRenderingPipeline &pipeline) {
+  if (pipeline.GetPipeline() != pipeline_) {
+    pipeline_ = pipeline.GetPipeline();
+    vkCmdBindPipeline(command_buffer_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+    bind_count_++;
+  } else {
+    skipped_bind_count_++;
+  }
+
+  // Sets bound with a different layout are not guaranteed to stay compatible.
+  if (pipeline.GetPipelineLayout() != pipeline_layout_) {
+    pipeline_layout_ = pipeline.GetPipelineLayout();
+    descriptor_set_ = VK_NULL_HANDLE;
+  }
+  VkDescriptorSet descriptor_set = pipeline.GetDescriptorSet();
+  if (descriptor_set != VK_NULL_HANDLE) {
+    if (descriptor_set != descriptor_set_) {
+      descriptor_set_ = descriptor_set;
+      vkCmdBindDescriptorSets(command_buffer_,
+                              VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              pipeline_layout_,
+                              0,
+                              1,
+                              &descriptor_set_,
+                              0,
+                              nullptr);
+      bind_count_++;
+    } else {
+      skipped_bind_count_++;
+    }
+  }
+
+  std::vector<VkBuffer> vertex_buffers = pipeline.GetVertexBuffers();
+  if (vertex_buffers_.size() < vertex_buffers.size()) {
+    vertex_buffers_.resize(vertex_buffers.size(), VK_NULL_HANDLE);
+  }
+  for (uint32_t binding = 0; binding < vertex_buffers.size(); binding++) {
+    if (vertex_buffers[binding] == VK_NULL_HANDLE) {
+      continue;
+    }
+    if (vertex_buffers[binding] != vertex_buffers_[binding]) {
+      vertex_buffers_[binding] = vertex_buffers[binding];
+      VkDeviceSize offsets[] = {0};
+      vkCmdBindVertexBuffers(command_buffer_, binding, 1, &vertex_buffers_[binding], offsets);
+      bind_count_++;
+    } else {
+      skipped_bind_count_++;
+    }
+  }
+
+  VkBuffer index_buffer = pipeline.GetIndexBuffer();
+  if (index_buffer != VK_NULL_HANDLE) {
+    if (index_buffer != index_buffer_ || pipeline.GetIndexType() != index_type_) {
+      index_buffer_ = index_buffer;
+      index_type_ = pipeline.GetIndexType();
+      vkCmdBindIndexBuffer(command_buffer_, index_buffer_, 0, index_type_);
+      bind_count_++;
+    } else {
+      skipped_bind_count_++;
+    }
+  }
+}
+
+void vulkan::VulkanCommandEncoder::Reset() {
+  pipeline_ = VK_NULL_HANDLE;
+  pipeline_layout_ = VK_NULL_HANDLE;
+  descriptor_set_ = VK_NULL_HANDLE;
+  vertex_buffers_.clear();
+  index_buffer_ = VK_NULL_HANDLE;
+  index_type_ = VK_INDEX_TYPE_MAX_ENUM;
+}
+
+VkCommandBuffer vulkan::VulkanCommandEncoder::GetCommandBuffer() const {
+  return command_buffer_;
+}
+
+uint32_t vulkan::VulkanCommandEncoder::GetBindCount() const {
+  return bind_count_;
+}
+
+uint32_t vulkan::VulkanCommandEncoder::GetSkippedBindCount() const {
+  return skipped_bind_count_;
+}
+
+void vulkan::VulkanCommandEncoder::AddStatistics(BindStatistics &statistics) const {
+  statistics.bind_count += bind_count_;
+  statistics.skipped_bind_count += skipped_bind_count_;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "vulkan_rendering_pipeline.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace vulkan {
+// Binds recorded and skipped as redundant, summed over the encoders of the frames so far.
+struct BindStatistics {
+  uint64_t bind_count = 0;
+  uint64_t skipped_bind_count = 0;
+};
+
+// Remembers the state bound on a command buffer and only records the binds that change it.
+class VulkanCommandEncoder {
+ private:
+  VkCommandBuffer command_buffer_;
+
+  VkPipeline pipeline_ = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+  VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
+  std::vector<VkBuffer> vertex_buffers_{};
+  VkBuffer index_buffer_ = VK_NULL_HANDLE;
+  VkIndexType index_type_ = VK_INDEX_TYPE_MAX_ENUM;
+
+  uint32_t bind_count_ = 0;
+  uint32_t skipped_bind_count_ = 0;
+
+ public:
+  VulkanCommandEncoder() = delete;
+  VulkanCommandEncoder(const VulkanCommandEncoder &) = delete;
+  explicit VulkanCommandEncoder(VkCommandBuffer command_buffer);
+
+  void BindPipeline(const VulkanRenderingPipeline &pipeline);
+
+  // Forget the cached state, e.g. after the command buffer left a render pass.
+  void Reset();
+
+  [[nodiscard]] VkCommandBuffer GetCommandBuffer() const;
+
+  [[nodiscard]] uint32_t GetBindCount() const;
+
+  [[nodiscard]] uint32_t GetSkippedBindCount() const;
+
+  void AddStatistics(BindStatistics &statistics) const;
+};
+}
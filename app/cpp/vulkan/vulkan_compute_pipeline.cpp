@@ -0,0 +1,74 @@
+#include "vulkan_compute_pipeline.hpp"
+
+vulkan::VulkanComputePipeline::VulkanComputePipeline(
+    std::shared_ptr<VulkanRenderingContext> context,
+    std::shared_ptr<VulkanShader> compute_shader,
+    uint32_t descriptor_set_count) :
+    context_(context),
+    device_(context_->GetDevice()),
+    compute_shader_(compute_shader) {
+  descriptor_set_ = std::make_unique<VulkanDescriptorSet>(context_,
+                                                          std::vector{compute_shader_},
+                                                          descriptor_set_count);
+
+  const auto &push_constants = compute_shader_->GetPushConstants();
+  VkDescriptorSetLayout set_layout = descriptor_set_->GetLayout();
+  VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+  pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &set_layout;
+  pipeline_layout_info.pushConstantRangeCount = static_cast<uint32_t>(push_constants.size());
+  pipeline_layout_info.pPushConstantRanges = push_constants.data();
+  CHECK_VKCMD(vkCreatePipelineLayout(device_, &pipeline_layout_info, nullptr, &pipeline_layout_));
+
+  VkComputePipelineCreateInfo pipeline_info = {};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.stage = compute_shader_->GetShaderStageInfo();
+  pipeline_info.layout = pipeline_layout_;
+  pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+  CHECK_VKCMD(vkCreateComputePipelines(device_,
+                                       VK_NULL_HANDLE,
+                                       1,
+                                       &pipeline_info,
+                                       nullptr,
+                                       &pipeline_));
+}
+
+void vulkan::VulkanComputePipeline::SetBuffer(uint32_t binding,
+                                              std::shared_ptr<VulkanBuffer> buffer) {
+  descriptor_set_->SetBuffer(binding, buffer);
+}
+
+void vulkan::VulkanComputePipeline::SetImage(uint32_t binding,
+                                             VkImageView image_view,
+                                             VkSampler sampler,
+                                             VkImageLayout image_layout,
+                                             uint32_t descriptor_set_index) {
+  descriptor_set_->SetImage(binding, image_view, sampler, image_layout, descriptor_set_index);
+}
+
+void vulkan::VulkanComputePipeline::BindPipeline(VkCommandBuffer command_buffer,
+                                                 uint32_t descriptor_set_index) {
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+  if (!descriptor_set_->IsEmpty()) {
+    VkDescriptorSet descriptor_set = descriptor_set_->GetDescriptorSet(descriptor_set_index);
+    vkCmdBindDescriptorSets(command_buffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipeline_layout_,
+                            0,
+                            1,
+                            &descriptor_set,
+                            0,
+                            nullptr);
+  }
+}
+
+VkPipelineLayout vulkan::VulkanComputePipeline::GetPipelineLayout() const {
+  return pipeline_layout_;
+}
+
+vulkan::VulkanComputePipeline::~VulkanComputePipeline() {
+  context_->WaitForGpuIdle();
+  vkDestroyPipeline(device_, pipeline_, nullptr);
+  vkDestroyPipelineLayout(device_, pipeline_layout_, nullptr);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "vulkan_buffer.hpp"
+#include "vulkan_descriptor_set.hpp"
+#include "vulkan_rendering_context.hpp"
+#include "vulkan_shader.hpp"
+
+#include <memory>
+
+namespace vulkan {
+class VulkanComputePipeline {
+ private:
+  std::shared_ptr<VulkanRenderingContext> context_;
+  VkDevice device_;
+
+  VkPipeline pipeline_ = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+
+  std::shared_ptr<VulkanShader> compute_shader_ = nullptr;
+  std::unique_ptr<VulkanDescriptorSet> descriptor_set_ = nullptr;
+
+ public:
+  VulkanComputePipeline() = delete;
+  VulkanComputePipeline(const VulkanComputePipeline &) = delete;
+  VulkanComputePipeline(std::shared_ptr<VulkanRenderingContext> context,
+                        std::shared_ptr<VulkanShader> compute_shader,
+                        uint32_t descriptor_set_count = 1);
+
+  void SetBuffer(uint32_t binding, std::shared_ptr<VulkanBuffer> buffer);
+  void SetImage(uint32_t binding,
+                VkImageView image_view,
+                VkSampler sampler,
+                VkImageLayout image_layout,
+                uint32_t descriptor_set_index = 0);
+  void BindPipeline(VkCommandBuffer command_buffer, uint32_t descriptor_set_index = 0);
+  VkPipelineLayout GetPipelineLayout() const;
+  virtual ~VulkanComputePipeline();
+};
+}
@@ -0,0 +1,152 @@
+#include "vulkan_descriptor_set.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+vulkan::VulkanDescriptorSet::VulkanDescriptorSet(
+    std::shared_ptr<VulkanRenderingContext> context,
+    const std::vector<std::shared_ptr<VulkanShader>> &shaders,
+    uint32_t set_count) :
+    context_(context),
+    device_(context_->GetDevice()) {
+  if (set_count == 0) {
+    throw std::invalid_argument("at least one descriptor set is needed");
+  }
+  for (const auto &shader: shaders) {
+    for (const auto &binding: shader->GetDescriptorBindings()) {
+      auto it = std::find_if(bindings_.begin(), bindings_.end(),
+                             [&binding](const VkDescriptorSetLayoutBinding &existing) {
+                               return existing.binding == binding.binding;
+                             });
+      if (it == bindings_.end()) {
+        bindings_.push_back(binding);
+      } else if (it->descriptorType != binding.descriptorType) {
+        throw std::runtime_error("descriptor binding type mismatch between shader stages");
+      } else {
+        it->stageFlags |= binding.stageFlags;
+      }
+    }
+  }
+
+  VkDescriptorSetLayoutCreateInfo layout_info{
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = static_cast<uint32_t>(bindings_.size()),
+      .pBindings = bindings_.data(),
+  };
+  CHECK_VKCMD(vkCreateDescriptorSetLayout(device_,
+                                          &layout_info,
+                                          nullptr,
+                                          &descriptor_set_layout_));
+  if (bindings_.empty()) {
+    return;
+  }
+
+  std::vector<VkDescriptorPoolSize> pool_sizes{};
+  for (const auto &binding: bindings_) {
+    pool_sizes.push_back({
+        .type = binding.descriptorType,
+        .descriptorCount = binding.descriptorCount * set_count,
+    });
+  }
+  VkDescriptorPoolCreateInfo pool_info{
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .maxSets = set_count,
+      .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+      .pPoolSizes = pool_sizes.data(),
+  };
+  CHECK_VKCMD(vkCreateDescriptorPool(device_, &pool_info, nullptr, &descriptor_pool_));
+
+  const std::vector<VkDescriptorSetLayout> kSetLayouts(set_count, descriptor_set_layout_);
+  descriptor_sets_.resize(set_count);
+  VkDescriptorSetAllocateInfo alloc_info{
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = descriptor_pool_,
+      .descriptorSetCount = set_count,
+      .pSetLayouts = kSetLayouts.data(),
+  };
+  CHECK_VKCMD(vkAllocateDescriptorSets(device_, &alloc_info, descriptor_sets_.data()));
+}
+
+const VkDescriptorSetLayoutBinding &vulkan::VulkanDescriptorSet::GetBinding(uint32_t binding) const {
+  auto it = std::find_if(bindings_.begin(), bindings_.end(),
+                         [binding](const VkDescriptorSetLayoutBinding &existing) {
+                           return existing.binding == binding;
+                         });
+  if (it == bindings_.end()) {
+    throw std::runtime_error("unknown descriptor binding");
+  }
+  return *it;
+}
+
+void vulkan::VulkanDescriptorSet::SetBuffer(uint32_t binding, std::shared_ptr<VulkanBuffer> buffer) {
+  const auto &layout_binding = GetBinding(binding);
+  if (layout_binding.descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+      && layout_binding.descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+    throw std::runtime_error("descriptor binding is not a buffer");
+  }
+  VkDescriptorBufferInfo buffer_info{
+      .buffer = buffer->GetBuffer(),
+      .offset = 0,
+      .range = VK_WHOLE_SIZE,
+  };
+  for (VkDescriptorSet descriptor_set: descriptor_sets_) {
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = descriptor_set,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = layout_binding.descriptorType,
+        .pBufferInfo = &buffer_info,
+    };
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+  }
+  buffers_[binding] = buffer;
+}
+
+void vulkan::VulkanDescriptorSet::SetImage(uint32_t binding,
+                                           VkImageView image_view,
+                                           VkSampler sampler,
+                                           VkImageLayout image_layout,
+                                           uint32_t set_index) {
+  const auto &layout_binding = GetBinding(binding);
+  if (layout_binding.descriptorType != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+      && layout_binding.descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
+    throw std::runtime_error("descriptor binding is not an image");
+  }
+  VkDescriptorImageInfo image_info{
+      .sampler = layout_binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+                 ? sampler : VK_NULL_HANDLE,
+      .imageView = image_view,
+      .imageLayout = image_layout,
+  };
+  VkWriteDescriptorSet write{
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = descriptor_sets_.at(set_index),
+      .dstBinding = binding,
+      .dstArrayElement = 0,
+      .descriptorCount = 1,
+      .descriptorType = layout_binding.descriptorType,
+      .pImageInfo = &image_info,
+  };
+  vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
+
+bool vulkan::VulkanDescriptorSet::IsEmpty() const {
+  return bindings_.empty();
+}
+
+VkDescriptorSetLayout vulkan::VulkanDescriptorSet::GetLayout() const {
+  return descriptor_set_layout_;
+}
+
+VkDescriptorSet vulkan::VulkanDescriptorSet::GetDescriptorSet(uint32_t set_index) const {
+  return descriptor_sets_.at(set_index);
+}
+
+vulkan::VulkanDescriptorSet::~VulkanDescriptorSet() {
+  if (descriptor_pool_ != VK_NULL_HANDLE) {
+    vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+  }
+  vkDestroyDescriptorSetLayout(device_, descriptor_set_layout_, nullptr);
+}
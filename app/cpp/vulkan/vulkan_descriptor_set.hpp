@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "vulkan_buffer.hpp"
+#include "vulkan_rendering_context.hpp"
+#include "vulkan_shader.hpp"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace vulkan {
+// Allocates set_count sets of the same layout, e.g. one per ping-pong state of the images they
+// reference. Buffers are shared by all of them, images are written per set.
+class VulkanDescriptorSet {
+ private:
+  std::shared_ptr<VulkanRenderingContext> context_;
+  VkDevice device_;
+
+  std::vector<VkDescriptorSetLayoutBinding> bindings_{};
+  std::map<uint32_t, std::shared_ptr<VulkanBuffer>> buffers_{};
+
+  VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
+  VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> descriptor_sets_{};
+
+  [[nodiscard]] const VkDescriptorSetLayoutBinding &GetBinding(uint32_t binding) const;
+ public:
+  VulkanDescriptorSet() = delete;
+  VulkanDescriptorSet(const VulkanDescriptorSet &) = delete;
+  VulkanDescriptorSet(std::shared_ptr<VulkanRenderingContext> context,
+                      const std::vector<std::shared_ptr<VulkanShader>> &shaders,
+                      uint32_t set_count = 1);
+
+  void SetBuffer(uint32_t binding, std::shared_ptr<VulkanBuffer> buffer);
+
+  // Sampled or storage image binding, the sampler is ignored by the latter.
+  void SetImage(uint32_t binding,
+                VkImageView image_view,
+                VkSampler sampler,
+                VkImageLayout image_layout,
+                uint32_t set_index = 0);
+
+  [[nodiscard]] bool IsEmpty() const;
+
+  [[nodiscard]] VkDescriptorSetLayout GetLayout() const;
+
+  [[nodiscard]] VkDescriptorSet GetDescriptorSet(uint32_t set_index = 0) const;
+
+  virtual ~VulkanDescriptorSet();
+};
+}
@@ -0,0 +1,208 @@
+#include "vulkan_geometry_pool.hpp"
+
+#include <stdexcept>
+
+#include "vulkan_utils.hpp"
+
+namespace {
+struct DeviceAddressPushConstants {
+  glm::mat4 mvp;
+  VkDeviceAddress vertices;
+  VkDeviceAddress meshes;
+};
+}
+
+vulkan::VulkanGeometryPool::VulkanGeometryPool(std::shared_ptr<VulkanRenderingContext> context,
+                                               size_t vertex_capacity_in_bytes,
+                                               size_t index_capacity,
+                                               uint32_t mesh_capacity) :
+    context_(context),
+    vertex_capacity_(vertex_capacity_in_bytes),
+    index_capacity_(index_capacity),
+    mesh_capacity_(mesh_capacity) {
+  VkBufferUsageFlags storage_usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  if (context_->IsBufferDeviceAddressEnabled()) {
+    storage_usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR;
+  }
+  vertex_buffer_ = std::make_shared<VulkanBuffer>(context_,
+                                                  vertex_capacity_,
+                                                  storage_usage,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  index_buffer_ = std::make_shared<VulkanBuffer>(context_,
+                                                 sizeof(uint32_t) * index_capacity_,
+                                                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  mesh_buffer_ = std::make_shared<VulkanBuffer>(context_,
+                                                sizeof(GeometryPoolMesh) * mesh_capacity_,
+                                                storage_usage,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (UsesDeviceAddress()) {
+    vertex_address_ = vertex_buffer_->GetDeviceAddress();
+    mesh_address_ = mesh_buffer_->GetDeviceAddress();
+  }
+}
+
+void vulkan::VulkanGeometryPool::Upload(std::shared_ptr<VulkanBuffer> buffer,
+                                        const void *data,
+                                        size_t size,
+                                        size_t dst_offset) {
+  auto staging_buffer = std::make_shared<VulkanBuffer>(context_,
+                                                       size,
+                                                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                       GetVkMemoryType(MemoryType::HOST_VISIBLE));
+  staging_buffer->Update(data);
+  buffer->CopyFrom(staging_buffer, size, 0, dst_offset);
+}
+
+uint32_t vulkan::VulkanGeometryPool::AddMesh(const void *vertices,
+                                             size_t vertex_count,
+                                             const VertexBufferLayout &layout,
+                                             const std::vector<uint32_t> &indices) {
+  if (meshes_.size() >= mesh_capacity_) {
+    throw std::runtime_error("geometry pool is out of mesh slots");
+  }
+  const size_t kVertexStride = layout.GetElementSize() / sizeof(float);
+  const size_t kVertexSize = vertex_count * layout.GetElementSize();
+  if (vertex_size_ + kVertexSize > vertex_capacity_
+      || index_count_ + indices.size() > index_capacity_) {
+    throw std::runtime_error("geometry pool is out of memory");
+  }
+
+  uint32_t position_offset = kMissingVertexAttribute;
+  size_t position_components = 0;
+  GeometryPoolMesh mesh{
+      .position_offset = static_cast<uint32_t>(vertex_size_ / sizeof(float)),
+      .attribute_offset = 0,
+      .attribute_stride = 0,
+      .color_offset = kMissingVertexAttribute,
+      .color_components = 0,
+      .first_index = static_cast<uint32_t>(index_count_),
+      .index_count = static_cast<uint32_t>(indices.size()),
+      .padding = 0,
+  };
+  uint32_t offset = 0;
+  for (const auto &element: layout.GetElements()) {
+    if (element.type != DataType::FLOAT) {
+      throw std::runtime_error("vertex pulling supports float attributes only");
+    }
+    if (element.binding_index == 0) {
+      position_offset = offset;
+      position_components = element.count;
+    } else {
+      if (element.binding_index == 1) {
+        mesh.color_offset = mesh.attribute_stride;
+        mesh.color_components = static_cast<uint32_t>(element.count);
+      }
+      mesh.attribute_stride += static_cast<uint32_t>(element.count);
+    }
+    offset += static_cast<uint32_t>(element.count);
+  }
+  if (position_offset == kMissingVertexAttribute || position_components < 3) {
+    throw std::runtime_error("vertex layout has no position attribute");
+  }
+  mesh.attribute_offset = mesh.position_offset + static_cast<uint32_t>(3 * vertex_count);
+
+  // Deinterleave into the position stream followed by the remaining attributes.
+  const auto *source = static_cast<const float *>(vertices);
+  std::vector<float> streams(3 * vertex_count + mesh.attribute_stride * vertex_count);
+  float *positions = streams.data();
+  float *attributes = streams.data() + 3 * vertex_count;
+  for (size_t v = 0; v < vertex_count; v++) {
+    const float *vertex = source + v * kVertexStride;
+    for (size_t i = 0; i < 3; i++) {
+      *positions++ = vertex[position_offset + i];
+    }
+    for (size_t i = 0; i < kVertexStride; i++) {
+      if (i < position_offset || i >= position_offset + position_components) {
+        *attributes++ = vertex[i];
+      }
+    }
+  }
+
+  Upload(vertex_buffer_, streams.data(), sizeof(float) * streams.size(), vertex_size_);
+  Upload(index_buffer_, indices.data(), sizeof(uint32_t) * indices.size(),
+         sizeof(uint32_t) * index_count_);
+  Upload(mesh_buffer_, &mesh, sizeof(mesh), sizeof(GeometryPoolMesh) * meshes_.size());
+
+  vertex_size_ += sizeof(float) * streams.size();
+  index_count_ += indices.size();
+  meshes_.push_back(mesh);
+  lods_.push_back({{mesh.first_index, mesh.index_count, 0.0f}});
+  return static_cast<uint32_t>(meshes_.size() - 1);
+}
+
+void vulkan::VulkanGeometryPool::AddLod(uint32_t mesh_id,
+                                        const std::vector<uint32_t> &indices,
+                                        float error) {
+  auto &lods = lods_.at(mesh_id);
+  if (index_count_ + indices.size() > index_capacity_) {
+    throw std::runtime_error("geometry pool is out of memory");
+  }
+  Upload(index_buffer_, indices.data(), sizeof(uint32_t) * indices.size(),
+         sizeof(uint32_t) * index_count_);
+  lods.push_back({
+      .first_index = static_cast<uint32_t>(index_count_),
+      .index_count = static_cast<uint32_t>(indices.size()),
+      .error = error,
+  });
+  index_count_ += indices.size();
+}
+
+const vulkan::GeometryPoolMesh &vulkan::VulkanGeometryPool::GetMesh(uint32_t mesh_id) const {
+  return meshes_.at(mesh_id);
+}
+
+const std::vector<vulkan::GeometryPoolLod> &vulkan::VulkanGeometryPool::GetLods(
+    uint32_t mesh_id) const {
+  return lods_.at(mesh_id);
+}
+
+bool vulkan::VulkanGeometryPool::UsesDeviceAddress() const {
+  return context_->IsBufferDeviceAddressEnabled();
+}
+
+std::shared_ptr<vulkan::VulkanBuffer> vulkan::VulkanGeometryPool::GetVertexBuffer() const {
+  return vertex_buffer_;
+}
+
+std::shared_ptr<vulkan::VulkanBuffer> vulkan::VulkanGeometryPool::GetIndexBuffer() const {
+  return index_buffer_;
+}
+
+std::shared_ptr<vulkan::VulkanBuffer> vulkan::VulkanGeometryPool::GetMeshBuffer() const {
+  return mesh_buffer_;
+}
+
+void vulkan::VulkanGeometryPool::Draw(VkCommandBuffer command_buffer,
+                                      VkPipelineLayout pipeline_layout,
+                                      uint32_t mesh_id,
+                                      const glm::mat4 &transform,
+                                      uint32_t lod) const {
+  const auto &mesh_lod = GetLods(mesh_id).at(lod);
+  if (UsesDeviceAddress()) {
+    DeviceAddressPushConstants push_constants{
+        .mvp = transform,
+        .vertices = vertex_address_,
+        .meshes = mesh_address_,
+    };
+    vkCmdPushConstants(command_buffer,
+                       pipeline_layout,
+                       VK_SHADER_STAGE_VERTEX_BIT,
+                       0,
+                       sizeof(push_constants),
+                       &push_constants);
+  } else {
+    vkCmdPushConstants(command_buffer,
+                       pipeline_layout,
+                       VK_SHADER_STAGE_VERTEX_BIT,
+                       0,
+                       sizeof(transform),
+                       &transform);
+  }
+  vkCmdDrawIndexed(command_buffer,
+                   mesh_lod.index_count,
+                   1,
+                   mesh_lod.first_index,
+                   0,
+                   mesh_id);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "vertex_buffer_layout.hpp"
+#include "vulkan_buffer.hpp"
+#include "vulkan_rendering_context.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace vulkan {
+constexpr uint32_t kGeometryPoolVerticesBinding = 0;
+constexpr uint32_t kGeometryPoolMeshesBinding = 1;
+constexpr uint32_t kMissingVertexAttribute = 0xFFFFFFFF;
+
+// Matches the std430 Mesh struct read by the vertex pulling shaders; offsets are in floats.
+// Positions are stored as a tightly packed xyz stream ahead of the other, interleaved attributes
+// so depth-only passes fetch nothing but positions.
+struct GeometryPoolMesh {
+  uint32_t position_offset;
+  uint32_t attribute_offset;
+  uint32_t attribute_stride;
+  uint32_t color_offset;
+  uint32_t color_components;
+  uint32_t first_index;
+  uint32_t index_count;
+  uint32_t padding;
+};
+
+// Index range of one LOD; every LOD of a mesh indexes the same vertices.
+struct GeometryPoolLod {
+  uint32_t first_index;
+  uint32_t index_count;
+  float error;
+};
+
+// Vertices of every mesh live in one storage buffer and indices in one index buffer, so meshes
+// with different vertex layouts can be drawn by the same pipeline. The mesh id is passed to the
+// vertex shader as firstInstance and read back as gl_InstanceIndex.
+class VulkanGeometryPool {
+ private:
+  std::shared_ptr<VulkanRenderingContext> context_;
+
+  size_t vertex_capacity_;
+  size_t index_capacity_;
+  uint32_t mesh_capacity_;
+  size_t vertex_size_ = 0;
+  size_t index_count_ = 0;
+
+  std::vector<GeometryPoolMesh> meshes_{};
+  std::vector<std::vector<GeometryPoolLod>> lods_{};
+
+  std::shared_ptr<VulkanBuffer> vertex_buffer_ = nullptr;
+  std::shared_ptr<VulkanBuffer> index_buffer_ = nullptr;
+  std::shared_ptr<VulkanBuffer> mesh_buffer_ = nullptr;
+  VkDeviceAddress vertex_address_ = 0;
+  VkDeviceAddress mesh_address_ = 0;
+
+  void Upload(std::shared_ptr<VulkanBuffer> buffer,
+              const void *data,
+              size_t size,
+              size_t dst_offset);
+ public:
+  VulkanGeometryPool() = delete;
+  VulkanGeometryPool(const VulkanGeometryPool &) = delete;
+  VulkanGeometryPool(std::shared_ptr<VulkanRenderingContext> context,
+                     size_t vertex_capacity_in_bytes,
+                     size_t index_capacity,
+                     uint32_t mesh_capacity);
+
+  uint32_t AddMesh(const void *vertices,
+                   size_t vertex_count,
+                   const VertexBufferLayout &layout,
+                   const std::vector<uint32_t> &indices);
+
+  // Appends a coarser LOD; LOD 0 is the index buffer passed to AddMesh.
+  void AddLod(uint32_t mesh_id, const std::vector<uint32_t> &indices, float error);
+
+  [[nodiscard]] const GeometryPoolMesh &GetMesh(uint32_t mesh_id) const;
+
+  [[nodiscard]] const std::vector<GeometryPoolLod> &GetLods(uint32_t mesh_id) const;
+
+  // Device addresses replace the descriptor set bindings when the device supports them.
+  [[nodiscard]] bool UsesDeviceAddress() const;
+
+  [[nodiscard]] std::shared_ptr<VulkanBuffer> GetVertexBuffer() const;
+
+  [[nodiscard]] std::shared_ptr<VulkanBuffer> GetIndexBuffer() const;
+
+  [[nodiscard]] std::shared_ptr<VulkanBuffer> GetMeshBuffer() const;
+
+  void Draw(VkCommandBuffer command_buffer,
+            VkPipelineLayout pipeline_layout,
+            uint32_t mesh_id,
+            const glm::mat4 &transform,
+            uint32_t lod = 0) const;
+
+  virtual ~VulkanGeometryPool() = default;
+};
+}
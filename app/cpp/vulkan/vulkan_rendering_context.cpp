@@ -6,16 +6,31 @@
 
 vulkan::VulkanRenderingContext::VulkanRenderingContext(
     VkPhysicalDevice physical_device,
+    const VkPhysicalDeviceFeatures &enabled_features,
+    bool buffer_device_address_enabled,
     VkDevice device,
     VkQueue graphics_queue,
     VkCommandPool graphics_pool,
-    VkFormat color_attachment_format) :
+    VkFormat color_attachment_format,
+    uint32_t view_count,
+    bool fragment_density_map_enabled) :
     color_attachment_format_(color_attachment_format),
     physical_device_(physical_device),
+    enabled_features_(enabled_features),
+    buffer_device_address_enabled_(buffer_device_address_enabled),
+    view_count_(view_count),
+    fragment_density_map_enabled_(fragment_density_map_enabled),
     device_(device),
     graphics_queue_(graphics_queue),
     graphics_pool_(graphics_pool),
     recommended_msaa_samples_(GetMaxUsableSampleCount()) {
+  if (buffer_device_address_enabled_) {
+    get_buffer_device_address_ = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(
+        vkGetDeviceProcAddr(device_, "vkGetBufferDeviceAddressKHR"));
+    if (get_buffer_device_address_ == nullptr) {
+      throw std::runtime_error("unable to obtain address of vkGetBufferDeviceAddressKHR");
+    }
+  }
 
   depth_attachment_format_ = FindSupportedFormat(
       {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
@@ -23,7 +38,20 @@ vulkan::VulkanRenderingContext::VulkanRenderingContext(
       VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
   );
 
-  ///render pass
+  render_pass_ = CreateRenderPass(VK_IMAGE_LAYOUT_UNDEFINED);
+  depth_sampling_render_pass_ = CreateRenderPass(VK_IMAGE_LAYOUT_UNDEFINED, false, true);
+  // Render pass compatibility includes the density map attachment, and foveation through the
+  // runtime's density map needs neither the inset nor the sampling pass.
+  if (!fragment_density_map_enabled_) {
+    inset_render_pass_ = CreateRenderPass(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    sampling_render_pass_ = CreateRenderPass(VK_IMAGE_LAYOUT_UNDEFINED, true);
+  }
+}
+
+VkRenderPass vulkan::VulkanRenderingContext::CreateRenderPass(
+    VkImageLayout resolve_initial_layout,
+    bool sampled_afterwards,
+    bool depth_sampled_afterwards) const {
   VkAttachmentDescription depth_attachment = {};
   depth_attachment.format = depth_attachment_format_;
   depth_attachment.samples = recommended_msaa_samples_;
@@ -33,6 +61,11 @@ vulkan::VulkanRenderingContext::VulkanRenderingContext(
   depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
   depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  if (sampled_afterwards || depth_sampled_afterwards) {
+    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  }
 
   VkAttachmentReference depth_attachment_ref = {};
   depth_attachment_ref.attachment = 1;
@@ -59,8 +92,11 @@ vulkan::VulkanRenderingContext::VulkanRenderingContext(
   color_attachment_resolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   color_attachment_resolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   color_attachment_resolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  color_attachment_resolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  color_attachment_resolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // Anything but undefined keeps the resolve target outside of the render area.
+  color_attachment_resolve.initialLayout = resolve_initial_layout;
+  color_attachment_resolve.finalLayout = sampled_afterwards
+                                        ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                        : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentReference color_attachment_resolve_ref = {};
   color_attachment_resolve_ref.attachment = 2;
@@ -83,8 +119,34 @@ vulkan::VulkanRenderingContext::VulkanRenderingContext(
       VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
   dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
-  std::array<VkAttachmentDescription, 3>
+  // Compute or fragment shaders read the attachments right after the pass.
+  VkSubpassDependency sampling_dependency = {};
+  sampling_dependency.srcSubpass = 0;
+  sampling_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+  sampling_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+      | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  sampling_dependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+      | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  sampling_dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+      | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  sampling_dependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  const std::array<VkSubpassDependency, 2> kDependencies = {dependency, sampling_dependency};
+
+  VkAttachmentDescription density_map_attachment = {};
+  density_map_attachment.format = VK_FORMAT_R8G8_UNORM;
+  density_map_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  density_map_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  density_map_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  density_map_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  density_map_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  density_map_attachment.initialLayout = VK_IMAGE_LAYOUT_FRAGMENT_DENSITY_MAP_OPTIMAL_EXT;
+  density_map_attachment.finalLayout = VK_IMAGE_LAYOUT_FRAGMENT_DENSITY_MAP_OPTIMAL_EXT;
+
+  std::vector<VkAttachmentDescription>
       attachments = {color_attachment, depth_attachment, color_attachment_resolve};
+  if (fragment_density_map_enabled_) {
+    attachments.push_back(density_map_attachment);
+  }
 
   VkRenderPassCreateInfo render_pass_info = {};
   render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -92,12 +154,40 @@ vulkan::VulkanRenderingContext::VulkanRenderingContext(
   render_pass_info.pAttachments = attachments.data();
   render_pass_info.subpassCount = 1;
   render_pass_info.pSubpasses = &sub_pass;
-  render_pass_info.dependencyCount = 1;
-  render_pass_info.pDependencies = &dependency;
+  render_pass_info.dependencyCount = sampled_afterwards || depth_sampled_afterwards ? 2 : 1;
+  render_pass_info.pDependencies = kDependencies.data();
+
+  const uint32_t kViewMask = (1u << view_count_) - 1;
+  VkRenderPassMultiviewCreateInfo multiview_info{
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO,
+      .subpassCount = 1,
+      .pViewMasks = &kViewMask,
+      .correlationMaskCount = 1,
+      .pCorrelationMasks = &kViewMask,
+  };
+  VkRenderPassFragmentDensityMapCreateInfoEXT density_map_info{
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_FRAGMENT_DENSITY_MAP_CREATE_INFO_EXT,
+      .fragmentDensityMapAttachment = {
+          .attachment = kDensityMapAttachment,
+          .layout = VK_IMAGE_LAYOUT_FRAGMENT_DENSITY_MAP_OPTIMAL_EXT,
+      },
+  };
+  const void *render_pass_next = nullptr;
+  if (fragment_density_map_enabled_) {
+    density_map_info.pNext = render_pass_next;
+    render_pass_next = &density_map_info;
+  }
+  if (view_count_ > 1) {
+    multiview_info.pNext = render_pass_next;
+    render_pass_next = &multiview_info;
+  }
+  render_pass_info.pNext = render_pass_next;
 
-  if (vkCreateRenderPass(device_, &render_pass_info, nullptr, &render_pass_) != VK_SUCCESS) {
+  VkRenderPass render_pass = VK_NULL_HANDLE;
+  if (vkCreateRenderPass(device_, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
+  return render_pass;
 }
 
 VkSampleCountFlagBits vulkan::VulkanRenderingContext::GetMaxUsableSampleCount() {
@@ -132,6 +222,33 @@ VkDevice vulkan::VulkanRenderingContext::GetDevice() const {
   return device_;
 }
 
+const VkPhysicalDeviceFeatures &vulkan::VulkanRenderingContext::GetEnabledFeatures() const {
+  return enabled_features_;
+}
+
+bool vulkan::VulkanRenderingContext::IsBufferDeviceAddressEnabled() const {
+  return buffer_device_address_enabled_;
+}
+
+uint32_t vulkan::VulkanRenderingContext::GetViewCount() const {
+  return view_count_;
+}
+
+bool vulkan::VulkanRenderingContext::IsFragmentDensityMapEnabled() const {
+  return fragment_density_map_enabled_;
+}
+
+VkDeviceAddress vulkan::VulkanRenderingContext::GetBufferDeviceAddress(VkBuffer buffer) const {
+  if (!buffer_device_address_enabled_) {
+    throw std::runtime_error("buffer device address is not enabled");
+  }
+  VkBufferDeviceAddressInfoKHR address_info{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR,
+      .buffer = buffer,
+  };
+  return get_buffer_device_address_(device_, &address_info);
+}
+
 void vulkan::VulkanRenderingContext::WaitForGpuIdle() const {
   vkDeviceWaitIdle(device_);
 }
@@ -151,6 +268,12 @@ VkFormat vulkan::VulkanRenderingContext::FindSupportedFormat(
   }
   throw std::runtime_error("failed to find supported format!");
 }
+
+bool vulkan::VulkanRenderingContext::IsVertexFormatSupported(VkFormat format) const {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physical_device_, format, &props);
+  return (props.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) != 0;
+}
 void vulkan::VulkanRenderingContext::CreateImage(uint32_t width,
                                                  uint32_t height,
                                                  VkSampleCountFlagBits num_samples,
@@ -158,7 +281,8 @@ void vulkan::VulkanRenderingContext::CreateImage(uint32_t width,
                                                  VkImageUsageFlags usage,
                                                  VkMemoryPropertyFlags properties,
                                                  VkImage *image,
-                                                 VkDeviceMemory *image_memory) const {
+                                                 VkDeviceMemory *image_memory,
+                                                 uint32_t array_layers) const {
   VkImageCreateInfo image_info = {};
   image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   image_info.imageType = VK_IMAGE_TYPE_2D;
@@ -166,7 +290,7 @@ void vulkan::VulkanRenderingContext::CreateImage(uint32_t width,
   image_info.extent.height = height;
   image_info.extent.depth = 1;
   image_info.mipLevels = 1;
-  image_info.arrayLayers = 1;
+  image_info.arrayLayers = array_layers;
   image_info.format = format;
   image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
   image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -197,6 +321,18 @@ VkRenderPass vulkan::VulkanRenderingContext::GetRenderPass() const {
   return render_pass_;
 }
 
+VkRenderPass vulkan::VulkanRenderingContext::GetInsetRenderPass() const {
+  return inset_render_pass_;
+}
+
+VkRenderPass vulkan::VulkanRenderingContext::GetSamplingRenderPass() const {
+  return sampling_render_pass_;
+}
+
+VkRenderPass vulkan::VulkanRenderingContext::GetDepthSamplingRenderPass() const {
+  return depth_sampling_render_pass_;
+}
+
 void vulkan::VulkanRenderingContext::TransitionImageLayout(VkImage image,
                                                            VkImageLayout old_layout,
                                                            VkImageLayout new_layout) {
@@ -212,7 +348,7 @@ void vulkan::VulkanRenderingContext::TransitionImageLayout(VkImage image,
   barrier.subresourceRange.baseMipLevel = 0;
   barrier.subresourceRange.levelCount = 1;
   barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
+  barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
   VkPipelineStageFlags source_stage;
   VkPipelineStageFlags destination_stage;
   if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED
@@ -280,6 +416,13 @@ void vulkan::VulkanRenderingContext::CreateBuffer(VkDeviceSize size,
   alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   alloc_info.allocationSize = mem_requirements.size;
   alloc_info.memoryTypeIndex = FindMemoryType(mem_requirements.memoryTypeBits, properties);
+  VkMemoryAllocateFlagsInfoKHR alloc_flags_info{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR,
+      .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR,
+  };
+  if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR) {
+    alloc_info.pNext = &alloc_flags_info;
+  }
   if (vkAllocateMemory(device_, &alloc_info, nullptr, buffer_memory) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate buffer memory!");
   }
@@ -317,17 +460,18 @@ uint32_t vulkan::VulkanRenderingContext::FindMemoryType(uint32_t type_filter,
 void vulkan::VulkanRenderingContext::CreateImageView(VkImage image,
                                                      VkFormat format,
                                                      VkImageAspectFlagBits aspect_mask,
-                                                     VkImageView *image_view) {
+                                                     VkImageView *image_view,
+                                                     uint32_t layer_count) {
   VkImageViewCreateInfo view_info = {};
   view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   view_info.image = image;
-  view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  view_info.viewType = layer_count > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
   view_info.format = format;
   view_info.subresourceRange.aspectMask = aspect_mask;
   view_info.subresourceRange.baseMipLevel = 0;
   view_info.subresourceRange.levelCount = 1;
   view_info.subresourceRange.baseArrayLayer = 0;
-  view_info.subresourceRange.layerCount = 1;
+  view_info.subresourceRange.layerCount = layer_count;
   if (vkCreateImageView(device_, &view_info, nullptr, image_view) != VK_SUCCESS) {
     throw std::runtime_error("failed to create texture image view!");
   }
@@ -365,8 +509,21 @@ VkSampleCountFlagBits vulkan::VulkanRenderingContext::GetRecommendedMsaaSamples(
   return recommended_msaa_samples_;
 }
 
+float vulkan::VulkanRenderingContext::GetTimestampPeriod() const {
+  VkPhysicalDeviceProperties physical_device_properties;
+  vkGetPhysicalDeviceProperties(physical_device_, &physical_device_properties);
+  return physical_device_properties.limits.timestampPeriod;
+}
+
 vulkan::VulkanRenderingContext::~VulkanRenderingContext() {
   vkDestroyRenderPass(device_, render_pass_, nullptr);
+  vkDestroyRenderPass(device_, depth_sampling_render_pass_, nullptr);
+  if (inset_render_pass_ != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(device_, inset_render_pass_, nullptr);
+  }
+  if (sampling_render_pass_ != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(device_, sampling_render_pass_, nullptr);
+  }
 }
 
 VkFormat vulkan::VulkanRenderingContext::GetDepthAttachmentFormat() const {
@@ -15,22 +15,53 @@ class VulkanRenderingContext
   VkFormat depth_attachment_format_ = VK_FORMAT_UNDEFINED;
 
   VkPhysicalDevice physical_device_;
+  VkPhysicalDeviceFeatures enabled_features_;
+  bool buffer_device_address_enabled_;
+  uint32_t view_count_;
+  bool fragment_density_map_enabled_;
   VkDevice device_;
   VkQueue graphics_queue_;
   VkCommandPool graphics_pool_;
   VkSampleCountFlagBits recommended_msaa_samples_;
   VkRenderPass render_pass_ = VK_NULL_HANDLE;
+  VkRenderPass inset_render_pass_ = VK_NULL_HANDLE;
+  VkRenderPass sampling_render_pass_ = VK_NULL_HANDLE;
+  VkRenderPass depth_sampling_render_pass_ = VK_NULL_HANDLE;
+  PFN_vkGetBufferDeviceAddressKHR get_buffer_device_address_ = nullptr;
 
   VkSampleCountFlagBits GetMaxUsableSampleCount();
+  [[nodiscard]] VkRenderPass CreateRenderPass(VkImageLayout resolve_initial_layout,
+                                              bool sampled_afterwards = false,
+                                              bool depth_sampled_afterwards = false) const;
  public:
+  // Framebuffer attachment of the runtime's fragment density map, after color, depth and resolve.
+  static constexpr uint32_t kDensityMapAttachment = 3;
+
   VulkanRenderingContext(VkPhysicalDevice physical_device,
+                         const VkPhysicalDeviceFeatures &enabled_features,
+                         bool buffer_device_address_enabled,
                          VkDevice device,
                          VkQueue graphics_queue,
                          VkCommandPool graphics_pool,
-                         VkFormat color_attachment_format);
+                         VkFormat color_attachment_format,
+                         uint32_t view_count = 1,
+                         bool fragment_density_map_enabled = false);
 
   [[nodiscard]] VkDevice GetDevice() const;
 
+  [[nodiscard]] const VkPhysicalDeviceFeatures &GetEnabledFeatures() const;
+
+  [[nodiscard]] bool IsBufferDeviceAddressEnabled() const;
+
+  [[nodiscard]] VkDeviceAddress GetBufferDeviceAddress(VkBuffer buffer) const;
+
+  // Views rendered by the render pass at once; above 1 every attachment is an array with a layer
+  // per view and the render pass broadcasts draws to all of them through VK_KHR_multiview.
+  [[nodiscard]] uint32_t GetViewCount() const;
+
+  // The render pass then expects a VK_FORMAT_R8G8_UNORM density map, e.g. from XR_FB_foveation.
+  [[nodiscard]] bool IsFragmentDensityMapEnabled() const;
+
   VkFormat GetDepthAttachmentFormat() const;
 
   void WaitForGpuIdle() const;
@@ -50,7 +81,8 @@ class VulkanRenderingContext
                    VkImageUsageFlags usage,
                    VkMemoryPropertyFlags properties,
                    VkImage *image,
-                   VkDeviceMemory *image_memory) const;
+                   VkDeviceMemory *image_memory,
+                   uint32_t array_layers = 1) const;
 
   void CopyBuffer(VkBuffer src_buffer,
                   VkBuffer dst_buffer,
@@ -65,7 +97,8 @@ class VulkanRenderingContext
   void CreateImageView(VkImage image,
                        VkFormat format,
                        VkImageAspectFlagBits aspect_mask,
-                       VkImageView *image_view);
+                       VkImageView *image_view,
+                       uint32_t layer_count = 1);
 
   VkCommandBuffer BeginSingleTimeCommands(VkCommandPool command_pool);
 
@@ -76,6 +109,19 @@ class VulkanRenderingContext
 
   [[nodiscard]] VkRenderPass GetRenderPass() const;
 
+  // Compatible with the render pass, but keeps the resolve target outside of the render area so
+  // a full resolution inset can be drawn over an upscaled periphery. Null with a density map.
+  [[nodiscard]] VkRenderPass GetInsetRenderPass() const;
+
+  // Compatible with the render pass, but stores depth and leaves depth and the resolve target
+  // ready to be sampled by compute or fragment shaders, as the temporal upsampler and the far
+  // field reprojection do. Null with a density map.
+  [[nodiscard]] VkRenderPass GetSamplingRenderPass() const;
+
+  // Compatible with the render pass and like it resolves into a presentable target, but stores
+  // depth and leaves it ready to be sampled, for the depth submitted to the compositor.
+  [[nodiscard]] VkRenderPass GetDepthSamplingRenderPass() const;
+
   VkCommandPool GetGraphicsPool() const;
 
   VkQueue GetGraphicsQueue() const;
@@ -85,5 +131,10 @@ class VulkanRenderingContext
                                              VkFormatFeatureFlags features) const;
 
   [[nodiscard]] VkSampleCountFlagBits GetRecommendedMsaaSamples() const;
+
+  // Nanoseconds per timestamp query tick.
+  [[nodiscard]] float GetTimestampPeriod() const;
+
+  [[nodiscard]] bool IsVertexFormatSupported(VkFormat format) const;
 };
 }
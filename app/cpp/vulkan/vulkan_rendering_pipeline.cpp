@@ -1,21 +1,75 @@
 #include "vulkan_rendering_pipeline.hpp"
 
+#include <spdlog/fmt/fmt.h>
+
 vulkan::VulkanRenderingPipeline::VulkanRenderingPipeline(
     std::shared_ptr<VulkanRenderingContext> context,
     std::shared_ptr<VulkanShader> vertex_shader,
     std::shared_ptr<VulkanShader> fragment_shader,
     const VertexBufferLayout &vbl,
     RenderingPipelineConfig config) :
+    VulkanRenderingPipeline(context,
+                            vertex_shader,
+                            fragment_shader,
+                            vbl,
+                            config,
+                            context->GetRenderPass(),
+                            context->GetRecommendedMsaaSamples()) {}
+
+vulkan::VulkanRenderingPipeline::VulkanRenderingPipeline(
+    std::shared_ptr<VulkanRenderingContext> context,
+    std::shared_ptr<VulkanShader> vertex_shader,
+    std::shared_ptr<VulkanShader> fragment_shader,
+    const VertexBufferLayout &vbl,
+    RenderingPipelineConfig config,
+    VkRenderPass render_pass,
+    VkSampleCountFlagBits samples) :
     context_(context),
     device_(context_->GetDevice()),
-    config_(config) {
+    config_(config),
+    render_pass_(render_pass),
+    samples_(samples) {
   this->vertex_shader_ = std::dynamic_pointer_cast<VulkanShader>(vertex_shader);
   this->fragment_shader_ = std::dynamic_pointer_cast<VulkanShader>(fragment_shader);
+  descriptor_set_ = std::make_unique<VulkanDescriptorSet>(
+      context_,
+      std::vector{vertex_shader_, fragment_shader_});
+  CreatePipeline(vbl);
+}
+
+vulkan::VulkanRenderingPipeline::VulkanRenderingPipeline(
+    std::shared_ptr<VulkanRenderingContext> context,
+    std::shared_ptr<VulkanShader> vertex_shader,
+    const VertexBufferLayout &vbl,
+    RenderingPipelineConfig config) :
+    context_(context),
+    device_(context_->GetDevice()),
+    config_(config),
+    render_pass_(context_->GetRenderPass()),
+    samples_(context_->GetRecommendedMsaaSamples()) {
+  this->vertex_shader_ = std::dynamic_pointer_cast<VulkanShader>(vertex_shader);
+  descriptor_set_ = std::make_unique<VulkanDescriptorSet>(context_, std::vector{vertex_shader_});
   CreatePipeline(vbl);
 }
 
-void vulkan::VulkanRenderingPipeline::SetVertexBuffer(std::shared_ptr<VulkanBuffer> buffer) {
-  this->vertex_buffer_ = std::dynamic_pointer_cast<VulkanBuffer>(buffer);
+void vulkan::VulkanRenderingPipeline::SetVertexBuffer(std::shared_ptr<VulkanBuffer> buffer,
+                                                      uint32_t binding) {
+  if (binding >= vertex_buffers_.size()) {
+    vertex_buffers_.resize(binding + 1);
+  }
+  vertex_buffers_[binding] = std::dynamic_pointer_cast<VulkanBuffer>(buffer);
+}
+
+void vulkan::VulkanRenderingPipeline::SetBuffer(uint32_t binding,
+                                                std::shared_ptr<VulkanBuffer> buffer) {
+  descriptor_set_->SetBuffer(binding, buffer);
+}
+
+void vulkan::VulkanRenderingPipeline::SetImage(uint32_t binding,
+                                               VkImageView image_view,
+                                               VkSampler sampler,
+                                               VkImageLayout image_layout) {
+  descriptor_set_->SetImage(binding, image_view, sampler, image_layout);
 }
 
 void vulkan::VulkanRenderingPipeline::SetIndexBuffer(std::shared_ptr<VulkanBuffer> buffer,
@@ -25,17 +79,19 @@ void vulkan::VulkanRenderingPipeline::SetIndexBuffer(std::shared_ptr<VulkanBuffe
 }
 
 void vulkan::VulkanRenderingPipeline::CreatePipeline(const VertexBufferLayout &vbl) {
-  VkPipelineShaderStageCreateInfo shader_stages[] = {
-      vertex_shader_->GetShaderStageInfo(),
-      fragment_shader_->GetShaderStageInfo()
+  std::vector<VkPipelineShaderStageCreateInfo> shader_stages = {
+      vertex_shader_->GetShaderStageInfo()
   };
-  auto vertex_push_constants = vertex_shader_->GetPushConstants();
-  auto fragment_push_constants = fragment_shader_->GetPushConstants();
-  auto pipeline_push_constants = vertex_push_constants;
-  pipeline_push_constants.reserve(pipeline_push_constants.size() + fragment_push_constants.size());
-  pipeline_push_constants.insert(pipeline_push_constants.end(),
-                                 fragment_push_constants.begin(),
-                                 fragment_push_constants.end());
+  auto pipeline_push_constants = vertex_shader_->GetPushConstants();
+  if (fragment_shader_ != nullptr) {
+    shader_stages.push_back(fragment_shader_->GetShaderStageInfo());
+    auto fragment_push_constants = fragment_shader_->GetPushConstants();
+    pipeline_push_constants.reserve(pipeline_push_constants.size()
+                                        + fragment_push_constants.size());
+    pipeline_push_constants.insert(pipeline_push_constants.end(),
+                                   fragment_push_constants.begin(),
+                                   fragment_push_constants.end());
+  }
 
   VkPipelineInputAssemblyStateCreateInfo input_assembly = {};
   input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -63,10 +119,10 @@ void vulkan::VulkanRenderingPipeline::CreatePipeline(const VertexBufferLayout &v
   multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
   multisampling.sampleShadingEnable = VK_FALSE;
   multisampling.alphaToCoverageEnable = VK_FALSE;
-  multisampling.rasterizationSamples = context_->GetRecommendedMsaaSamples();
+  multisampling.rasterizationSamples = samples_;
 
   VkPipelineColorBlendAttachmentState color_blend_attachment = {};
-  color_blend_attachment.colorWriteMask =
+  color_blend_attachment.colorWriteMask = fragment_shader_ == nullptr ? 0 :
       VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
           | VK_COLOR_COMPONENT_A_BIT;
   color_blend_attachment.blendEnable = VK_FALSE;
@@ -93,8 +149,9 @@ void vulkan::VulkanRenderingPipeline::CreatePipeline(const VertexBufferLayout &v
 
   VkPipelineLayoutCreateInfo pipeline_layout_info = {};
   pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipeline_layout_info.setLayoutCount = 0;
-  pipeline_layout_info.pSetLayouts = nullptr;
+  VkDescriptorSetLayout set_layout = descriptor_set_->GetLayout();
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &set_layout;
   pipeline_layout_info.pushConstantRangeCount = pipeline_push_constants.size();
   pipeline_layout_info.pPushConstantRanges = pipeline_push_constants.data();
   CHECK_VKCMD(vkCreatePipelineLayout(device_, &pipeline_layout_info, nullptr, &pipeline_layout_));
@@ -107,37 +164,48 @@ void vulkan::VulkanRenderingPipeline::CreatePipeline(const VertexBufferLayout &v
   dynamic_state_create_info.pDynamicStates = dynamic_states.data();
 
   const auto &elements = vbl.GetElements();
-  auto stride = static_cast<uint32_t>(vbl.GetElementSize());
-  size_t offset = 0;
+  std::map<uint32_t, size_t> binding_offsets{};
   std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
   for (auto element: elements) {
+    VkFormat format = GetVkFormat(element.type, static_cast<uint32_t>(element.count));
+    if (!context_->IsVertexFormatSupported(format)) {
+      throw std::runtime_error(fmt::format("vertex format {} is not supported",
+                                           static_cast<int>(format)));
+    }
+    size_t &offset = binding_offsets[element.buffer_binding];
     VkVertexInputAttributeDescription description{
         .location = element.binding_index,
-        .binding = 0,
-        .format = GetVkFormat(element.type, static_cast<uint32_t>(element.count)),
+        .binding = element.buffer_binding,
+        .format = format,
         .offset = static_cast<uint32_t>(offset),
     };
     attribute_descriptions.push_back(description);
-    offset += element.count * GetDataTypeSizeInBytes(element.type);
+    offset += GetAttributeSizeInBytes(element.type, element.count);
   }
 
-  VkVertexInputBindingDescription vertex_input_binding_description{};
-  vertex_input_binding_description.binding = 0;
-  vertex_input_binding_description.stride = stride;
-  vertex_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  // An empty layout means the vertex shader pulls its attributes from storage buffers.
+  std::vector<VkVertexInputBindingDescription> binding_descriptions{};
+  for (uint32_t binding: vbl.GetBindings()) {
+    binding_descriptions.push_back({
+        .binding = binding,
+        .stride = static_cast<uint32_t>(vbl.GetStride(binding)),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    });
+  }
 
   VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
   vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertex_input_info.vertexBindingDescriptionCount = 1;
-  vertex_input_info.pVertexBindingDescriptions = &vertex_input_binding_description;
+  vertex_input_info.vertexBindingDescriptionCount =
+      static_cast<uint32_t>(binding_descriptions.size());
+  vertex_input_info.pVertexBindingDescriptions = binding_descriptions.data();
   vertex_input_info.vertexAttributeDescriptionCount =
       static_cast<uint32_t>(attribute_descriptions.size());
   vertex_input_info.pVertexAttributeDescriptions = attribute_descriptions.data();
 
   VkGraphicsPipelineCreateInfo pipeline_info = {};
   pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipeline_info.stageCount = 2;
-  pipeline_info.pStages = shader_stages;
+  pipeline_info.stageCount = static_cast<uint32_t>(shader_stages.size());
+  pipeline_info.pStages = shader_stages.data();
   pipeline_info.pVertexInputState = &vertex_input_info;
   pipeline_info.pInputAssemblyState = &input_assembly;
   pipeline_info.pTessellationState = VK_NULL_HANDLE;
@@ -148,7 +216,7 @@ void vulkan::VulkanRenderingPipeline::CreatePipeline(const VertexBufferLayout &v
   pipeline_info.pColorBlendState = &color_blending;
   pipeline_info.pDynamicState = VK_NULL_HANDLE;
   pipeline_info.layout = pipeline_layout_;
-  pipeline_info.renderPass = context_->GetRenderPass();
+  pipeline_info.renderPass = render_pass_;
   pipeline_info.subpass = 0;
   pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
   pipeline_info.pDynamicState = &dynamic_state_create_info;
@@ -163,10 +231,27 @@ void vulkan::VulkanRenderingPipeline::CreatePipeline(const VertexBufferLayout &v
 
 void vulkan::VulkanRenderingPipeline::BindPipeline(VkCommandBuffer command_buffer) {
   vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-  VkDeviceSize offsets[] = {0};
-  auto buffer = vertex_buffer_->GetBuffer();
-  vkCmdBindVertexBuffers(command_buffer, 0, 1, &buffer, offsets);
-  vkCmdBindIndexBuffer(command_buffer, index_buffer_->GetBuffer(), 0, this->index_type_);
+  for (uint32_t binding = 0; binding < vertex_buffers_.size(); binding++) {
+    if (vertex_buffers_[binding] != nullptr) {
+      VkDeviceSize offsets[] = {0};
+      auto buffer = vertex_buffers_[binding]->GetBuffer();
+      vkCmdBindVertexBuffers(command_buffer, binding, 1, &buffer, offsets);
+    }
+  }
+  if (index_buffer_ != nullptr) {
+    vkCmdBindIndexBuffer(command_buffer, index_buffer_->GetBuffer(), 0, this->index_type_);
+  }
+  if (!descriptor_set_->IsEmpty()) {
+    VkDescriptorSet descriptor_set = descriptor_set_->GetDescriptorSet();
+    vkCmdBindDescriptorSets(command_buffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pipeline_layout_,
+                            0,
+                            1,
+                            &descriptor_set,
+                            0,
+                            nullptr);
+  }
 }
 
 vulkan::VulkanRenderingPipeline::~VulkanRenderingPipeline() {
@@ -177,3 +262,27 @@ vulkan::VulkanRenderingPipeline::~VulkanRenderingPipeline() {
 VkPipelineLayout vulkan::VulkanRenderingPipeline::GetPipelineLayout() const {
   return pipeline_layout_;
 }
+
+VkPipeline vulkan::VulkanRenderingPipeline::GetPipeline() const {
+  return pipeline_;
+}
+
+std::vector<VkBuffer> vulkan::VulkanRenderingPipeline::GetVertexBuffers() const {
+  std::vector<VkBuffer> buffers{};
+  for (const auto &buffer: vertex_buffers_) {
+    buffers.push_back(buffer != nullptr ? buffer->GetBuffer() : VK_NULL_HANDLE);
+  }
+  return buffers;
+}
+
+VkBuffer vulkan::VulkanRenderingPipeline::GetIndexBuffer() const {
+  return index_buffer_ != nullptr ? index_buffer_->GetBuffer() : VK_NULL_HANDLE;
+}
+
+VkIndexType vulkan::VulkanRenderingPipeline::GetIndexType() const {
+  return index_type_;
+}
+
+VkDescriptorSet vulkan::VulkanRenderingPipeline::GetDescriptorSet() const {
+  return descriptor_set_->IsEmpty() ? VK_NULL_HANDLE : descriptor_set_->GetDescriptorSet();
+}
@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 
 #include "vulkan_buffer.hpp"
+#include "vulkan_descriptor_set.hpp"
 #include "vulkan_rendering_context.hpp"
 #include "vulkan_shader.hpp"
 #include "vertex_buffer_layout.hpp"
@@ -14,11 +15,15 @@ class VulkanRenderingPipeline {
   std::shared_ptr<VulkanRenderingContext> context_;
   VkDevice device_;
   RenderingPipelineConfig config_;
+  // The context's render pass and sample count unless given.
+  VkRenderPass render_pass_ = VK_NULL_HANDLE;
+  VkSampleCountFlagBits samples_;
 
   VkPipeline pipeline_{};
   VkPipelineLayout pipeline_layout_ = nullptr;
 
-  std::shared_ptr<VulkanBuffer> vertex_buffer_ = nullptr;
+  // Indexed by buffer binding.
+  std::vector<std::shared_ptr<VulkanBuffer>> vertex_buffers_{};
 
   std::shared_ptr<VulkanBuffer> index_buffer_ = nullptr;
   VkIndexType index_type_ = VkIndexType::VK_INDEX_TYPE_UINT16;
@@ -26,6 +31,8 @@ class VulkanRenderingPipeline {
   std::shared_ptr<VulkanShader> vertex_shader_ = nullptr;
   std::shared_ptr<VulkanShader> fragment_shader_ = nullptr;
 
+  std::unique_ptr<VulkanDescriptorSet> descriptor_set_ = nullptr;
+
   void CreatePipeline(const VertexBufferLayout &vbl);
 
  public:
@@ -36,11 +43,35 @@ class VulkanRenderingPipeline {
                           std::shared_ptr<VulkanShader> fragment_shader,
                           const VertexBufferLayout &vbl,
                           RenderingPipelineConfig config);
+  // For a render pass of its own, e.g. single sampled targets next to the eye buffers.
+  VulkanRenderingPipeline(std::shared_ptr<VulkanRenderingContext> context,
+                          std::shared_ptr<VulkanShader> vertex_shader,
+                          std::shared_ptr<VulkanShader> fragment_shader,
+                          const VertexBufferLayout &vbl,
+                          RenderingPipelineConfig config,
+                          VkRenderPass render_pass,
+                          VkSampleCountFlagBits samples);
+  // Without a fragment shader the pipeline only writes depth, e.g. for a depth prepass.
+  VulkanRenderingPipeline(std::shared_ptr<VulkanRenderingContext> context,
+                          std::shared_ptr<VulkanShader> vertex_shader,
+                          const VertexBufferLayout &vbl,
+                          RenderingPipelineConfig config);
 
   void SetIndexBuffer(std::shared_ptr<VulkanBuffer> buffer, DataType element_type);
-  void SetVertexBuffer(std::shared_ptr<VulkanBuffer> buffer);
+  void SetVertexBuffer(std::shared_ptr<VulkanBuffer> buffer, uint32_t binding = 0);
+  void SetBuffer(uint32_t binding, std::shared_ptr<VulkanBuffer> buffer);
+  void SetImage(uint32_t binding,
+                VkImageView image_view,
+                VkSampler sampler,
+                VkImageLayout image_layout);
   void BindPipeline(VkCommandBuffer command_buffer);
   VkPipelineLayout GetPipelineLayout() const;
+  [[nodiscard]] VkPipeline GetPipeline() const;
+  // VK_NULL_HANDLE for bindings without a buffer.
+  [[nodiscard]] std::vector<VkBuffer> GetVertexBuffers() const;
+  [[nodiscard]] VkBuffer GetIndexBuffer() const;
+  [[nodiscard]] VkIndexType GetIndexType() const;
+  [[nodiscard]] VkDescriptorSet GetDescriptorSet() const;
   virtual ~VulkanRenderingPipeline();
 };
 }
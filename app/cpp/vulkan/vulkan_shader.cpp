@@ -33,6 +33,9 @@ vulkan::VulkanShader::VulkanShader(const std::shared_ptr<VulkanRenderingContext>
     case SPV_REFLECT_SHADER_STAGE_FRAGMENT_BIT:
       this->type_ = VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT;
       break;
+    case SPV_REFLECT_SHADER_STAGE_COMPUTE_BIT:
+      this->type_ = VkShaderStageFlagBits::VK_SHADER_STAGE_COMPUTE_BIT;
+      break;
     default:throw std::runtime_error("unhandled shader stage");
   }
 
@@ -67,6 +70,39 @@ vulkan::VulkanShader::VulkanShader(const std::shared_ptr<VulkanRenderingContext>
     push_constants_.emplace_back(range);
   }
 
+  count = 0;
+  result = spvReflectEnumerateEntryPointDescriptorBindings(&reflect_shader_module_,
+                                                           this->entry_point_name_.data(),
+                                                           &count,
+                                                           nullptr);
+  if (result != SPV_REFLECT_RESULT_SUCCESS)[[unlikely]] {
+    throw std::runtime_error(fmt::format("spirv reflect failed with error {}\n",
+                                         magic_enum::enum_name(result)));
+  }
+
+  std::vector<SpvReflectDescriptorBinding *> bindings(count);
+  result = spvReflectEnumerateEntryPointDescriptorBindings(&reflect_shader_module_,
+                                                           this->entry_point_name_.data(),
+                                                           &count,
+                                                           bindings.data());
+  if (result != SPV_REFLECT_RESULT_SUCCESS)[[unlikely]] {
+    throw std::runtime_error(fmt::format("spirv reflect failed with error {}\n",
+                                         magic_enum::enum_name(result)));
+  }
+
+  for (const auto &binding: bindings) {
+    if (binding->set != 0) {
+      throw std::runtime_error("only descriptor set 0 is supported");
+    }
+    VkDescriptorSetLayoutBinding layout_binding{
+        .binding = binding->binding,
+        .descriptorType = static_cast<VkDescriptorType>(binding->descriptor_type),
+        .descriptorCount = binding->count,
+        .stageFlags = static_cast<VkShaderStageFlags>(type_),
+        .pImmutableSamplers = nullptr,
+    };
+    descriptor_bindings_.emplace_back(layout_binding);
+  }
 }
 
 VkPipelineShaderStageCreateInfo vulkan::VulkanShader::GetShaderStageInfo() const {
@@ -87,3 +123,7 @@ const std::vector<VkPushConstantRange> &vulkan::VulkanShader::GetPushConstants()
   return push_constants_;
 }
 
+const std::vector<VkDescriptorSetLayoutBinding> &vulkan::VulkanShader::GetDescriptorBindings() const {
+  return descriptor_bindings_;
+}
+
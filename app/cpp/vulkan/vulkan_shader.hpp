@@ -23,6 +23,7 @@ class VulkanShader {
   VkShaderModule shader_module_ = nullptr;
   SpvReflectShaderModule reflect_shader_module_{};
   std::vector<VkPushConstantRange> push_constants_{};
+  std::vector<VkDescriptorSetLayoutBinding> descriptor_bindings_{};
  public:
   VulkanShader(const std::shared_ptr<VulkanRenderingContext> &context,
                const std::vector<uint32_t> &code,
@@ -32,6 +33,8 @@ class VulkanShader {
 
   const std::vector<VkPushConstantRange> &GetPushConstants() const;
 
+  const std::vector<VkDescriptorSetLayoutBinding> &GetDescriptorBindings() const;
+
   virtual ~VulkanShader();
 };
 }
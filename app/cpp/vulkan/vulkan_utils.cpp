@@ -69,6 +69,48 @@ VkFormat vulkan::GetVkFormat(DataType type, uint32_t count) {
         case 4: return VK_FORMAT_R32G32B32A32_SFLOAT;
         default:throw std::runtime_error("unsupported count");
       }
+    case DataType::SNORM_8:
+      switch (count) {
+        case 1:return VK_FORMAT_R8_SNORM;
+        case 2:return VK_FORMAT_R8G8_SNORM;
+        case 3:return VK_FORMAT_R8G8B8_SNORM;
+        case 4:return VK_FORMAT_R8G8B8A8_SNORM;
+        default:throw std::runtime_error("unsupported count");
+      }
+    case DataType::UNORM_16:
+      switch (count) {
+        case 1:return VK_FORMAT_R16_UNORM;
+        case 2:return VK_FORMAT_R16G16_UNORM;
+        case 3:return VK_FORMAT_R16G16B16_UNORM;
+        case 4:return VK_FORMAT_R16G16B16A16_UNORM;
+        default:throw std::runtime_error("unsupported count");
+      }
+    case DataType::SNORM_16:
+      switch (count) {
+        case 1:return VK_FORMAT_R16_SNORM;
+        case 2:return VK_FORMAT_R16G16_SNORM;
+        case 3:return VK_FORMAT_R16G16B16_SNORM;
+        case 4:return VK_FORMAT_R16G16B16A16_SNORM;
+        default:throw std::runtime_error("unsupported count");
+      }
+    case DataType::HALF_FLOAT:
+      switch (count) {
+        case 1:return VK_FORMAT_R16_SFLOAT;
+        case 2:return VK_FORMAT_R16G16_SFLOAT;
+        case 3:return VK_FORMAT_R16G16B16_SFLOAT;
+        case 4:return VK_FORMAT_R16G16B16A16_SFLOAT;
+        default:throw std::runtime_error("unsupported count");
+      }
+    case DataType::A2B10G10R10_UNORM:
+      if (count != 4) {
+        throw std::runtime_error("unsupported count");
+      }
+      return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    case DataType::A2B10G10R10_SNORM:
+      if (count != 4) {
+        throw std::runtime_error("unsupported count");
+      }
+      return VK_FORMAT_A2B10G10R10_SNORM_PACK32;
     default:throw std::runtime_error("unsupported enum");
   }
 }
@@ -0,0 +1,277 @@
+#include "vulkan_depth_swapchain.hpp"
+
+#include <glm/glm.hpp>
+
+#include <stdexcept>
+
+#include "vulkan/vulkan_utils.hpp"
+
+namespace {
+constexpr uint32_t kResolveWorkgroupSize = 8;
+
+struct ResolvePushConstants {
+  glm::ivec2 source_offset;
+  glm::vec2 source_scale;
+  glm::uvec2 target_extent;
+};
+}
+
+VulkanDepthSwapchain::VulkanDepthSwapchain(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    uint32_t capacity,
+    const XrSwapchainCreateInfo &swapchain_create_info,
+    uint32_t source_count)
+    : rendering_context_(rendering_context),
+      extent_({swapchain_create_info.width, swapchain_create_info.height}),
+      array_size_(swapchain_create_info.arraySize) {
+  if (swapchain_create_info.format != VK_FORMAT_D32_SFLOAT) {
+    throw std::invalid_argument("depth swapchains are resolved as 32 bit floats");
+  }
+  swapchain_images_.resize(capacity, {XR_TYPE_SWAPCHAIN_IMAGE_VULKAN_KHR});
+  source_image_views_.resize(source_count, VK_NULL_HANDLE);
+
+  const std::vector<uint32_t> kResolveShader = {
+#include "depth_resolve.spv"
+  };
+  auto resolve_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
+                                                               kResolveShader,
+                                                               "main");
+  resolve_pipeline_ = std::make_shared<vulkan::VulkanComputePipeline>(rendering_context_,
+                                                                      resolve_shader,
+                                                                      source_count);
+
+  // The layers lie one after the other, as the copy into the image expects them.
+  resolve_buffer_ = std::make_shared<vulkan::VulkanBuffer>(
+      rendering_context_,
+      static_cast<size_t>(extent_.width) * extent_.height * array_size_ * sizeof(float),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  resolve_pipeline_->SetBuffer(1, resolve_buffer_);
+
+  VkSamplerCreateInfo sampler_info = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = VK_FILTER_NEAREST,
+      .minFilter = VK_FILTER_NEAREST,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .maxLod = 0.0f,
+  };
+  CHECK_VKCMD(vkCreateSampler(rendering_context_->GetDevice(), &sampler_info, nullptr, &sampler_));
+}
+
+XrSwapchainImageBaseHeader *VulkanDepthSwapchain::GetFirstImagePointer() {
+  return reinterpret_cast<XrSwapchainImageBaseHeader *>(&swapchain_images_[0]);
+}
+
+void VulkanDepthSwapchain::SetSource(uint32_t source_index, VkImage depth_image) {
+  if (source_index >= source_image_views_.size()) {
+    throw std::out_of_range("depth source index exceeds the descriptor sets");
+  }
+  if (source_image_views_[source_index] != VK_NULL_HANDLE) {
+    throw std::runtime_error("depth source is already set");
+  }
+  // The resolve samples every source as an array, also with a single layer.
+  VkImageViewCreateInfo view_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = depth_image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+      .format = rendering_context_->GetDepthAttachmentFormat(),
+      .subresourceRange = {
+          .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+          .baseMipLevel = 0,
+          .levelCount = 1,
+          .baseArrayLayer = 0,
+          .layerCount = array_size_,
+      },
+  };
+  CHECK_VKCMD(vkCreateImageView(rendering_context_->GetDevice(),
+                                &view_info,
+                                nullptr,
+                                &source_image_views_[source_index]));
+  resolve_pipeline_->SetImage(0,
+                              source_image_views_[source_index],
+                              sampler_,
+                              VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                              source_index);
+}
+
+void VulkanDepthSwapchain::Resolve(VkCommandBuffer command_buffer,
+                                   uint32_t image_index,
+                                   uint32_t source_index,
+                                   const VkRect2D &source_area,
+                                   const VkRect2D &target_area) {
+  if (image_index >= swapchain_images_.size()) {
+    throw std::out_of_range("image index exceeds the swapchain images");
+  }
+  if (source_index >= source_image_views_.size()
+      || source_image_views_[source_index] == VK_NULL_HANDLE) {
+    throw std::runtime_error("depth source is not set");
+  }
+  if (target_area.offset.x < 0 || target_area.offset.y < 0
+      || target_area.offset.x + target_area.extent.width > extent_.width
+      || target_area.offset.y + target_area.extent.height > extent_.height) {
+    throw std::out_of_range("depth target area exceeds the swapchain images");
+  }
+
+  // The buffer is shared by the frames in flight, the copy of the previous one has to be done.
+  VkMemoryBarrier copy_barrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0,
+                       1, &copy_barrier,
+                       0, nullptr,
+                       0, nullptr);
+
+  resolve_pipeline_->BindPipeline(command_buffer, source_index);
+  ResolvePushConstants push_constants{
+      .source_offset = {source_area.offset.x, source_area.offset.y},
+      .source_scale = {
+          static_cast<float>(source_area.extent.width) / target_area.extent.width,
+          static_cast<float>(source_area.extent.height) / target_area.extent.height,
+      },
+      .target_extent = {target_area.extent.width, target_area.extent.height},
+  };
+  vkCmdPushConstants(command_buffer,
+                     resolve_pipeline_->GetPipelineLayout(),
+                     VK_SHADER_STAGE_COMPUTE_BIT,
+                     0,
+                     sizeof(push_constants),
+                     &push_constants);
+  vkCmdDispatch(command_buffer,
+                (target_area.extent.width + kResolveWorkgroupSize - 1) / kResolveWorkgroupSize,
+                (target_area.extent.height + kResolveWorkgroupSize - 1) / kResolveWorkgroupSize,
+                array_size_);
+
+  const VkImageSubresourceRange kLayers = {
+      .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+      .baseMipLevel = 0,
+      .levelCount = 1,
+      .baseArrayLayer = 0,
+      .layerCount = array_size_,
+  };
+  VkBufferMemoryBarrier resolve_barrier = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .buffer = resolve_buffer_->GetBuffer(),
+      .offset = 0,
+      .size = VK_WHOLE_SIZE,
+  };
+  VkImageMemoryBarrier to_transfer = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = swapchain_images_[image_index].image,
+      .subresourceRange = kLayers,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0,
+                       0, nullptr,
+                       1, &resolve_barrier,
+                       1, &to_transfer);
+
+  VkBufferImageCopy region = {
+      .bufferOffset = 0,
+      .bufferRowLength = target_area.extent.width,
+      .bufferImageHeight = target_area.extent.height,
+      .imageSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, array_size_},
+      .imageOffset = {target_area.offset.x, target_area.offset.y, 0},
+      .imageExtent = {target_area.extent.width, target_area.extent.height, 1},
+  };
+  vkCmdCopyBufferToImage(command_buffer,
+                         resolve_buffer_->GetBuffer(),
+                         swapchain_images_[image_index].image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         1,
+                         &region);
+
+  VkImageMemoryBarrier to_attachment = to_transfer;
+  to_attachment.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  to_attachment.dstAccessMask = 0;
+  to_attachment.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  to_attachment.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       1, &to_attachment);
+}
+
+void VulkanDepthSwapchain::Clear(VkCommandBuffer command_buffer, uint32_t image_index) {
+  if (image_index >= swapchain_images_.size()) {
+    throw std::out_of_range("image index exceeds the swapchain images");
+  }
+  const VkImageSubresourceRange kLayers = {
+      .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+      .baseMipLevel = 0,
+      .levelCount = 1,
+      .baseArrayLayer = 0,
+      .layerCount = array_size_,
+  };
+  VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = swapchain_images_[image_index].image,
+      .subresourceRange = kLayers,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       1, &barrier);
+
+  const VkClearDepthStencilValue kFarPlane = {1.0f, 0};
+  vkCmdClearDepthStencilImage(command_buffer,
+                              swapchain_images_[image_index].image,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              &kFarPlane,
+                              1,
+                              &kLayers);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       1, &barrier);
+}
+
+VulkanDepthSwapchain::~VulkanDepthSwapchain() {
+  const VkDevice kDevice = rendering_context_->GetDevice();
+  rendering_context_->WaitForGpuIdle();
+  for (VkImageView image_view: source_image_views_) {
+    if (image_view != VK_NULL_HANDLE) {
+      vkDestroyImageView(kDevice, image_view, nullptr);
+    }
+  }
+  vkDestroySampler(kDevice, sampler_, nullptr);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "openxr-include.hpp"
+
+#include "vulkan/vulkan_buffer.hpp"
+#include "vulkan/vulkan_compute_pipeline.hpp"
+#include "vulkan/vulkan_rendering_context.hpp"
+
+#include <memory>
+#include <vector>
+
+// Images of a depth swapchain submitted with XR_KHR_composition_layer_depth next to a color
+// swapchain of the same layout. Depth formats can not be storage images and copies between
+// multisampled and single sampled images do not exist, so the eye depth is resolved by a compute
+// pass into a buffer and copied from there. Only VK_FORMAT_D32_SFLOAT takes the floats as they are.
+class VulkanDepthSwapchain {
+ private:
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  std::shared_ptr<vulkan::VulkanComputePipeline> resolve_pipeline_;
+  VkExtent2D extent_;
+  uint32_t array_size_;
+  std::vector<XrSwapchainImageVulkan2KHR> swapchain_images_{};
+
+  // Every source the depth is resolved from has a descriptor set and a view of its own.
+  std::vector<VkImageView> source_image_views_{};
+  std::shared_ptr<vulkan::VulkanBuffer> resolve_buffer_;
+  VkSampler sampler_ = VK_NULL_HANDLE;
+
+ public:
+  VulkanDepthSwapchain() = delete;
+  VulkanDepthSwapchain(const VulkanDepthSwapchain &) = delete;
+  VulkanDepthSwapchain(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                       uint32_t capacity,
+                       const XrSwapchainCreateInfo &swapchain_create_info,
+                       uint32_t source_count);
+
+  XrSwapchainImageBaseHeader *GetFirstImagePointer();
+
+  // depth_image is a multisampled depth attachment with the layers of the swapchain, sampled in
+  // VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL. It has to outlive this swapchain.
+  void SetSource(uint32_t source_index, VkImage depth_image);
+
+  // Records after the pass that wrote the source: source_area of it is resolved into target_area
+  // of an acquired image, scaled when the two differ in size. The image is left in
+  // VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL for its release.
+  void Resolve(VkCommandBuffer command_buffer,
+               uint32_t image_index,
+               uint32_t source_index,
+               const VkRect2D &source_area,
+               const VkRect2D &target_area);
+
+  // Fills an acquired image with the far plane, for passes whose depth is not kept. The compositor
+  // then reprojects the layer as far away content, much like it does without depth.
+  void Clear(VkCommandBuffer command_buffer, uint32_t image_index);
+
+  virtual ~VulkanDepthSwapchain();
+};
@@ -0,0 +1,273 @@
+#include "vulkan_far_field_renderer.hpp"
+
+#include <array>
+#include <stdexcept>
+
+#include "vulkan/vulkan_utils.hpp"
+
+namespace {
+// Bounds the search along the ray of a pixel, a few texels cover the disparity of the far field.
+constexpr uint32_t kMaxReprojectionSteps = 32;
+
+struct ReprojectionPushConstants {
+  glm::mat4 reprojection;
+  glm::vec2 uv_scale;
+  uint32_t max_steps;
+};
+}
+
+VulkanFarFieldRenderer::VulkanFarFieldRenderer(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    VkFormat color_format,
+    VkExtent2D extent,
+    uint32_t max_frames_in_flight) :
+    rendering_context_(rendering_context),
+    color_format_(color_format),
+    extent_(extent) {
+  if (rendering_context_->GetSamplingRenderPass() == VK_NULL_HANDLE) {
+    throw std::runtime_error("far field reprojection is not available with a density map");
+  }
+  if (rendering_context_->GetViewCount() != 1) {
+    throw std::runtime_error("far field reprojection needs a render pass with a single view");
+  }
+
+  const std::vector<uint32_t> kFullscreenShader = {
+#include "fullscreen.spv"
+  };
+  const std::vector<uint32_t> kReprojectionShader = {
+#include "far_field_reproject.spv"
+  };
+  auto vertex_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
+                                                              kFullscreenShader,
+                                                              "main");
+  auto fragment_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
+                                                                kReprojectionShader,
+                                                                "main");
+  // The triangle lies on the far plane, so the hidden area mask rejects it and the near content
+  // passes the depth test over it.
+  reprojection_pipeline_ = std::make_shared<vulkan::VulkanRenderingPipeline>(
+      rendering_context_,
+      vertex_shader,
+      fragment_shader,
+      vulkan::VertexBufferLayout(),
+      vulkan::RenderingPipelineConfig{
+          .draw_mode = vulkan::DrawMode::TRIANGLE_LIST,
+          .cull_mode = vulkan::CullMode::NONE,
+          .front_face = vulkan::FrontFace::CCW,
+          .enable_depth_test = true,
+          .depth_function = vulkan::CompareOp::LESS_OR_EQUAL,
+      });
+
+  CreateResources();
+  CreateCommandBuffers(max_frames_in_flight);
+
+  VkSamplerCreateInfo sampler_info = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = VK_FILTER_LINEAR,
+      .minFilter = VK_FILTER_LINEAR,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .maxLod = 0.0f,
+  };
+  CHECK_VKCMD(vkCreateSampler(rendering_context_->GetDevice(), &sampler_info, nullptr, &sampler_));
+
+  reprojection_pipeline_->SetImage(0,
+                                   resolve_image_view_,
+                                   sampler_,
+                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  reprojection_pipeline_->SetImage(1,
+                                   depth_image_view_,
+                                   sampler_,
+                                   VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+}
+
+VkExtent2D VulkanFarFieldRenderer::GetExtent() const {
+  return extent_;
+}
+
+VkCommandBuffer VulkanFarFieldRenderer::BeginPass(uint32_t frame_index,
+                                                  const VkExtent2D &render_extent,
+                                                  const glm::mat4 &view_projection) {
+  if (frame_index >= command_buffers_.size()) {
+    throw std::out_of_range("frame index exceeds the frames in flight");
+  }
+  if (render_extent.width == 0 || render_extent.height == 0
+      || render_extent.width > extent_.width || render_extent.height > extent_.height) {
+    throw std::out_of_range("far field render extent exceeds its images");
+  }
+  render_area_ = {{0, 0}, render_extent};
+  view_projection_ = view_projection;
+
+  recording_command_buffer_ = command_buffers_[frame_index];
+  VkCommandBufferBeginInfo begin_info = {};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(recording_command_buffer_, &begin_info);
+
+  // The views of the previous frame must have finished reading, the pass discards the contents.
+  vkCmdPipelineBarrier(recording_command_buffer_,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                           | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                           | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       0, nullptr);
+
+  std::array<VkClearValue, 2> clear_values = {};
+  clear_values[0].color = {{0.184313729f, 0.309803933f, 0.309803933f, 1.0f}};
+  clear_values[1].depthStencil = {1.0f, 0};
+  VkRenderPassBeginInfo render_pass_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = rendering_context_->GetSamplingRenderPass(),
+      .framebuffer = frame_buffer_,
+      .renderArea = render_area_,
+      .clearValueCount = static_cast<uint32_t>(clear_values.size()),
+      .pClearValues = clear_values.data(),
+  };
+  vkCmdBeginRenderPass(recording_command_buffer_, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+  // Flipped like the views, so the reprojection maps uv the same way.
+  VkViewport viewport = {
+      .x = static_cast<float>(render_area_.offset.x),
+      .y = static_cast<float>(render_area_.offset.y)
+          + static_cast<float>(render_area_.extent.height),
+      .width = static_cast<float>(render_area_.extent.width),
+      .height = -static_cast<float>(render_area_.extent.height),
+      .minDepth = 0.0,
+      .maxDepth = 1.0,
+  };
+  vkCmdSetViewport(recording_command_buffer_, 0, 1, &viewport);
+  vkCmdSetScissor(recording_command_buffer_, 0, 1, &render_area_);
+  return recording_command_buffer_;
+}
+
+VkCommandBuffer VulkanFarFieldRenderer::EndPass() {
+  if (recording_command_buffer_ == VK_NULL_HANDLE) {
+    throw std::runtime_error("far field pass ended without being begun");
+  }
+  VkCommandBuffer command_buffer = recording_command_buffer_;
+  vkCmdEndRenderPass(command_buffer);
+  vkEndCommandBuffer(command_buffer);
+  recording_command_buffer_ = VK_NULL_HANDLE;
+  frame_rendered_ = true;
+  return command_buffer;
+}
+
+void VulkanFarFieldRenderer::Draw(VkCommandBuffer command_buffer,
+                                  const glm::mat4 &view_projection) {
+  if (!frame_rendered_) {
+    throw std::runtime_error("far field reprojected before it was rendered");
+  }
+  ReprojectionPushConstants push_constants{
+      .reprojection = view_projection_ * glm::inverse(view_projection),
+      .uv_scale = {
+          static_cast<float>(render_area_.extent.width) / extent_.width,
+          static_cast<float>(render_area_.extent.height) / extent_.height,
+      },
+      .max_steps = kMaxReprojectionSteps,
+  };
+  reprojection_pipeline_->BindPipeline(command_buffer);
+  vkCmdPushConstants(command_buffer,
+                     reprojection_pipeline_->GetPipelineLayout(),
+                     VK_SHADER_STAGE_FRAGMENT_BIT,
+                     0,
+                     sizeof(push_constants),
+                     &push_constants);
+  vkCmdDraw(command_buffer, 3, 1, 0, 0);
+}
+
+VulkanFarFieldRenderer::~VulkanFarFieldRenderer() {
+  const VkDevice kDevice = rendering_context_->GetDevice();
+  rendering_context_->WaitForGpuIdle();
+  vkFreeCommandBuffers(kDevice,
+                       rendering_context_->GetGraphicsPool(),
+                       static_cast<uint32_t>(command_buffers_.size()),
+                       command_buffers_.data());
+  vkDestroySampler(kDevice, sampler_, nullptr);
+  vkDestroyFramebuffer(kDevice, frame_buffer_, nullptr);
+  vkDestroyImageView(kDevice, resolve_image_view_, nullptr);
+  vkDestroyImage(kDevice, resolve_image_, nullptr);
+  vkFreeMemory(kDevice, resolve_image_memory_, nullptr);
+  vkDestroyImageView(kDevice, depth_image_view_, nullptr);
+  vkDestroyImage(kDevice, depth_image_, nullptr);
+  vkFreeMemory(kDevice, depth_image_memory_, nullptr);
+  vkDestroyImageView(kDevice, color_image_view_, nullptr);
+  vkDestroyImage(kDevice, color_image_, nullptr);
+  vkFreeMemory(kDevice, color_image_memory_, nullptr);
+}
+
+void VulkanFarFieldRenderer::CreateResources() {
+  const VkFormat kDepthFormat = rendering_context_->GetDepthAttachmentFormat();
+  rendering_context_->CreateImage(extent_.width,
+                                  extent_.height,
+                                  rendering_context_->GetRecommendedMsaaSamples(),
+                                  color_format_,
+                                  VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &color_image_,
+                                  &color_image_memory_);
+  rendering_context_->CreateImageView(color_image_,
+                                      color_format_,
+                                      VK_IMAGE_ASPECT_COLOR_BIT,
+                                      &color_image_view_);
+  // Sampled by the views, so unlike the eye buffer depth it can not be transient.
+  rendering_context_->CreateImage(extent_.width,
+                                  extent_.height,
+                                  rendering_context_->GetRecommendedMsaaSamples(),
+                                  kDepthFormat,
+                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &depth_image_,
+                                  &depth_image_memory_);
+  rendering_context_->CreateImageView(depth_image_,
+                                      kDepthFormat,
+                                      VK_IMAGE_ASPECT_DEPTH_BIT,
+                                      &depth_image_view_);
+  rendering_context_->CreateImage(extent_.width,
+                                  extent_.height,
+                                  VK_SAMPLE_COUNT_1_BIT,
+                                  color_format_,
+                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &resolve_image_,
+                                  &resolve_image_memory_);
+  rendering_context_->CreateImageView(resolve_image_,
+                                      color_format_,
+                                      VK_IMAGE_ASPECT_COLOR_BIT,
+                                      &resolve_image_view_);
+
+  std::array<VkImageView, 3> attachments = {
+      color_image_view_,
+      depth_image_view_,
+      resolve_image_view_
+  };
+  VkFramebufferCreateInfo framebuffer_info = {};
+  framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebuffer_info.renderPass = rendering_context_->GetSamplingRenderPass();
+  framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebuffer_info.pAttachments = attachments.data();
+  framebuffer_info.width = extent_.width;
+  framebuffer_info.height = extent_.height;
+  framebuffer_info.layers = 1;
+  CHECK_VKCMD(vkCreateFramebuffer(rendering_context_->GetDevice(),
+                                  &framebuffer_info,
+                                  nullptr,
+                                  &frame_buffer_));
+}
+
+void VulkanFarFieldRenderer::CreateCommandBuffers(uint32_t max_frames_in_flight) {
+  command_buffers_.resize(max_frames_in_flight);
+  VkCommandBufferAllocateInfo alloc_info = {};
+  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  alloc_info.commandPool = rendering_context_->GetGraphicsPool();
+  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  alloc_info.commandBufferCount = static_cast<uint32_t>(command_buffers_.size());
+  CHECK_VKCMD(vkAllocateCommandBuffers(rendering_context_->GetDevice(),
+                                       &alloc_info,
+                                       command_buffers_.data()));
+}
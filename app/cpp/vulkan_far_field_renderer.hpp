@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "vulkan/vulkan_rendering_context.hpp"
+#include "vulkan/vulkan_rendering_pipeline.hpp"
+
+#include <memory>
+#include <vector>
+
+// Hybrid mono rendering: what lies beyond the split distance is rendered once per frame from a
+// view between the eyes that covers the fields of view of both, and every eye reprojects it with
+// its depth before drawing only the near content itself. Each eye pixel searches along its ray
+// between the split distance and the far plane for the first surface of the far field it passes
+// behind; where the center view could not see that surface, the pixel is filled from the
+// background side of the depth edge instead of the occluder.
+// The far pass shares the frame's submit and renders with the scene pipelines, so it needs a
+// render pass with a single view.
+class VulkanFarFieldRenderer {
+ private:
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  std::shared_ptr<vulkan::VulkanRenderingPipeline> reprojection_pipeline_;
+  VkFormat color_format_;
+  VkExtent2D extent_;
+
+  VkImage color_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory color_image_memory_ = VK_NULL_HANDLE;
+  VkImageView color_image_view_ = VK_NULL_HANDLE;
+  VkImage depth_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory depth_image_memory_ = VK_NULL_HANDLE;
+  VkImageView depth_image_view_ = VK_NULL_HANDLE;
+  VkImage resolve_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory resolve_image_memory_ = VK_NULL_HANDLE;
+  VkImageView resolve_image_view_ = VK_NULL_HANDLE;
+  VkFramebuffer frame_buffer_ = VK_NULL_HANDLE;
+  VkSampler sampler_ = VK_NULL_HANDLE;
+
+  std::vector<VkCommandBuffer> command_buffers_{};
+  VkCommandBuffer recording_command_buffer_ = VK_NULL_HANDLE;
+
+  VkRect2D render_area_ = {{0, 0}, {0, 0}};
+  glm::mat4 view_projection_ = glm::mat4(1.0f);
+  bool frame_rendered_ = false;
+
+  void CreateResources();
+  void CreateCommandBuffers(uint32_t max_frames_in_flight);
+
+ public:
+  VulkanFarFieldRenderer() = delete;
+  VulkanFarFieldRenderer(const VulkanFarFieldRenderer &) = delete;
+  // extent bounds the far pass, it has to hold the union of the views at their resolution.
+  VulkanFarFieldRenderer(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                         VkFormat color_format,
+                         VkExtent2D extent,
+                         uint32_t max_frames_in_flight);
+
+  [[nodiscard]] VkExtent2D GetExtent() const;
+
+  // Begins the far pass of the frame slot in the top left render_extent of the images and returns
+  // its command buffer. The scene is recorded into it with view_projection, the one of the center
+  // view with its near plane at the split distance.
+  VkCommandBuffer BeginPass(uint32_t frame_index,
+                            const VkExtent2D &render_extent,
+                            const glm::mat4 &view_projection);
+
+  // Ends the far pass, the returned command buffer has to be submitted before the views.
+  VkCommandBuffer EndPass();
+
+  // Records the reprojection into the render pass of a view, after the hidden area mask and
+  // before the near content. view_projection maps the same depth range as the far pass: from the
+  // split distance to the far plane.
+  void Draw(VkCommandBuffer command_buffer, const glm::mat4 &view_projection);
+
+  virtual ~VulkanFarFieldRenderer();
+};
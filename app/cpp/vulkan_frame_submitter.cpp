@@ -0,0 +1,175 @@
+#include "vulkan_frame_submitter.hpp"
+
+#include <array>
+#include <stdexcept>
+
+#include "vulkan/vulkan_utils.hpp"
+
+VulkanFrameSubmitter::VulkanFrameSubmitter(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    uint32_t max_frames_in_flight,
+    uint32_t timestamp_valid_bits) :
+    rendering_context_(rendering_context),
+    timestamp_mask_(timestamp_valid_bits >= 64 ? UINT64_MAX
+                                               : (uint64_t{1} << timestamp_valid_bits) - 1) {
+  if (max_frames_in_flight == 0) {
+    throw std::invalid_argument("at least one frame has to be in flight");
+  }
+  frame_fences_.resize(max_frames_in_flight);
+  VkFenceCreateInfo fence_info = {
+      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+  };
+  for (auto &fence: frame_fences_) {
+    CHECK_VKCMD(vkCreateFence(rendering_context_->GetDevice(), &fence_info, nullptr, &fence));
+  }
+  if (timestamp_mask_ != 0) {
+    CreateTimestampResources();
+  }
+}
+
+void VulkanFrameSubmitter::CreateTimestampResources() {
+  const auto kSlotCount = static_cast<uint32_t>(frame_fences_.size());
+  VkQueryPoolCreateInfo query_pool_info = {
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = 2 * kSlotCount,
+  };
+  CHECK_VKCMD(vkCreateQueryPool(rendering_context_->GetDevice(),
+                                &query_pool_info,
+                                nullptr,
+                                &timestamp_pool_));
+  timestamp_command_buffers_.resize(2 * kSlotCount);
+  VkCommandBufferAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = rendering_context_->GetGraphicsPool(),
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = static_cast<uint32_t>(timestamp_command_buffers_.size()),
+  };
+  CHECK_VKCMD(vkAllocateCommandBuffers(rendering_context_->GetDevice(),
+                                       &alloc_info,
+                                       timestamp_command_buffers_.data()));
+  timestamps_written_.resize(kSlotCount, false);
+}
+
+uint32_t VulkanFrameSubmitter::BeginFrame() {
+  if (frame_begun_) {
+    throw std::runtime_error("previous frame was not submitted");
+  }
+  CHECK_VKCMD(vkWaitForFences(rendering_context_->GetDevice(),
+                              1,
+                              &frame_fences_[frame_index_],
+                              VK_TRUE,
+                              UINT64_MAX));
+  pending_command_buffers_.clear();
+  ReadTimestamps();
+  frame_begun_ = true;
+  return frame_index_;
+}
+
+void VulkanFrameSubmitter::AddCommandBuffer(VkCommandBuffer command_buffer) {
+  if (!frame_begun_) {
+    throw std::runtime_error("command buffer recorded outside of a frame");
+  }
+  pending_command_buffers_.push_back(command_buffer);
+}
+
+void VulkanFrameSubmitter::Submit() {
+  if (!frame_begun_) {
+    throw std::runtime_error("no frame to submit");
+  }
+  frame_begun_ = false;
+  if (pending_command_buffers_.empty()) {
+    return;
+  }
+  if (timestamp_pool_ != VK_NULL_HANDLE) {
+    const uint32_t kFirstQuery = 2 * frame_index_;
+    VkCommandBuffer begin = timestamp_command_buffers_[kFirstQuery];
+    VkCommandBuffer end = timestamp_command_buffers_[kFirstQuery + 1];
+    RecordTimestamp(begin, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, kFirstQuery, true);
+    RecordTimestamp(end, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, kFirstQuery + 1, false);
+    pending_command_buffers_.insert(pending_command_buffers_.begin(), begin);
+    pending_command_buffers_.push_back(end);
+    timestamps_written_[frame_index_] = true;
+  }
+  VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .commandBufferCount = static_cast<uint32_t>(pending_command_buffers_.size()),
+      .pCommandBuffers = pending_command_buffers_.data(),
+  };
+  vkResetFences(rendering_context_->GetDevice(), 1, &frame_fences_[frame_index_]);
+  if (vkQueueSubmit(rendering_context_->GetGraphicsQueue(),
+                    1,
+                    &submit_info,
+                    frame_fences_[frame_index_])
+      != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit frame command buffers!");
+  }
+  pending_command_buffers_.clear();
+  frame_index_ = (frame_index_ + 1) % static_cast<uint32_t>(frame_fences_.size());
+}
+
+[[nodiscard]] uint32_t VulkanFrameSubmitter::GetMaxFramesInFlight() const {
+  return static_cast<uint32_t>(frame_fences_.size());
+}
+
+[[nodiscard]] std::optional<uint64_t> VulkanFrameSubmitter::GetGpuFrameTime() const {
+  return gpu_frame_time_;
+}
+
+void VulkanFrameSubmitter::RecordTimestamp(VkCommandBuffer command_buffer,
+                                           VkPipelineStageFlagBits stage,
+                                           uint32_t query,
+                                           bool reset) {
+  VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  CHECK_VKCMD(vkBeginCommandBuffer(command_buffer, &begin_info));
+  if (reset) {
+    vkCmdResetQueryPool(command_buffer, timestamp_pool_, query, 2);
+  }
+  vkCmdWriteTimestamp(command_buffer, stage, timestamp_pool_, query);
+  CHECK_VKCMD(vkEndCommandBuffer(command_buffer));
+}
+
+void VulkanFrameSubmitter::ReadTimestamps() {
+  gpu_frame_time_.reset();
+  if (timestamp_pool_ == VK_NULL_HANDLE || !timestamps_written_[frame_index_]) {
+    return;
+  }
+  timestamps_written_[frame_index_] = false;
+  // The slot's fence has signaled, so the results are available without waiting.
+  std::array<uint64_t, 2> timestamps{};
+  if (vkGetQueryPoolResults(rendering_context_->GetDevice(),
+                            timestamp_pool_,
+                            2 * frame_index_,
+                            2,
+                            sizeof(timestamps),
+                            timestamps.data(),
+                            sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+  const uint64_t kTicks = ((timestamps[1] & timestamp_mask_) - (timestamps[0] & timestamp_mask_))
+      & timestamp_mask_;
+  gpu_frame_time_ = static_cast<uint64_t>(kTicks * rendering_context_->GetTimestampPeriod());
+}
+
+VulkanFrameSubmitter::~VulkanFrameSubmitter() {
+  vkWaitForFences(rendering_context_->GetDevice(),
+                  static_cast<uint32_t>(frame_fences_.size()),
+                  frame_fences_.data(),
+                  VK_TRUE,
+                  UINT64_MAX);
+  for (const auto &fence: frame_fences_) {
+    vkDestroyFence(rendering_context_->GetDevice(), fence, nullptr);
+  }
+  if (timestamp_pool_ != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(rendering_context_->GetDevice(),
+                         rendering_context_->GetGraphicsPool(),
+                         static_cast<uint32_t>(timestamp_command_buffers_.size()),
+                         timestamp_command_buffers_.data());
+    vkDestroyQueryPool(rendering_context_->GetDevice(), timestamp_pool_, nullptr);
+  }
+}
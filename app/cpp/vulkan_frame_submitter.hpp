@@ -0,0 +1,58 @@
+#pragma once
+
+#include "vulkan/vulkan_rendering_context.hpp"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Gathers the command buffers recorded for every view of a frame and hands them to the
+// graphics queue in a single submit, fenced once for the whole frame. A frame slot is only
+// reused after the GPU has finished the frame that used it before.
+// With timestamp support every submit is bracketed by a pair of timestamps, read back once the
+// slot has retired, which gives the GPU time of whole frames.
+class VulkanFrameSubmitter {
+ private:
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  std::vector<VkFence> frame_fences_{};
+  std::vector<VkCommandBuffer> pending_command_buffers_{};
+  uint32_t frame_index_ = 0;
+  bool frame_begun_ = false;
+
+  uint64_t timestamp_mask_ = 0;
+  VkQueryPool timestamp_pool_ = VK_NULL_HANDLE;
+  // Two per frame slot, recorded around the submitted views.
+  std::vector<VkCommandBuffer> timestamp_command_buffers_{};
+  std::vector<bool> timestamps_written_{};
+  std::optional<uint64_t> gpu_frame_time_{};
+
+  void CreateTimestampResources();
+  void RecordTimestamp(VkCommandBuffer command_buffer,
+                       VkPipelineStageFlagBits stage,
+                       uint32_t query,
+                       bool reset);
+  void ReadTimestamps();
+
+ public:
+  VulkanFrameSubmitter() = delete;
+  // timestamp_valid_bits of the graphics queue family, 0 disables the frame timing.
+  VulkanFrameSubmitter(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                       uint32_t max_frames_in_flight,
+                       uint32_t timestamp_valid_bits = 0);
+
+  // Waits for the frame slot to retire and returns it, command buffers of the slot may then be
+  // re-recorded.
+  uint32_t BeginFrame();
+
+  void AddCommandBuffer(VkCommandBuffer command_buffer);
+
+  // Must be called once the swapchain images of every view have been waited on.
+  void Submit();
+
+  [[nodiscard]] uint32_t GetMaxFramesInFlight() const;
+
+  // Nanoseconds the GPU spent on the frame that last used the slot returned by BeginFrame.
+  [[nodiscard]] std::optional<uint64_t> GetGpuFrameTime() const;
+
+  ~VulkanFrameSubmitter();
+};
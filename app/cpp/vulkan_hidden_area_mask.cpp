@@ -0,0 +1,130 @@
+#include "vulkan_hidden_area_mask.hpp"
+
+#include <stdexcept>
+
+VulkanHiddenAreaMask::VulkanHiddenAreaMask(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    uint32_t view_count) :
+    rendering_context_(rendering_context),
+    multiview_(rendering_context->GetViewCount() > 1),
+    view_vertices_(view_count),
+    view_indices_(view_count),
+    view_ranges_(view_count, {0, 0}) {
+  const std::vector<uint32_t> kHiddenAreaShader = {
+#include "hidden_area.spv"
+  };
+  const std::vector<uint32_t> kHiddenAreaMultiviewShader = {
+#include "hidden_area_multiview.spv"
+  };
+  auto vertex_shader = std::make_shared<vulkan::VulkanShader>(
+      rendering_context_,
+      multiview_ ? kHiddenAreaMultiviewShader : kHiddenAreaShader,
+      "main");
+
+  vulkan::VertexBufferLayout layout = vulkan::VertexBufferLayout();
+  layout.Push({0, vulkan::DataType::FLOAT, 3});
+  // Runtimes do not agree on the winding of the mask, and the depth written is constant.
+  pipeline_ = std::make_shared<vulkan::VulkanRenderingPipeline>(
+      rendering_context_,
+      vertex_shader,
+      layout,
+      vulkan::RenderingPipelineConfig{
+          .draw_mode = vulkan::DrawMode::TRIANGLE_LIST,
+          .cull_mode = vulkan::CullMode::NONE,
+          .front_face = vulkan::FrontFace::CCW,
+          .enable_depth_test = true,
+          .depth_function = vulkan::CompareOp::ALWAYS,
+      });
+}
+
+void VulkanHiddenAreaMask::SetViewMesh(uint32_t view_index,
+                                       const std::vector<glm::vec2> &vertices,
+                                       const std::vector<uint32_t> &indices) {
+  if (view_index >= view_vertices_.size()) {
+    throw std::out_of_range("hidden area mesh for an unknown view");
+  }
+  for (uint32_t index: indices) {
+    if (index >= vertices.size()) {
+      throw std::invalid_argument("hidden area index out of range");
+    }
+  }
+  view_vertices_[view_index] = vertices;
+  view_indices_[view_index] = indices;
+  Upload();
+}
+
+void VulkanHiddenAreaMask::Upload() {
+  std::vector<glm::vec3> vertices{};
+  std::vector<uint32_t> indices{};
+  for (size_t view = 0; view < view_vertices_.size(); view++) {
+    const auto kBaseVertex = static_cast<uint32_t>(vertices.size());
+    view_ranges_[view] = {static_cast<uint32_t>(indices.size()),
+                          static_cast<uint32_t>(view_indices_[view].size())};
+    for (const auto &vertex: view_vertices_[view]) {
+      vertices.emplace_back(vertex, static_cast<float>(view));
+    }
+    for (uint32_t index: view_indices_[view]) {
+      indices.push_back(kBaseVertex + index);
+    }
+  }
+
+  // Frames in flight may still draw the previous mesh.
+  rendering_context_->WaitForGpuIdle();
+  if (indices.empty()) {
+    return;
+  }
+  auto vertex_buffer = std::make_shared<vulkan::VulkanBuffer>(
+      rendering_context_,
+      sizeof(glm::vec3) * vertices.size(),
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  vertex_buffer->Update(vertices.data());
+  auto index_buffer = std::make_shared<vulkan::VulkanBuffer>(
+      rendering_context_,
+      sizeof(uint32_t) * indices.size(),
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  index_buffer->Update(indices.data());
+  pipeline_->SetVertexBuffer(vertex_buffer);
+  pipeline_->SetIndexBuffer(index_buffer, vulkan::DataType::UINT_32);
+}
+
+[[nodiscard]] bool VulkanHiddenAreaMask::IsEmpty() const {
+  for (const auto &range: view_ranges_) {
+    if (range.index_count != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void VulkanHiddenAreaMask::Draw(VkCommandBuffer command_buffer,
+                                uint32_t view_index,
+                                const std::vector<glm::mat4> &projections) {
+  if (IsEmpty()) {
+    return;
+  }
+  const size_t kProjectionCount = multiview_ ? view_ranges_.size() : 1;
+  if (projections.size() != kProjectionCount) {
+    throw std::invalid_argument("hidden area mask needs one projection per rendered view");
+  }
+  ViewRange range{0, 0};
+  if (multiview_) {
+    // Every view draws all triangles, the shader drops the ones of the other views.
+    const ViewRange &last = view_ranges_.back();
+    range.index_count = last.first_index + last.index_count;
+  } else {
+    range = view_ranges_.at(view_index);
+  }
+  if (range.index_count == 0) {
+    return;
+  }
+  pipeline_->BindPipeline(command_buffer);
+  vkCmdPushConstants(command_buffer,
+                     pipeline_->GetPipelineLayout(),
+                     VK_SHADER_STAGE_VERTEX_BIT,
+                     0,
+                     static_cast<uint32_t>(sizeof(glm::mat4) * projections.size()),
+                     projections.data());
+  vkCmdDrawIndexed(command_buffer, range.index_count, 1, range.first_index, 0, 0);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "vulkan/vulkan_buffer.hpp"
+#include "vulkan/vulkan_rendering_context.hpp"
+#include "vulkan/vulkan_rendering_pipeline.hpp"
+
+#include <memory>
+#include <vector>
+
+// Lays the triangles the lenses hide into depth at the near plane, so early depth testing
+// rejects the scene there. The meshes are given in view space on the z = -1 plane, as
+// XR_KHR_visibility_mask reports them, and are uploaded only when they change.
+class VulkanHiddenAreaMask {
+ private:
+  struct ViewRange {
+    uint32_t first_index;
+    uint32_t index_count;
+  };
+
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline_;
+  bool multiview_;
+
+  std::vector<std::vector<glm::vec2>> view_vertices_;
+  std::vector<std::vector<uint32_t>> view_indices_;
+  std::vector<ViewRange> view_ranges_;
+
+  void Upload();
+
+ public:
+  VulkanHiddenAreaMask() = delete;
+  VulkanHiddenAreaMask(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                       uint32_t view_count);
+
+  // Waits for the GPU before replacing the buffers, meant for the rare mask changes only.
+  void SetViewMesh(uint32_t view_index,
+                   const std::vector<glm::vec2> &vertices,
+                   const std::vector<uint32_t> &indices);
+
+  [[nodiscard]] bool IsEmpty() const;
+
+  // Must be recorded first in the render pass, with the viewport already set. Multiview masks
+  // take the projection of every view, the others only the one of view_index.
+  void Draw(VkCommandBuffer command_buffer,
+            uint32_t view_index,
+            const std::vector<glm::mat4> &projections);
+};
@@ -0,0 +1,209 @@
+#include "vulkan_meshlet_culler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t kCullWorkgroupSize = 64;
+
+// Stays within the 128 bytes every device has to support.
+struct CullPushConstants {
+  glm::mat4 model;
+  glm::vec4 camera_positions[kMaxMeshletCullViews];
+  uint32_t meshlet_count;
+  uint32_t draw_offset;
+  uint32_t first_meshlet;
+  uint32_t view_count;
+};
+static_assert(sizeof(CullPushConstants) <= 128);
+}
+
+VulkanMeshletCuller::VulkanMeshletCuller(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    const geometry::MeshletMesh &mesh,
+    const std::vector<geometry::MeshletDrawRange> &draw_ranges,
+    const std::vector<geometry::MeshletLodRange> &lod_ranges,
+    uint32_t max_instances) :
+    rendering_context_(rendering_context),
+    lod_ranges_(lod_ranges),
+    instance_stride_(0),
+    max_instances_(max_instances) {
+  if (mesh.meshlets.empty() || draw_ranges.size() != mesh.meshlets.size()) {
+    throw std::invalid_argument("meshlet draw ranges do not match the meshlets");
+  }
+  for (const auto &lod: lod_ranges_) {
+    if (lod.first_meshlet + lod.meshlet_count > mesh.meshlets.size()) {
+      throw std::invalid_argument("meshlet lod range out of bounds");
+    }
+    instance_stride_ = std::max(instance_stride_, lod.meshlet_count);
+  }
+  if (instance_stride_ == 0) {
+    throw std::invalid_argument("meshlet mesh has no lods");
+  }
+
+  const std::vector<uint32_t> kCullShader = {
+#include "meshlet_cull.spv"
+  };
+  auto cull_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
+                                                            kCullShader,
+                                                            "main");
+  cull_pipeline_ = std::make_shared<vulkan::VulkanComputePipeline>(rendering_context_,
+                                                                   cull_shader);
+
+  bounds_buffer_ = std::make_shared<vulkan::VulkanBuffer>(
+      rendering_context_,
+      sizeof(geometry::MeshletBounds) * mesh.bounds.size(),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  bounds_buffer_->Update(mesh.bounds.data());
+
+  draw_ranges_buffer_ = std::make_shared<vulkan::VulkanBuffer>(
+      rendering_context_,
+      sizeof(geometry::MeshletDrawRange) * draw_ranges.size(),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  draw_ranges_buffer_->Update(draw_ranges.data());
+
+  draw_commands_buffer_ = std::make_shared<vulkan::VulkanBuffer>(
+      rendering_context_,
+      sizeof(VkDrawIndexedIndirectCommand) * instance_stride_ * max_instances_,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  views_buffer_ = std::make_shared<vulkan::VulkanBuffer>(
+      rendering_context_,
+      sizeof(glm::mat4) * kMaxMeshletCullViews,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  cull_pipeline_->SetBuffer(0, bounds_buffer_);
+  cull_pipeline_->SetBuffer(1, draw_ranges_buffer_);
+  cull_pipeline_->SetBuffer(2, draw_commands_buffer_);
+  cull_pipeline_->SetBuffer(3, views_buffer_);
+}
+
+void VulkanMeshletCuller::Cull(VkCommandBuffer command_buffer, const MeshletInstances &instances) {
+  const size_t kViewCount = instances.view_projections.size();
+  const size_t kInstanceCount = instances.models.size();
+  if (kViewCount == 0 || kViewCount > kMaxMeshletCullViews
+      || kViewCount != instances.eye_positions.size()) {
+    throw std::invalid_argument("invalid meshlet cull views");
+  }
+  if (kInstanceCount > max_instances_ || kInstanceCount != instances.transforms.size()
+      || kInstanceCount != instances.lods.size()) {
+    throw std::invalid_argument("invalid meshlet cull instances");
+  }
+
+  // Previously submitted indirect draws may still read the commands we are about to overwrite,
+  // and previous culls the views.
+  VkMemoryBarrier write_after_read{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = 0,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0,
+                       1, &write_after_read,
+                       0, nullptr,
+                       0, nullptr);
+  vkCmdUpdateBuffer(command_buffer,
+                    views_buffer_->GetBuffer(),
+                    0,
+                    sizeof(glm::mat4) * kViewCount,
+                    instances.view_projections.data());
+  VkMemoryBarrier views_written{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0,
+                       1, &views_written,
+                       0, nullptr,
+                       0, nullptr);
+
+  cull_pipeline_->BindPipeline(command_buffer);
+  for (size_t i = 0; i < kInstanceCount; i++) {
+    const auto &lod = lod_ranges_.at(instances.lods[i]);
+    CullPushConstants push_constants{
+        .model = instances.models[i],
+        .meshlet_count = lod.meshlet_count,
+        .draw_offset = static_cast<uint32_t>(i) * instance_stride_,
+        .first_meshlet = lod.first_meshlet,
+        .view_count = static_cast<uint32_t>(kViewCount),
+    };
+    // The normal cones are tested in object space.
+    const glm::mat4 kInverseModel = glm::inverse(instances.models[i]);
+    for (size_t view = 0; view < kViewCount; view++) {
+      push_constants.camera_positions[view] = kInverseModel
+          * glm::vec4(instances.eye_positions[view], 1.0f);
+    }
+    vkCmdPushConstants(command_buffer,
+                       cull_pipeline_->GetPipelineLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT,
+                       0,
+                       sizeof(push_constants),
+                       &push_constants);
+    vkCmdDispatch(command_buffer,
+                  (lod.meshlet_count + kCullWorkgroupSize - 1) / kCullWorkgroupSize,
+                  1,
+                  1);
+  }
+
+  VkMemoryBarrier read_after_write{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                       0,
+                       1, &read_after_write,
+                       0, nullptr,
+                       0, nullptr);
+}
+
+void VulkanMeshletCuller::Draw(VkCommandBuffer command_buffer,
+                               VkPipelineLayout pipeline_layout,
+                               const MeshletInstances &instances) {
+  const bool kMultiDrawIndirect = rendering_context_->GetEnabledFeatures().multiDrawIndirect;
+  const uint32_t kStride = sizeof(VkDrawIndexedIndirectCommand);
+  for (size_t i = 0; i < instances.transforms.size(); i++) {
+    vkCmdPushConstants(command_buffer,
+                       pipeline_layout,
+                       VK_SHADER_STAGE_VERTEX_BIT,
+                       0,
+                       sizeof(instances.transforms[i]),
+                       &instances.transforms[i]);
+    const uint32_t kMeshletCount = lod_ranges_.at(instances.lods[i]).meshlet_count;
+    VkDeviceSize offset = i * instance_stride_ * kStride;
+    if (kMultiDrawIndirect) {
+      vkCmdDrawIndexedIndirect(command_buffer,
+                               draw_commands_buffer_->GetBuffer(),
+                               offset,
+                               kMeshletCount,
+                               kStride);
+    } else {
+      for (uint32_t meshlet = 0; meshlet < kMeshletCount; meshlet++) {
+        vkCmdDrawIndexedIndirect(command_buffer,
+                                 draw_commands_buffer_->GetBuffer(),
+                                 offset + meshlet * kStride,
+                                 1,
+                                 kStride);
+      }
+    }
+  }
+}
+
+uint32_t VulkanMeshletCuller::GetMaxInstances() const {
+  return max_instances_;
+}
+
+uint32_t VulkanMeshletCuller::GetLodCount() const {
+  return static_cast<uint32_t>(lod_ranges_.size());
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "geometry/meshlet_builder.hpp"
+#include "vulkan/vulkan_buffer.hpp"
+#include "vulkan/vulkan_compute_pipeline.hpp"
+#include "vulkan/vulkan_rendering_context.hpp"
+
+#include <memory>
+#include <vector>
+
+// Views the culler tests against at once, the two eyes of a multiview pass.
+constexpr uint32_t kMaxMeshletCullViews = 2;
+
+struct MeshletInstances {
+  // A meshlet is kept when any of the views sees it inside its frustum and from its front.
+  std::vector<glm::mat4> view_projections;
+  std::vector<glm::vec3> eye_positions;
+  // Per instance. The transforms are pushed to the vertex shader, the model view projection for
+  // single view pipelines and the model alone for multiview ones.
+  std::vector<glm::mat4> models;
+  std::vector<glm::mat4> transforms;
+  std::vector<uint32_t> lods;
+};
+
+// Culls the meshlets of a single mesh against the view frustum and their normal cones on the
+// gpu and writes one VkDrawIndexedIndirectCommand per meshlet, so the surviving clusters are
+// drawn with the regular vertex pipeline. The mesh may hold a whole LOD chain, each instance is
+// culled and drawn with the meshlets of the LOD selected for it. Multiview passes cull against
+// the union of the eye frusta, so both views draw from the same indirect commands.
+class VulkanMeshletCuller {
+ private:
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  std::shared_ptr<vulkan::VulkanComputePipeline> cull_pipeline_;
+
+  std::shared_ptr<vulkan::VulkanBuffer> bounds_buffer_;
+  std::shared_ptr<vulkan::VulkanBuffer> draw_ranges_buffer_;
+  std::shared_ptr<vulkan::VulkanBuffer> draw_commands_buffer_;
+  std::shared_ptr<vulkan::VulkanBuffer> views_buffer_;
+
+  std::vector<geometry::MeshletLodRange> lod_ranges_;
+  // Draw command slots reserved per instance, enough for the largest LOD.
+  uint32_t instance_stride_;
+  uint32_t max_instances_;
+
+ public:
+  VulkanMeshletCuller() = delete;
+  VulkanMeshletCuller(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                      const geometry::MeshletMesh &mesh,
+                      const std::vector<geometry::MeshletDrawRange> &draw_ranges,
+                      const std::vector<geometry::MeshletLodRange> &lod_ranges,
+                      uint32_t max_instances);
+
+  // Must be recorded outside of a render pass.
+  void Cull(VkCommandBuffer command_buffer, const MeshletInstances &instances);
+
+  // The meshlet index buffer has to be bound with the pipeline.
+  void Draw(VkCommandBuffer command_buffer,
+            VkPipelineLayout pipeline_layout,
+            const MeshletInstances &instances);
+
+  [[nodiscard]] uint32_t GetMaxInstances() const;
+
+  [[nodiscard]] uint32_t GetLodCount() const;
+};
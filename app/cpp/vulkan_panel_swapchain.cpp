@@ -0,0 +1,121 @@
+#include "vulkan_panel_swapchain.hpp"
+
+#include <stdexcept>
+
+#include "vulkan/vulkan_utils.hpp"
+
+VulkanPanelSwapchain::VulkanPanelSwapchain(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    uint32_t capacity,
+    const XrSwapchainCreateInfo &swapchain_create_info,
+    uint32_t max_frames_in_flight)
+    : rendering_context_(rendering_context),
+      extent_({swapchain_create_info.width, swapchain_create_info.height}) {
+  if (swapchain_create_info.arraySize != 1 || swapchain_create_info.faceCount != 1) {
+    throw std::invalid_argument("panel swapchains hold a single layer");
+  }
+  swapchain_images_.resize(capacity, {XR_TYPE_SWAPCHAIN_IMAGE_VULKAN_KHR});
+
+  const size_t kSizeInBytes = static_cast<size_t>(extent_.width) * extent_.height
+      * sizeof(uint32_t);
+  for (uint32_t i = 0; i < max_frames_in_flight; i++) {
+    staging_buffers_.push_back(std::make_shared<vulkan::VulkanBuffer>(
+        rendering_context_,
+        kSizeInBytes,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+  }
+
+  command_buffers_.resize(max_frames_in_flight);
+  VkCommandBufferAllocateInfo alloc_info = {};
+  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  alloc_info.commandPool = rendering_context_->GetGraphicsPool();
+  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  alloc_info.commandBufferCount = static_cast<uint32_t>(command_buffers_.size());
+  CHECK_VKCMD(vkAllocateCommandBuffers(rendering_context_->GetDevice(),
+                                       &alloc_info,
+                                       command_buffers_.data()));
+}
+
+XrSwapchainImageBaseHeader *VulkanPanelSwapchain::GetFirstImagePointer() {
+  return reinterpret_cast<XrSwapchainImageBaseHeader *>(&swapchain_images_[0]);
+}
+
+VkCommandBuffer VulkanPanelSwapchain::Upload(uint32_t frame_index,
+                                             uint32_t image_index,
+                                             const std::vector<uint32_t> &pixels) {
+  if (frame_index >= command_buffers_.size()) {
+    throw std::out_of_range("frame index exceeds the frames in flight");
+  }
+  if (image_index >= swapchain_images_.size()) {
+    throw std::out_of_range("image index exceeds the swapchain images");
+  }
+  if (pixels.size() != static_cast<size_t>(extent_.width) * extent_.height) {
+    throw std::invalid_argument("panel pixels do not match the swapchain extent");
+  }
+  const std::shared_ptr<vulkan::VulkanBuffer> &kStagingBuffer = staging_buffers_[frame_index];
+  kStagingBuffer->Update(pixels.data());
+
+  VkCommandBuffer command_buffer = command_buffers_[frame_index];
+  VkCommandBufferBeginInfo begin_info = {};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  CHECK_VKCMD(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+  // The whole image is rewritten, so its previous contents are discarded.
+  VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = swapchain_images_[image_index].image,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       1, &barrier);
+
+  VkBufferImageCopy region = {
+      .bufferOffset = 0,
+      .bufferRowLength = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+      .imageOffset = {0, 0, 0},
+      .imageExtent = {extent_.width, extent_.height, 1},
+  };
+  vkCmdCopyBufferToImage(command_buffer,
+                         kStagingBuffer->GetBuffer(),
+                         swapchain_images_[image_index].image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         1,
+                         &region);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       1, &barrier);
+  CHECK_VKCMD(vkEndCommandBuffer(command_buffer));
+  return command_buffer;
+}
+
+VulkanPanelSwapchain::~VulkanPanelSwapchain() {
+  rendering_context_->WaitForGpuIdle();
+  vkFreeCommandBuffers(rendering_context_->GetDevice(),
+                       rendering_context_->GetGraphicsPool(),
+                       static_cast<uint32_t>(command_buffers_.size()),
+                       command_buffers_.data());
+}
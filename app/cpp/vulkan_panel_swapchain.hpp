@@ -0,0 +1,40 @@
+#pragma once
+
+#include "openxr-include.hpp"
+
+#include "vulkan/vulkan_buffer.hpp"
+#include "vulkan/vulkan_rendering_context.hpp"
+
+#include <memory>
+#include <vector>
+
+// Images of a UI panel swapchain, written from host memory whenever the panel changes instead of
+// being rendered to. Every frame slot stages its own copy of the texels, so an upload never
+// overwrites what a frame in flight still reads.
+class VulkanPanelSwapchain {
+ private:
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  VkExtent2D extent_;
+  std::vector<XrSwapchainImageVulkan2KHR> swapchain_images_{};
+  std::vector<std::shared_ptr<vulkan::VulkanBuffer>> staging_buffers_{};
+  std::vector<VkCommandBuffer> command_buffers_{};
+
+ public:
+  VulkanPanelSwapchain() = delete;
+  VulkanPanelSwapchain(const VulkanPanelSwapchain &) = delete;
+  VulkanPanelSwapchain(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                       uint32_t capacity,
+                       const XrSwapchainCreateInfo &swapchain_create_info,
+                       uint32_t max_frames_in_flight);
+
+  XrSwapchainImageBaseHeader *GetFirstImagePointer();
+
+  // Records the copy of pixels, one RGBA8 texel per pixel row after row, into an acquired image
+  // and returns the command buffer to submit with the frame. The image is left in
+  // VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL for its release.
+  VkCommandBuffer Upload(uint32_t frame_index,
+                         uint32_t image_index,
+                         const std::vector<uint32_t> &pixels);
+
+  virtual ~VulkanPanelSwapchain();
+};
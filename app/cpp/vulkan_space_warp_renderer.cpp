@@ -0,0 +1,318 @@
+#include "vulkan_space_warp_renderer.hpp"
+
+#include <array>
+#include <stdexcept>
+
+#include "vulkan/vulkan_utils.hpp"
+
+namespace {
+constexpr uint32_t kViewProjectionBinding = 0;
+}
+
+VulkanSpaceWarpRenderer::VulkanSpaceWarpRenderer(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    uint32_t motion_vector_capacity,
+    const XrSwapchainCreateInfo &motion_vector_create_info,
+    uint32_t depth_capacity,
+    const XrSwapchainCreateInfo &depth_create_info,
+    const vulkan::VertexBufferLayout &position_layout,
+    std::shared_ptr<vulkan::VulkanBuffer> position_buffer,
+    std::shared_ptr<vulkan::VulkanBuffer> index_buffer,
+    vulkan::DataType index_type,
+    std::shared_ptr<vulkan::VulkanBuffer> view_buffer,
+    uint32_t max_frames_in_flight) :
+    rendering_context_(rendering_context),
+    motion_vector_format_(static_cast<VkFormat>(motion_vector_create_info.format)),
+    depth_format_(static_cast<VkFormat>(depth_create_info.format)),
+    extent_({motion_vector_create_info.width, motion_vector_create_info.height}),
+    array_size_(motion_vector_create_info.arraySize) {
+  if (depth_create_info.width != extent_.width || depth_create_info.height != extent_.height
+      || depth_create_info.arraySize != array_size_) {
+    throw std::invalid_argument("space warp swapchains must share their layout");
+  }
+  if (array_size_ > 1 && view_buffer == nullptr) {
+    throw std::invalid_argument("multiview motion vectors need the view projections");
+  }
+  motion_vector_images_.resize(motion_vector_capacity, {XR_TYPE_SWAPCHAIN_IMAGE_VULKAN_KHR});
+  motion_vector_image_views_.resize(motion_vector_capacity, VK_NULL_HANDLE);
+  depth_images_.resize(depth_capacity, {XR_TYPE_SWAPCHAIN_IMAGE_VULKAN_KHR});
+  depth_image_views_.resize(depth_capacity, VK_NULL_HANDLE);
+
+  CreateRenderPass();
+  CreateCommandBuffers(max_frames_in_flight);
+
+  const std::vector<uint32_t> kVertexShader = {
+#include "vert_motion_vector.spv"
+  };
+  const std::vector<uint32_t> kMultiviewVertexShader = {
+#include "vert_motion_vector_multiview.spv"
+  };
+  const std::vector<uint32_t> kFragmentShader = {
+#include "frag_motion_vector.spv"
+  };
+  auto vertex_shader = std::make_shared<vulkan::VulkanShader>(
+      rendering_context_,
+      array_size_ > 1 ? kMultiviewVertexShader : kVertexShader,
+      "main");
+  auto fragment_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
+                                                                kFragmentShader,
+                                                                "main");
+  pipeline_ = std::make_shared<vulkan::VulkanRenderingPipeline>(
+      rendering_context_,
+      vertex_shader,
+      fragment_shader,
+      position_layout,
+      vulkan::RenderingPipelineConfig{
+          .draw_mode = vulkan::DrawMode::TRIANGLE_LIST,
+          .cull_mode = vulkan::CullMode::BACK,
+          .front_face = vulkan::FrontFace::CCW,
+          .enable_depth_test = true,
+          .depth_function = vulkan::CompareOp::LESS,
+      },
+      render_pass_,
+      VK_SAMPLE_COUNT_1_BIT);
+  pipeline_->SetVertexBuffer(position_buffer, 0);
+  pipeline_->SetIndexBuffer(index_buffer, index_type);
+  if (array_size_ > 1) {
+    pipeline_->SetBuffer(kViewProjectionBinding, view_buffer);
+  }
+}
+
+XrSwapchainImageBaseHeader *VulkanSpaceWarpRenderer::GetFirstMotionVectorImagePointer() {
+  return reinterpret_cast<XrSwapchainImageBaseHeader *>(&motion_vector_images_[0]);
+}
+
+XrSwapchainImageBaseHeader *VulkanSpaceWarpRenderer::GetFirstDepthImagePointer() {
+  return reinterpret_cast<XrSwapchainImageBaseHeader *>(&depth_images_[0]);
+}
+
+void VulkanSpaceWarpRenderer::SetImageIndices(uint32_t motion_vector_image_index,
+                                              uint32_t depth_image_index) {
+  if (motion_vector_image_index >= motion_vector_images_.size()
+      || depth_image_index >= depth_images_.size()) {
+    throw std::out_of_range("image index exceeds the swapchain images");
+  }
+  motion_vector_image_index_ = motion_vector_image_index;
+  depth_image_index_ = depth_image_index;
+  has_image_indices_ = true;
+}
+
+bool VulkanSpaceWarpRenderer::HasImageIndices() const {
+  return has_image_indices_;
+}
+
+VkCommandBuffer VulkanSpaceWarpRenderer::Draw(uint32_t frame_index,
+                                              const std::vector<MotionVectorDraw> &draws) {
+  if (frame_index >= command_buffers_.size()) {
+    throw std::out_of_range("frame index exceeds the frames in flight");
+  }
+  has_image_indices_ = false;
+  VkCommandBuffer command_buffer = command_buffers_[frame_index];
+  VkCommandBufferBeginInfo begin_info = {};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(command_buffer, &begin_info);
+
+  // Objects that did not move leave the cleared zero motion and the far plane behind.
+  std::array<VkClearValue, 2> clear_values = {};
+  clear_values[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+  clear_values[1].depthStencil = {1.0f, 0};
+  const VkRect2D kRenderArea = {{0, 0}, extent_};
+  VkRenderPassBeginInfo render_pass_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = render_pass_,
+      .framebuffer = GetFrameBuffer(),
+      .renderArea = kRenderArea,
+      .clearValueCount = static_cast<uint32_t>(clear_values.size()),
+      .pClearValues = clear_values.data(),
+  };
+  vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+  // Flipped like the views, so the depth lines up with their color.
+  VkViewport viewport = {
+      .x = 0.0f,
+      .y = static_cast<float>(extent_.height),
+      .width = static_cast<float>(extent_.width),
+      .height = -static_cast<float>(extent_.height),
+      .minDepth = 0.0,
+      .maxDepth = 1.0,
+  };
+  vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+  vkCmdSetScissor(command_buffer, 0, 1, &kRenderArea);
+
+  pipeline_->BindPipeline(command_buffer);
+  for (const MotionVectorDraw &draw: draws) {
+    const std::array<glm::mat4, 2> kTransforms = {draw.transform, draw.previous_transform};
+    vkCmdPushConstants(command_buffer,
+                       pipeline_->GetPipelineLayout(),
+                       VK_SHADER_STAGE_VERTEX_BIT,
+                       0,
+                       sizeof(kTransforms),
+                       kTransforms.data());
+    vkCmdDrawIndexed(command_buffer, draw.index_count, 1, draw.first_index, 0, 0);
+  }
+  vkCmdEndRenderPass(command_buffer);
+  vkEndCommandBuffer(command_buffer);
+  return command_buffer;
+}
+
+void VulkanSpaceWarpRenderer::CreateRenderPass() {
+  VkAttachmentDescription motion_vector_attachment = {};
+  motion_vector_attachment.format = motion_vector_format_;
+  motion_vector_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  motion_vector_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  motion_vector_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  motion_vector_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  motion_vector_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  motion_vector_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  motion_vector_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference motion_vector_attachment_ref = {};
+  motion_vector_attachment_ref.attachment = 0;
+  motion_vector_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentDescription depth_attachment = {};
+  depth_attachment.format = depth_format_;
+  depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference depth_attachment_ref = {};
+  depth_attachment_ref.attachment = 1;
+  depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription sub_pass = {};
+  sub_pass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  sub_pass.colorAttachmentCount = 1;
+  sub_pass.pColorAttachments = &motion_vector_attachment_ref;
+  sub_pass.pDepthStencilAttachment = &depth_attachment_ref;
+
+  // The compositor may still read the images the previous time they were acquired.
+  VkSubpassDependency dependency = {};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.dstSubpass = 0;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+      | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+      | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependency.srcAccessMask = 0;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+      | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+  const std::array<VkAttachmentDescription, 2> kAttachments = {
+      motion_vector_attachment,
+      depth_attachment
+  };
+  VkRenderPassCreateInfo render_pass_info = {};
+  render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  render_pass_info.attachmentCount = static_cast<uint32_t>(kAttachments.size());
+  render_pass_info.pAttachments = kAttachments.data();
+  render_pass_info.subpassCount = 1;
+  render_pass_info.pSubpasses = &sub_pass;
+  render_pass_info.dependencyCount = 1;
+  render_pass_info.pDependencies = &dependency;
+
+  const uint32_t kViewMask = (1u << array_size_) - 1;
+  VkRenderPassMultiviewCreateInfo multiview_info{
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO,
+      .subpassCount = 1,
+      .pViewMasks = &kViewMask,
+      .correlationMaskCount = 1,
+      .pCorrelationMasks = &kViewMask,
+  };
+  if (array_size_ > 1) {
+    render_pass_info.pNext = &multiview_info;
+  }
+  CHECK_VKCMD(vkCreateRenderPass(rendering_context_->GetDevice(),
+                                 &render_pass_info,
+                                 nullptr,
+                                 &render_pass_));
+}
+
+void VulkanSpaceWarpRenderer::CreateCommandBuffers(uint32_t max_frames_in_flight) {
+  command_buffers_.resize(max_frames_in_flight);
+  VkCommandBufferAllocateInfo alloc_info = {};
+  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  alloc_info.commandPool = rendering_context_->GetGraphicsPool();
+  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  alloc_info.commandBufferCount = static_cast<uint32_t>(command_buffers_.size());
+  CHECK_VKCMD(vkAllocateCommandBuffers(rendering_context_->GetDevice(),
+                                       &alloc_info,
+                                       command_buffers_.data()));
+}
+
+VkImageView VulkanSpaceWarpRenderer::GetImageView(
+    std::vector<VkImageView> &image_views,
+    const std::vector<XrSwapchainImageVulkan2KHR> &images,
+    uint32_t image_index,
+    VkFormat format,
+    VkImageAspectFlagBits aspect_mask) {
+  if (image_views[image_index] == VK_NULL_HANDLE) {
+    rendering_context_->CreateImageView(images[image_index].image,
+                                        format,
+                                        aspect_mask,
+                                        &image_views[image_index],
+                                        array_size_);
+  }
+  return image_views[image_index];
+}
+
+VkFramebuffer VulkanSpaceWarpRenderer::GetFrameBuffer() {
+  const std::pair<uint32_t, uint32_t> kKey = {motion_vector_image_index_, depth_image_index_};
+  auto it = frame_buffers_.find(kKey);
+  if (it != frame_buffers_.end()) {
+    return it->second;
+  }
+  const std::array<VkImageView, 2> kAttachments = {
+      GetImageView(motion_vector_image_views_,
+                   motion_vector_images_,
+                   motion_vector_image_index_,
+                   motion_vector_format_,
+                   VK_IMAGE_ASPECT_COLOR_BIT),
+      GetImageView(depth_image_views_,
+                   depth_images_,
+                   depth_image_index_,
+                   depth_format_,
+                   VK_IMAGE_ASPECT_DEPTH_BIT),
+  };
+  VkFramebufferCreateInfo framebuffer_info = {};
+  framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebuffer_info.renderPass = render_pass_;
+  framebuffer_info.attachmentCount = static_cast<uint32_t>(kAttachments.size());
+  framebuffer_info.pAttachments = kAttachments.data();
+  framebuffer_info.width = extent_.width;
+  framebuffer_info.height = extent_.height;
+  framebuffer_info.layers = 1;
+  VkFramebuffer frame_buffer = VK_NULL_HANDLE;
+  CHECK_VKCMD(vkCreateFramebuffer(rendering_context_->GetDevice(),
+                                  &framebuffer_info,
+                                  nullptr,
+                                  &frame_buffer));
+  frame_buffers_.insert(std::make_pair(kKey, frame_buffer));
+  return frame_buffer;
+}
+
+VulkanSpaceWarpRenderer::~VulkanSpaceWarpRenderer() {
+  const VkDevice kDevice = rendering_context_->GetDevice();
+  rendering_context_->WaitForGpuIdle();
+  vkFreeCommandBuffers(kDevice,
+                       rendering_context_->GetGraphicsPool(),
+                       static_cast<uint32_t>(command_buffers_.size()),
+                       command_buffers_.data());
+  pipeline_ = nullptr;
+  for (const auto &[images, frame_buffer]: frame_buffers_) {
+    vkDestroyFramebuffer(kDevice, frame_buffer, nullptr);
+  }
+  for (const auto *image_views: {&motion_vector_image_views_, &depth_image_views_}) {
+    for (VkImageView image_view: *image_views) {
+      if (image_view != VK_NULL_HANDLE) {
+        vkDestroyImageView(kDevice, image_view, nullptr);
+      }
+    }
+  }
+  vkDestroyRenderPass(kDevice, render_pass_, nullptr);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "openxr-include.hpp"
+#include <glm/glm.hpp>
+
+#include "vulkan/data_type.hpp"
+#include "vulkan/vertex_buffer_layout.hpp"
+#include "vulkan/vulkan_buffer.hpp"
+#include "vulkan/vulkan_rendering_context.hpp"
+#include "vulkan/vulkan_rendering_pipeline.hpp"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// An object as it is now and as it was in the previous rendered frame. Multiview draws take the
+// model matrices, single views the whole MVPs.
+struct MotionVectorDraw {
+  glm::mat4 transform;
+  glm::mat4 previous_transform;
+  uint32_t first_index;
+  uint32_t index_count;
+};
+
+// Motion vector and depth swapchains of XR_FB_space_warp, laid out like the color swapchain of
+// the views at the runtime's recommended motion vector resolution. The runtime synthesizes every
+// other displayed frame from the last rendered one with them, so the views are rendered at half
+// the display rate. The images are written by a single sampled pass of their own after the views,
+// over the whole image whatever part of the color images is rendered: the compositor maps both to
+// the same field of view.
+class VulkanSpaceWarpRenderer {
+ private:
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline_;
+  VkFormat motion_vector_format_;
+  VkFormat depth_format_;
+  VkExtent2D extent_;
+  uint32_t array_size_;
+  VkRenderPass render_pass_ = VK_NULL_HANDLE;
+
+  std::vector<XrSwapchainImageVulkan2KHR> motion_vector_images_{};
+  std::vector<XrSwapchainImageVulkan2KHR> depth_images_{};
+  // Created on first use, the images are only enumerated after their structs are handed out.
+  std::vector<VkImageView> motion_vector_image_views_{};
+  std::vector<VkImageView> depth_image_views_{};
+  // The runtime acquires the two swapchains independently, so every pair may come up.
+  std::map<std::pair<uint32_t, uint32_t>, VkFramebuffer> frame_buffers_{};
+  uint32_t motion_vector_image_index_ = 0;
+  uint32_t depth_image_index_ = 0;
+  bool has_image_indices_ = false;
+
+  std::vector<VkCommandBuffer> command_buffers_{};
+
+  void CreateRenderPass();
+  void CreateCommandBuffers(uint32_t max_frames_in_flight);
+  VkImageView GetImageView(std::vector<VkImageView> &image_views,
+                           const std::vector<XrSwapchainImageVulkan2KHR> &images,
+                           uint32_t image_index,
+                           VkFormat format,
+                           VkImageAspectFlagBits aspect_mask);
+  VkFramebuffer GetFrameBuffer();
+
+ public:
+  VulkanSpaceWarpRenderer() = delete;
+  VulkanSpaceWarpRenderer(const VulkanSpaceWarpRenderer &) = delete;
+  // Draws index_buffer over the positions of the scene, view_buffer holds the view projections of
+  // multiview and is null for a single view.
+  VulkanSpaceWarpRenderer(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                          uint32_t motion_vector_capacity,
+                          const XrSwapchainCreateInfo &motion_vector_create_info,
+                          uint32_t depth_capacity,
+                          const XrSwapchainCreateInfo &depth_create_info,
+                          const vulkan::VertexBufferLayout &position_layout,
+                          std::shared_ptr<vulkan::VulkanBuffer> position_buffer,
+                          std::shared_ptr<vulkan::VulkanBuffer> index_buffer,
+                          vulkan::DataType index_type,
+                          std::shared_ptr<vulkan::VulkanBuffer> view_buffer,
+                          uint32_t max_frames_in_flight);
+
+  XrSwapchainImageBaseHeader *GetFirstMotionVectorImagePointer();
+
+  XrSwapchainImageBaseHeader *GetFirstDepthImagePointer();
+
+  // Acquired images the next Draw writes.
+  void SetImageIndices(uint32_t motion_vector_image_index, uint32_t depth_image_index);
+
+  // Whether images were set since the last Draw. Frames the runtime does not synthesize from
+  // acquire none.
+  [[nodiscard]] bool HasImageIndices() const;
+
+  // Returns the command buffer of the frame slot, submitted after the views since multiview
+  // reads the view projections they update. The images are left in the attachment layouts for
+  // their release.
+  VkCommandBuffer Draw(uint32_t frame_index, const std::vector<MotionVectorDraw> &draws);
+
+  virtual ~VulkanSpaceWarpRenderer();
+};
@@ -1,35 +1,88 @@
 #include "vulkan_swapchain_context.hpp"
 
+#include <algorithm>
 #include <array>
 
+namespace {
+// Descriptor sets of the depth swapchain, one per image the depth can be resolved from.
+constexpr uint32_t kEyeDepthSource = 0;
+constexpr uint32_t kUpsamplerDepthSource = 1;
+constexpr uint32_t kDepthSourceCount = 2;
+
+// Flipped, so the clip space y of the shaders points up as in OpenXR.
+VkViewport MakeViewport(const VkRect2D &area) {
+  return {
+      .x = static_cast<float>(area.offset.x),
+      .y = static_cast<float>(area.offset.y) + static_cast<float>(area.extent.height),
+      .width = static_cast<float>(area.extent.width),
+      .height = -static_cast<float>(area.extent.height),
+      .minDepth = 0.0,
+      .maxDepth = 1.0,
+  };
+}
+}
+
+void RecordDrawCommands(vulkan::VulkanCommandEncoder &encoder,
+                        const RenderQueue &render_queue,
+                        const std::vector<DrawCommand> &draw_commands) {
+  VkCommandBuffer command_buffer = encoder.GetCommandBuffer();
+  for (const auto &item: render_queue.GetItems()) {
+    const DrawCommand &draw = draw_commands.at(item.payload);
+    encoder.BindPipeline(*draw.pipeline);
+    if (draw.geometry_pool != nullptr) {
+      draw.geometry_pool->Draw(command_buffer,
+                               draw.pipeline->GetPipelineLayout(),
+                               draw.mesh_id,
+                               draw.transform,
+                               draw.lod);
+      continue;
+    }
+    vkCmdPushConstants(command_buffer,
+                       draw.pipeline->GetPipelineLayout(),
+                       VK_SHADER_STAGE_VERTEX_BIT,
+                       0,
+                       sizeof(draw.transform),
+                       &draw.transform);
+    vkCmdDrawIndexed(command_buffer,
+                     draw.index_count,
+                     1,
+                     draw.first_index,
+                     0,
+                     0);
+  }
+}
+
 VulkanSwapchainContext::VulkanSwapchainContext(std::shared_ptr<vulkan::VulkanRenderingContext>
                                                vulkan_rendering_context,
                                                uint32_t capacity,
-                                               const XrSwapchainCreateInfo &swapchain_create_info
+                                               const XrSwapchainCreateInfo &swapchain_create_info,
+                                               uint32_t max_frames_in_flight
 ) :
     rendering_context_(vulkan_rendering_context),
     swapchain_image_format_(static_cast<VkFormat>(swapchain_create_info.format)),
-    swapchain_extent_({swapchain_create_info.width, swapchain_create_info.height}) {
+    swapchain_extent_({swapchain_create_info.width, swapchain_create_info.height}),
+    array_size_(swapchain_create_info.arraySize),
+    max_frames_in_flight_(max_frames_in_flight) {
+  if (array_size_ != 1 && array_size_ != rendering_context_->GetViewCount()) {
+    throw std::runtime_error("swapchain array size does not match the render pass view count");
+  }
   swapchain_images_.resize(capacity);
   swapchain_image_views_.resize(capacity);
   swapchain_frame_buffers_.resize(capacity);
 
-  viewport_ = {
-      .x = 0.0F,
-      .y = static_cast<float>(swapchain_extent_.height),
-      .width = static_cast<float>(swapchain_extent_.width),
-      .height = -static_cast<float>(swapchain_extent_.height),
-      .minDepth = 0.0,
-      .maxDepth = 1.0,
-  };
-  scissor_.extent = {
-      .width = static_cast<uint32_t>(swapchain_extent_.width),
-      .height = static_cast<uint32_t>(swapchain_extent_.height),
-  };
+  render_area_ = {{0, 0}, swapchain_extent_};
 
   for (auto &image: swapchain_images_) {
     image.type = XR_TYPE_SWAPCHAIN_IMAGE_VULKAN_KHR;
   }
+  // The runtime hands out its density map images along with the swapchain images.
+  if (rendering_context_->IsFragmentDensityMapEnabled()) {
+    foveation_images_.resize(capacity, {XR_TYPE_SWAPCHAIN_IMAGE_FOVEATION_VULKAN_FB});
+    foveation_image_views_.resize(capacity, VK_NULL_HANDLE);
+    for (size_t i = 0; i < swapchain_images_.size(); i++) {
+      swapchain_images_[i].next = &foveation_images_[i];
+    }
+  }
 }
 
 XrSwapchainImageBaseHeader *VulkanSwapchainContext::GetFirstImagePointer() {
@@ -45,100 +98,459 @@ void VulkanSwapchainContext::InitSwapchainImageViews() {
         swapchain_images_[i].image,
         swapchain_image_format_,
         VK_IMAGE_ASPECT_COLOR_BIT,
-        &swapchain_image_views_[i]);
+        &swapchain_image_views_[i],
+        array_size_);
   }
   CreateColorResources();
   CreateDepthResources();
   CreateFrameBuffers();
   CreateCommandBuffers();
-  CreateSyncObjects();
 
   inited_ = true;
 }
 
-void VulkanSwapchainContext::Draw(uint32_t image_index,
-                                  std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline,
-                                  uint32_t index_count,
-                                  std::vector<glm::mat4> transforms) {
-  if (images_in_flight_[current_fame_] != VK_NULL_HANDLE) {
-    vkWaitForFences(rendering_context_->GetDevice(),
-                    1,
-                    &images_in_flight_[current_fame_],
-                    VK_TRUE,
-                    UINT64_MAX);
+VkCommandBuffer VulkanSwapchainContext::Draw(uint32_t frame_index,
+                                             uint32_t image_index,
+                                             const RenderQueue &render_queue,
+                                             const std::vector<DrawCommand> &draw_commands,
+                                             std::shared_ptr<vulkan::VulkanBuffer> view_buffer,
+                                             const std::vector<glm::mat4> &view_projections,
+                                             const std::optional<HiddenAreaPass> &hidden_area) {
+  VkCommandBuffer command_buffer = BeginCommandBuffer(frame_index);
+  if (view_buffer != nullptr) {
+    UpdateViewBuffer(command_buffer, *view_buffer, view_projections);
   }
-  images_in_flight_[current_fame_] = in_flight_fences_[current_fame_];
+  RecordPasses(command_buffer, image_index, hidden_area, [&](VkCommandBuffer pass) {
+    // The passes around the scene bind their own pipelines, so every scene starts over.
+    vulkan::VulkanCommandEncoder encoder(pass);
+    RecordDrawCommands(encoder, render_queue, draw_commands);
+    encoder.AddStatistics(bind_statistics_);
+  });
+  vkEndCommandBuffer(command_buffer);
+  return command_buffer;
+}
 
+VkCommandBuffer VulkanSwapchainContext::DrawMeshlets(
+    uint32_t frame_index,
+    uint32_t image_index,
+    std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline,
+    std::shared_ptr<VulkanMeshletCuller> culler,
+    const MeshletInstances &instances,
+    std::shared_ptr<vulkan::VulkanRenderingPipeline> depth_pipeline,
+    std::shared_ptr<vulkan::VulkanBuffer> view_buffer,
+    const std::optional<HiddenAreaPass> &hidden_area) {
+  VkCommandBuffer command_buffer = BeginCommandBuffer(frame_index);
+  if (view_buffer != nullptr) {
+    UpdateViewBuffer(command_buffer, *view_buffer, instances.view_projections);
+  }
+  culler->Cull(command_buffer, instances);
+  RecordPasses(command_buffer, image_index, hidden_area, [&](VkCommandBuffer pass) {
+    // The depth and color pipelines share the position buffer and the index buffer.
+    vulkan::VulkanCommandEncoder encoder(pass);
+    if (depth_pipeline != nullptr) {
+      encoder.BindPipeline(*depth_pipeline);
+      culler->Draw(pass, depth_pipeline->GetPipelineLayout(), instances);
+    }
+    encoder.BindPipeline(*pipeline);
+    culler->Draw(pass, pipeline->GetPipelineLayout(), instances);
+    encoder.AddStatistics(bind_statistics_);
+  });
+  vkEndCommandBuffer(command_buffer);
+  return command_buffer;
+}
+
+void VulkanSwapchainContext::UpdateViewBuffer(VkCommandBuffer command_buffer,
+                                              const vulkan::VulkanBuffer &view_buffer,
+                                              const std::vector<glm::mat4> &view_projections) {
+  // Earlier submissions may still read the buffer in their vertex shaders.
+  VkMemoryBarrier read_barrier{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0,
+                       1,
+                       &read_barrier,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr);
+  vkCmdUpdateBuffer(command_buffer,
+                    view_buffer.GetBuffer(),
+                    0,
+                    sizeof(glm::mat4) * view_projections.size(),
+                    view_projections.data());
+  VkMemoryBarrier write_barrier{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                       0,
+                       1,
+                       &write_barrier,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr);
+}
+
+VkCommandBuffer VulkanSwapchainContext::BeginCommandBuffer(uint32_t frame_index) {
+  if (frame_index >= graphics_command_buffers_.size()) {
+    throw std::out_of_range("frame index exceeds the frames in flight");
+  }
+  // The frame submitter waited for the slot, so the buffer is no longer in use by the GPU.
   VkCommandBufferBeginInfo begin_info = {};
   begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-  vkBeginCommandBuffer(graphics_command_buffers_[current_fame_], &begin_info);
+  vkBeginCommandBuffer(graphics_command_buffers_[frame_index], &begin_info);
+  return graphics_command_buffers_[frame_index];
+}
+
+void VulkanSwapchainContext::RecordPasses(
+    VkCommandBuffer command_buffer,
+    uint32_t image_index,
+    const std::optional<HiddenAreaPass> &hidden_area,
+    const std::function<void(VkCommandBuffer)> &record_scene) {
+  if (temporal_upsampler_ != nullptr) {
+    const VkRect2D kInputArea = temporal_upsampler_->GetInputArea();
+    temporal_upsampler_->BarrierInput(command_buffer);
+    BeginRenderPass(command_buffer,
+                    rendering_context_->GetSamplingRenderPass(),
+                    temporal_upsampler_->GetFrameBuffer(),
+                    kInputArea,
+                    MakeViewport(kInputArea),
+                    hidden_area);
+    record_scene(command_buffer);
+    vkCmdEndRenderPass(command_buffer);
+    temporal_upsampler_->Resolve(command_buffer, swapchain_images_[image_index].image);
+    if (depth_swapchain_ != nullptr) {
+      depth_swapchain_->Resolve(command_buffer,
+                                depth_image_index_,
+                                kUpsamplerDepthSource,
+                                kInputArea,
+                                render_area_);
+    }
+    return;
+  }
+  if (!IsFoveated(foveation_tiles_) || periphery_frame_buffer_ == VK_NULL_HANDLE) {
+    if (depth_swapchain_ != nullptr) {
+      BarrierEyeDepth(command_buffer);
+    }
+    BeginRenderPass(command_buffer,
+                    depth_swapchain_ != nullptr ? rendering_context_->GetDepthSamplingRenderPass()
+                                                : rendering_context_->GetRenderPass(),
+                    swapchain_frame_buffers_[image_index],
+                    render_area_,
+                    MakeViewport(render_area_),
+                    hidden_area);
+    record_scene(command_buffer);
+    vkCmdEndRenderPass(command_buffer);
+    if (depth_swapchain_ != nullptr) {
+      depth_swapchain_->Resolve(command_buffer,
+                                depth_image_index_,
+                                kEyeDepthSource,
+                                render_area_,
+                                render_area_);
+    }
+    return;
+  }
+  // The depth of the two passes is not kept.
+  if (depth_swapchain_ != nullptr) {
+    BarrierEyeDepth(command_buffer);
+    depth_swapchain_->Clear(command_buffer, depth_image_index_);
+  }
+
+  // The whole view at periphery resolution first, upscaled into the render area.
+  const VkRect2D kPeripheryArea = {
+      {0, 0},
+      {std::max(1u, static_cast<uint32_t>(
+          render_area_.extent.width * foveation_tiles_.periphery_scale)),
+       std::max(1u, static_cast<uint32_t>(
+           render_area_.extent.height * foveation_tiles_.periphery_scale))},
+  };
+  BeginRenderPass(command_buffer,
+                  rendering_context_->GetRenderPass(),
+                  periphery_frame_buffer_,
+                  kPeripheryArea,
+                  MakeViewport(kPeripheryArea),
+                  hidden_area);
+  record_scene(command_buffer);
+  vkCmdEndRenderPass(command_buffer);
+  UpscalePeriphery(command_buffer, image_index, kPeripheryArea.extent, render_area_);
+
+  // Then the inset at full resolution, the resolve leaves the periphery outside of it alone.
+  const VkExtent2D kInsetExtent = {
+      static_cast<uint32_t>(render_area_.extent.width * foveation_tiles_.inset_size),
+      static_cast<uint32_t>(render_area_.extent.height * foveation_tiles_.inset_size),
+  };
+  const VkRect2D kInsetArea = {
+      {render_area_.offset.x
+           + static_cast<int32_t>((render_area_.extent.width - kInsetExtent.width) / 2),
+       render_area_.offset.y
+           + static_cast<int32_t>((render_area_.extent.height - kInsetExtent.height) / 2)},
+      kInsetExtent,
+  };
+  BeginRenderPass(command_buffer,
+                  rendering_context_->GetInsetRenderPass(),
+                  swapchain_frame_buffers_[image_index],
+                  kInsetArea,
+                  MakeViewport(render_area_),
+                  hidden_area);
+  record_scene(command_buffer);
+  vkCmdEndRenderPass(command_buffer);
+}
 
+void VulkanSwapchainContext::BeginRenderPass(VkCommandBuffer command_buffer,
+                                             VkRenderPass render_pass,
+                                             VkFramebuffer framebuffer,
+                                             const VkRect2D &render_area,
+                                             const VkViewport &viewport,
+                                             const std::optional<HiddenAreaPass> &hidden_area) {
   VkRenderPassBeginInfo render_pass_info = {};
   render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  render_pass_info.renderPass = rendering_context_->GetRenderPass();
-  render_pass_info.framebuffer = swapchain_frame_buffers_[image_index];
-  render_pass_info.renderArea.offset = {0, 0};
-  render_pass_info.renderArea.extent = swapchain_extent_;
+  render_pass_info.renderPass = render_pass;
+  render_pass_info.framebuffer = framebuffer;
+  render_pass_info.renderArea = render_area;
 
   std::array<VkClearValue, 2> clear_values = {};
-  clear_values[0].color = {{0.184313729f, 0.309803933f, 0.309803933f, 1.0f}};
+  clear_values[0].color = {{clear_color_.r, clear_color_.g, clear_color_.b, clear_color_.a}};
   clear_values[1].depthStencil = {1.0f, 0};
   render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
   render_pass_info.pClearValues = clear_values.data();
-  vkCmdBeginRenderPass(graphics_command_buffers_[current_fame_],
+  vkCmdBeginRenderPass(command_buffer,
                        &render_pass_info,
                        VK_SUBPASS_CONTENTS_INLINE);
-////render
-  pipeline->BindPipeline(graphics_command_buffers_[current_fame_]);
-  vkCmdSetViewport(graphics_command_buffers_[current_fame_], 0, 1, &viewport_);
-  vkCmdSetScissor(graphics_command_buffers_[current_fame_], 0, 1, &scissor_);
-  for (const auto &transform: transforms) {
-    vkCmdPushConstants(graphics_command_buffers_[current_fame_],
-                       pipeline->GetPipelineLayout(),
-                       VK_SHADER_STAGE_VERTEX_BIT,
+  vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+  vkCmdSetScissor(command_buffer, 0, 1, &render_area);
+  if (hidden_area.has_value() && hidden_area->mask != nullptr) {
+    hidden_area->mask->Draw(command_buffer, hidden_area->view_index, hidden_area->projections);
+  }
+  if (far_field_ != nullptr) {
+    far_field_->Draw(command_buffer, far_field_view_projection_);
+  }
+}
+
+void VulkanSwapchainContext::UpscalePeriphery(VkCommandBuffer command_buffer,
+                                              uint32_t image_index,
+                                              const VkExtent2D &periphery_extent,
+                                              const VkRect2D &target_area) {
+  const VkImageSubresourceRange kLayers = {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .baseMipLevel = 0,
+      .levelCount = 1,
+      .baseArrayLayer = 0,
+      .layerCount = array_size_,
+  };
+  std::array<VkImageMemoryBarrier, 2> to_transfer = {
+      VkImageMemoryBarrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+          .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+          .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = periphery_image_,
+          .subresourceRange = kLayers,
+      },
+      VkImageMemoryBarrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = 0,
+          .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+          .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = swapchain_images_[image_index].image,
+          .subresourceRange = kLayers,
+      },
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
                        0,
-                       sizeof(transform),
-                       &transform);
-    vkCmdDrawIndexed(graphics_command_buffers_[current_fame_],
-                     static_cast<uint32_t>(index_count),
-                     1,
-                     0,
-                     0,
-                     0);
+                       0,
+                       nullptr,
+                       0,
+                       nullptr,
+                       static_cast<uint32_t>(to_transfer.size()),
+                       to_transfer.data());
+
+  VkImageBlit blit = {
+      .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, array_size_},
+      .srcOffsets = {{0, 0, 0},
+                     {static_cast<int32_t>(periphery_extent.width),
+                      static_cast<int32_t>(periphery_extent.height),
+                      1}},
+      .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, array_size_},
+      .dstOffsets = {{target_area.offset.x, target_area.offset.y, 0},
+                     {target_area.offset.x + static_cast<int32_t>(target_area.extent.width),
+                      target_area.offset.y + static_cast<int32_t>(target_area.extent.height),
+                      1}},
+  };
+  vkCmdBlitImage(command_buffer,
+                 periphery_image_,
+                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 swapchain_images_[image_index].image,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                 1,
+                 &blit,
+                 VK_FILTER_LINEAR);
+
+  // The inset render pass expects its resolve target as a color attachment.
+  VkImageMemoryBarrier to_attachment = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = swapchain_images_[image_index].image,
+      .subresourceRange = kLayers,
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       0,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr,
+                       1,
+                       &to_attachment);
+}
+
+void VulkanSwapchainContext::BarrierEyeDepth(VkCommandBuffer command_buffer) const {
+  // Earlier frames left the depth read only for the resolve, the next pass clears it.
+  const VkFormat kDepthFormat = rendering_context_->GetDepthAttachmentFormat();
+  const VkImageAspectFlags kAspectMask = kDepthFormat == VK_FORMAT_D32_SFLOAT
+                                         ? VK_IMAGE_ASPECT_DEPTH_BIT
+                                         : VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+  VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+          | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = depth_image_,
+      .subresourceRange = {kAspectMask, 0, 1, 0, array_size_},
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                           | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                       0,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr,
+                       1,
+                       &barrier);
+}
+
+bool VulkanSwapchainContext::IsDepthKept() const {
+  // Same choice of passes as RecordPasses.
+  return temporal_upsampler_ != nullptr
+      || !IsFoveated(foveation_tiles_)
+      || periphery_frame_buffer_ == VK_NULL_HANDLE;
+}
+
+void VulkanSwapchainContext::SetFoveationTiles(const FoveationTiles &tiles) {
+  if (rendering_context_->IsFragmentDensityMapEnabled()) {
+    // The runtime's density map already foveates every render pass.
+    return;
+  }
+  if (tiles.periphery_scale > kMaxFoveationPeripheryScale && IsFoveated(tiles)) {
+    throw std::invalid_argument("periphery scale exceeds the allocated periphery targets");
+  }
+  if (IsFoveated(tiles) && periphery_frame_buffer_ == VK_NULL_HANDLE) {
+    CreatePeripheryResources();
+  }
+  foveation_tiles_ = tiles;
+}
+
+void VulkanSwapchainContext::SetRenderArea(const VkRect2D &render_area) {
+  if (render_area.offset.x < 0 || render_area.offset.y < 0
+      || render_area.extent.width == 0 || render_area.extent.height == 0
+      || render_area.offset.x + render_area.extent.width > swapchain_extent_.width
+      || render_area.offset.y + render_area.extent.height > swapchain_extent_.height) {
+    throw std::out_of_range("render area exceeds the swapchain images");
   }
-////render
-  vkCmdEndRenderPass(graphics_command_buffers_[current_fame_]);
-  vkEndCommandBuffer(graphics_command_buffers_[current_fame_]);
+  render_area_ = render_area;
+}
 
-  VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  VkSubmitInfo submit_info = {};
-  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit_info.waitSemaphoreCount = 0;
-  submit_info.pWaitDstStageMask = wait_stages;
-  submit_info.commandBufferCount = 1;
-  submit_info.pCommandBuffers = &graphics_command_buffers_[current_fame_];
-  submit_info.signalSemaphoreCount = 0;
+void VulkanSwapchainContext::SetFarField(std::shared_ptr<VulkanFarFieldRenderer> far_field,
+                                         const glm::mat4 &view_projection) {
+  far_field_ = far_field;
+  far_field_view_projection_ = view_projection;
+}
 
-  vkResetFences(rendering_context_->GetDevice(), 1, &in_flight_fences_[current_fame_]);
-  if (vkQueueSubmit(rendering_context_->GetGraphicsQueue(),
-                    1,
-                    &submit_info,
-                    in_flight_fences_[current_fame_])
-      != VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
+void VulkanSwapchainContext::SetClearColor(const glm::vec4 &color) {
+  clear_color_ = color;
+}
+
+XrSwapchainImageBaseHeader *VulkanSwapchainContext::AllocateDepthImageStructs(
+    uint32_t capacity,
+    const XrSwapchainCreateInfo &swapchain_create_info) {
+  if (inited_) {
+    throw std::runtime_error("the depth swapchain has to exist before the image views");
   }
-  current_fame_ = (current_fame_ + 1) % max_frames_in_flight_;
+  if (swapchain_create_info.width != swapchain_extent_.width
+      || swapchain_create_info.height != swapchain_extent_.height
+      || swapchain_create_info.arraySize != array_size_) {
+    throw std::invalid_argument("depth swapchain layout does not match the color swapchain");
+  }
+  depth_swapchain_ = std::make_shared<VulkanDepthSwapchain>(rendering_context_,
+                                                            capacity,
+                                                            swapchain_create_info,
+                                                            kDepthSourceCount);
+  return depth_swapchain_->GetFirstImagePointer();
+}
+
+void VulkanSwapchainContext::SetDepthImageIndex(uint32_t image_index) {
+  depth_image_index_ = image_index;
+}
+
+void VulkanSwapchainContext::EnableTemporalUpsampling(float input_scale) {
+  temporal_upsampler_ = std::make_shared<VulkanTemporalUpsampler>(rendering_context_,
+                                                                  swapchain_image_format_,
+                                                                  swapchain_extent_,
+                                                                  array_size_,
+                                                                  input_scale);
+  if (depth_swapchain_ != nullptr) {
+    depth_swapchain_->SetSource(kUpsamplerDepthSource, temporal_upsampler_->GetDepthImage());
+  }
+}
+
+std::vector<glm::mat4> VulkanSwapchainContext::ApplyTemporalJitter(
+    const std::vector<glm::mat4> &view_projections) {
+  if (temporal_upsampler_ == nullptr) {
+    return view_projections;
+  }
+  return temporal_upsampler_->BeginFrame(render_area_, view_projections);
 }
 
 [[nodiscard]] bool VulkanSwapchainContext::IsInited() const {
   return inited_;
 }
 
+const vulkan::BindStatistics &VulkanSwapchainContext::GetBindStatistics() const {
+  return bind_statistics_;
+}
+
 VulkanSwapchainContext::~VulkanSwapchainContext() {
-  for (const auto &fence: in_flight_fences_) {
-    vkDestroyFence(rendering_context_->GetDevice(), fence, nullptr);
-  }
+  // Its views of the depth images go first.
+  depth_swapchain_ = nullptr;
   vkFreeCommandBuffers(rendering_context_->GetDevice(),
                        rendering_context_->GetGraphicsPool(),
                        graphics_command_buffers_.size(),
@@ -146,6 +558,23 @@ VulkanSwapchainContext::~VulkanSwapchainContext() {
   for (const auto &framebuffer: swapchain_frame_buffers_) {
     vkDestroyFramebuffer(rendering_context_->GetDevice(), framebuffer, nullptr);
   }
+  for (auto image_view: foveation_image_views_) {
+    if (image_view != VK_NULL_HANDLE) {
+      vkDestroyImageView(rendering_context_->GetDevice(), image_view, nullptr);
+    }
+  }
+  if (periphery_frame_buffer_ != VK_NULL_HANDLE) {
+    vkDestroyFramebuffer(rendering_context_->GetDevice(), periphery_frame_buffer_, nullptr);
+    vkDestroyImageView(rendering_context_->GetDevice(), periphery_image_view_, nullptr);
+    vkDestroyImage(rendering_context_->GetDevice(), periphery_image_, nullptr);
+    vkFreeMemory(rendering_context_->GetDevice(), periphery_image_memory_, nullptr);
+    vkDestroyImageView(rendering_context_->GetDevice(), periphery_depth_image_view_, nullptr);
+    vkDestroyImage(rendering_context_->GetDevice(), periphery_depth_image_, nullptr);
+    vkFreeMemory(rendering_context_->GetDevice(), periphery_depth_image_memory_, nullptr);
+    vkDestroyImageView(rendering_context_->GetDevice(), periphery_color_image_view_, nullptr);
+    vkDestroyImage(rendering_context_->GetDevice(), periphery_color_image_, nullptr);
+    vkFreeMemory(rendering_context_->GetDevice(), periphery_color_image_memory_, nullptr);
+  }
   if (depth_image_view_ != VK_NULL_HANDLE) {
     vkDestroyImageView(rendering_context_->GetDevice(), depth_image_view_, nullptr);
     vkDestroyImage(rendering_context_->GetDevice(), depth_image_, nullptr);
@@ -170,11 +599,13 @@ void VulkanSwapchainContext::CreateColorResources() {
                                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                   &color_image_,
-                                  &color_image_memory_);
+                                  &color_image_memory_,
+                                  array_size_);
   rendering_context_->CreateImageView(color_image_,
                                       swapchain_image_format_,
                                       VK_IMAGE_ASPECT_COLOR_BIT,
-                                      &color_image_view_);
+                                      &color_image_view_,
+                                      array_size_);
   rendering_context_->TransitionImageLayout(color_image_,
                                             VK_IMAGE_LAYOUT_UNDEFINED,
                                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
@@ -182,29 +613,46 @@ void VulkanSwapchainContext::CreateColorResources() {
 
 void VulkanSwapchainContext::CreateDepthResources() {
   VkFormat depth_format = rendering_context_->GetDepthAttachmentFormat();
+  // Sampled by the resolve into the depth swapchain when there is one.
   rendering_context_->CreateImage(swapchain_extent_.width, swapchain_extent_.height,
                                   rendering_context_->GetRecommendedMsaaSamples(),
                                   depth_format,
-                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                  depth_swapchain_ != nullptr
+                                  ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                                      | VK_IMAGE_USAGE_SAMPLED_BIT
+                                  : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                   &depth_image_,
-                                  &depth_image_memory_);
+                                  &depth_image_memory_,
+                                  array_size_);
   rendering_context_->CreateImageView(depth_image_,
                                       depth_format,
                                       VK_IMAGE_ASPECT_DEPTH_BIT,
-                                      &depth_image_view_);
+                                      &depth_image_view_,
+                                      array_size_);
   rendering_context_->TransitionImageLayout(depth_image_,
                                             VK_IMAGE_LAYOUT_UNDEFINED,
                                             VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+  if (depth_swapchain_ != nullptr) {
+    depth_swapchain_->SetSource(kEyeDepthSource, depth_image_);
+  }
 }
 
 void VulkanSwapchainContext::CreateFrameBuffers() {
   for (size_t i = 0; i < swapchain_image_views_.size(); i++) {
-    std::array<VkImageView, 3> attachments = {
+    std::vector<VkImageView> attachments = {
         color_image_view_,
         depth_image_view_,
         swapchain_image_views_[i]
     };
+    if (rendering_context_->IsFragmentDensityMapEnabled()) {
+      rendering_context_->CreateImageView(foveation_images_[i].image,
+                                          VK_FORMAT_R8G8_UNORM,
+                                          VK_IMAGE_ASPECT_COLOR_BIT,
+                                          &foveation_image_views_[i],
+                                          array_size_);
+      attachments.push_back(foveation_image_views_[i]);
+    }
 
     VkFramebufferCreateInfo framebuffer_info = {};
     framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -213,6 +661,7 @@ void VulkanSwapchainContext::CreateFrameBuffers() {
     framebuffer_info.pAttachments = attachments.data();
     framebuffer_info.width = swapchain_extent_.width;
     framebuffer_info.height = swapchain_extent_.height;
+    // Multiview renders to the array layers selected by the view mask, so layers stays 1.
     framebuffer_info.layers = 1;
     CHECK_VKCMD(vkCreateFramebuffer(rendering_context_->GetDevice(),
                                     &framebuffer_info,
@@ -221,6 +670,78 @@ void VulkanSwapchainContext::CreateFrameBuffers() {
   }
 }
 
+void VulkanSwapchainContext::CreatePeripheryResources() {
+  periphery_extent_ = {
+      std::max(1u, static_cast<uint32_t>(swapchain_extent_.width * kMaxFoveationPeripheryScale)),
+      std::max(1u, static_cast<uint32_t>(swapchain_extent_.height * kMaxFoveationPeripheryScale)),
+  };
+  const VkDevice kDevice = rendering_context_->GetDevice();
+  const VkFormat kDepthFormat = rendering_context_->GetDepthAttachmentFormat();
+  rendering_context_->CreateImage(periphery_extent_.width,
+                                  periphery_extent_.height,
+                                  rendering_context_->GetRecommendedMsaaSamples(),
+                                  swapchain_image_format_,
+                                  VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &periphery_color_image_,
+                                  &periphery_color_image_memory_,
+                                  array_size_);
+  rendering_context_->CreateImageView(periphery_color_image_,
+                                      swapchain_image_format_,
+                                      VK_IMAGE_ASPECT_COLOR_BIT,
+                                      &periphery_color_image_view_,
+                                      array_size_);
+  rendering_context_->CreateImage(periphery_extent_.width,
+                                  periphery_extent_.height,
+                                  rendering_context_->GetRecommendedMsaaSamples(),
+                                  kDepthFormat,
+                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &periphery_depth_image_,
+                                  &periphery_depth_image_memory_,
+                                  array_size_);
+  rendering_context_->CreateImageView(periphery_depth_image_,
+                                      kDepthFormat,
+                                      VK_IMAGE_ASPECT_DEPTH_BIT,
+                                      &periphery_depth_image_view_,
+                                      array_size_);
+  rendering_context_->TransitionImageLayout(periphery_depth_image_,
+                                            VK_IMAGE_LAYOUT_UNDEFINED,
+                                            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+  // Resolve target of the periphery pass and source of the upscale.
+  rendering_context_->CreateImage(periphery_extent_.width,
+                                  periphery_extent_.height,
+                                  VK_SAMPLE_COUNT_1_BIT,
+                                  swapchain_image_format_,
+                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &periphery_image_,
+                                  &periphery_image_memory_,
+                                  array_size_);
+  rendering_context_->CreateImageView(periphery_image_,
+                                      swapchain_image_format_,
+                                      VK_IMAGE_ASPECT_COLOR_BIT,
+                                      &periphery_image_view_,
+                                      array_size_);
+
+  std::array<VkImageView, 3> attachments = {
+      periphery_color_image_view_,
+      periphery_depth_image_view_,
+      periphery_image_view_
+  };
+  VkFramebufferCreateInfo framebuffer_info = {};
+  framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebuffer_info.renderPass = rendering_context_->GetRenderPass();
+  framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebuffer_info.pAttachments = attachments.data();
+  framebuffer_info.width = periphery_extent_.width;
+  framebuffer_info.height = periphery_extent_.height;
+  framebuffer_info.layers = 1;
+  CHECK_VKCMD(vkCreateFramebuffer(kDevice, &framebuffer_info, nullptr, &periphery_frame_buffer_));
+}
+
 void VulkanSwapchainContext::CreateCommandBuffers() {
   graphics_command_buffers_.resize(max_frames_in_flight_);
   VkCommandBufferAllocateInfo alloc_info = {};
@@ -232,20 +753,3 @@ void VulkanSwapchainContext::CreateCommandBuffers() {
                                        &alloc_info,
                                        graphics_command_buffers_.data()));
 }
-
-void VulkanSwapchainContext::CreateSyncObjects() {
-  in_flight_fences_.resize(max_frames_in_flight_);
-  images_in_flight_.resize(swapchain_images_.size(), VK_NULL_HANDLE);
-  VkFenceCreateInfo fence_info = {
-      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-      .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-  };
-  for (size_t i = 0; i < max_frames_in_flight_; i++) {
-    if (vkCreateFence(rendering_context_->GetDevice(),
-                      &fence_info,
-                      nullptr,
-                      &in_flight_fences_[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create sync objects for a frame!");
-    }
-  }
-}
\ No newline at end of file
@@ -3,15 +3,52 @@
 #include "openxr-include.hpp"
 #include <glm/glm.hpp>
 
+#include "foveation.hpp"
+#include "render_queue.hpp"
+#include "vulkan_depth_swapchain.hpp"
+#include "vulkan_far_field_renderer.hpp"
+#include "vulkan_hidden_area_mask.hpp"
+#include "vulkan_meshlet_culler.hpp"
+#include "vulkan_temporal_upsampler.hpp"
+#include "vulkan/vulkan_command_encoder.hpp"
+#include "vulkan/vulkan_geometry_pool.hpp"
 #include "vulkan/vulkan_rendering_context.hpp"
 #include "vulkan/vulkan_rendering_pipeline.hpp"
 #include "vulkan/vulkan_utils.hpp"
 
+#include <functional>
+#include <optional>
+
+// Payload of a RenderQueue item. Draws with a geometry pool pull their vertices from it,
+// the others draw index_count indices from first_index of the pipeline's index buffer.
+struct DrawCommand {
+  std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline;
+  std::shared_ptr<vulkan::VulkanGeometryPool> geometry_pool;
+  uint32_t mesh_id;
+  uint32_t lod;
+  uint32_t first_index;
+  uint32_t index_count;
+  glm::mat4 transform;
+};
+
+// Records the draws of a sorted queue inside a render pass that is already begun.
+void RecordDrawCommands(vulkan::VulkanCommandEncoder &encoder,
+                        const RenderQueue &render_queue,
+                        const std::vector<DrawCommand> &draw_commands);
+
+// Masks the hidden area of view_index, or of every view with multiview, before the scene.
+struct HiddenAreaPass {
+  std::shared_ptr<VulkanHiddenAreaMask> mask;
+  uint32_t view_index;
+  std::vector<glm::mat4> projections;
+};
+
 class VulkanSwapchainContext {
  private:
   std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
   VkFormat swapchain_image_format_;
   VkExtent2D swapchain_extent_;
+  uint32_t array_size_;
   std::vector<XrSwapchainImageVulkan2KHR> swapchain_images_{};
   std::vector<VkImageView> swapchain_image_views_{};
 
@@ -25,40 +62,151 @@ class VulkanSwapchainContext {
   VkDeviceMemory depth_image_memory_ = VK_NULL_HANDLE;
   VkImageView depth_image_view_ = VK_NULL_HANDLE;
 
-  std::vector<VkCommandBuffer> graphics_command_buffers_{};
-  const uint32_t max_frames_in_flight_ = 2;
+  // Chained behind swapchain_images_ when the runtime provides fragment density maps.
+  std::vector<XrSwapchainImageFoveationVulkanFB> foveation_images_{};
+  std::vector<VkImageView> foveation_image_views_{};
+
+  // Tile foveation fallback, allocated on first use at kMaxFoveationPeripheryScale.
+  FoveationTiles foveation_tiles_ = GetFoveationTiles(FoveationLevel::OFF);
+  VkExtent2D periphery_extent_ = {0, 0};
+  VkImage periphery_color_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory periphery_color_image_memory_ = VK_NULL_HANDLE;
+  VkImageView periphery_color_image_view_ = VK_NULL_HANDLE;
+  VkImage periphery_depth_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory periphery_depth_image_memory_ = VK_NULL_HANDLE;
+  VkImageView periphery_depth_image_view_ = VK_NULL_HANDLE;
+  VkImage periphery_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory periphery_image_memory_ = VK_NULL_HANDLE;
+  VkImageView periphery_image_view_ = VK_NULL_HANDLE;
+  VkFramebuffer periphery_frame_buffer_ = VK_NULL_HANDLE;
+
+  std::shared_ptr<VulkanTemporalUpsampler> temporal_upsampler_ = nullptr;
+
+  std::shared_ptr<VulkanFarFieldRenderer> far_field_ = nullptr;
+  glm::mat4 far_field_view_projection_ = glm::mat4(1.0f);
 
-  std::vector<VkFence> in_flight_fences_;
-  std::vector<VkFence> images_in_flight_;
+  // Receives the depth of every frame when the layer is submitted with depth.
+  std::shared_ptr<VulkanDepthSwapchain> depth_swapchain_ = nullptr;
+  uint32_t depth_image_index_ = 0;
+
+  glm::vec4 clear_color_ = glm::vec4(0.184313729f, 0.309803933f, 0.309803933f, 1.0f);
+
+  std::vector<VkCommandBuffer> graphics_command_buffers_{};
+  uint32_t max_frames_in_flight_;
 
   bool inited_ = false;
 
-  uint32_t current_fame_ = 0;
+  // Part of the images rendered this frame, the rest keeps whatever it held.
+  VkRect2D render_area_ = {{0, 0}, {0, 0}};
 
-  VkViewport viewport_ = {0, 0, 0, 0, 0, 1.0};
-  VkRect2D scissor_ = {{0, 0}, {0, 0}};
+  vulkan::BindStatistics bind_statistics_{};
 
   void CreateColorResources();
   void CreateDepthResources();
   void CreateFrameBuffers();
+  void CreatePeripheryResources();
   void CreateCommandBuffers();
-  void CreateSyncObjects();
+
+  void UpdateViewBuffer(VkCommandBuffer command_buffer,
+                        const vulkan::VulkanBuffer &view_buffer,
+                        const std::vector<glm::mat4> &view_projections);
+
+  VkCommandBuffer BeginCommandBuffer(uint32_t frame_index);
+  // Records the scene once, or with tile foveation twice: the whole view at periphery resolution,
+  // upscaled into the swapchain image, and then the inset at full resolution over it. Temporal
+  // upsampling renders once at its input resolution and takes precedence over the tiles.
+  void RecordPasses(VkCommandBuffer command_buffer,
+                    uint32_t image_index,
+                    const std::optional<HiddenAreaPass> &hidden_area,
+                    const std::function<void(VkCommandBuffer)> &record_scene);
+  void BeginRenderPass(VkCommandBuffer command_buffer,
+                       VkRenderPass render_pass,
+                       VkFramebuffer framebuffer,
+                       const VkRect2D &render_area,
+                       const VkViewport &viewport,
+                       const std::optional<HiddenAreaPass> &hidden_area);
+  void UpscalePeriphery(VkCommandBuffer command_buffer,
+                        uint32_t image_index,
+                        const VkExtent2D &periphery_extent,
+                        const VkRect2D &target_area);
+  void BarrierEyeDepth(VkCommandBuffer command_buffer) const;
  public:
   VulkanSwapchainContext() = delete;
   VulkanSwapchainContext(std::shared_ptr<vulkan::VulkanRenderingContext> vulkan_rendering_context,
                          uint32_t capacity,
-                         const XrSwapchainCreateInfo &swapchain_create_info);
+                         const XrSwapchainCreateInfo &swapchain_create_info,
+                         uint32_t max_frames_in_flight);
 
   XrSwapchainImageBaseHeader *GetFirstImagePointer();
 
   void InitSwapchainImageViews();
 
-  void Draw(uint32_t image_index,
-            std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline,
-            uint32_t index_count,
-            std::vector<glm::mat4> transforms);
+  // Draw calls only record, the returned command buffer of the frame slot is submitted by the
+  // caller together with the other views of the frame.
+  // The queue must already be sorted; its payloads index draw_commands. Multiview pipelines read
+  // the view projections from view_buffer, which is updated on the GPU timeline so frames in
+  // flight never see each other's matrices.
+  VkCommandBuffer Draw(uint32_t frame_index,
+                       uint32_t image_index,
+                       const RenderQueue &render_queue,
+                       const std::vector<DrawCommand> &draw_commands,
+                       std::shared_ptr<vulkan::VulkanBuffer> view_buffer = nullptr,
+                       const std::vector<glm::mat4> &view_projections = {},
+                       const std::optional<HiddenAreaPass> &hidden_area = std::nullopt);
+
+  // A depth pipeline lays down depth for the culled meshlets before the color pass shades them.
+  // Multiview pipelines read the view projections of the instances from view_buffer as in Draw.
+  VkCommandBuffer DrawMeshlets(uint32_t frame_index,
+                               uint32_t image_index,
+                               std::shared_ptr<vulkan::VulkanRenderingPipeline> pipeline,
+                               std::shared_ptr<VulkanMeshletCuller> culler,
+                               const MeshletInstances &instances,
+                               std::shared_ptr<vulkan::VulkanRenderingPipeline> depth_pipeline
+                               = nullptr,
+                               std::shared_ptr<vulkan::VulkanBuffer> view_buffer = nullptr,
+                               const std::optional<HiddenAreaPass> &hidden_area = std::nullopt);
+
+  // Ignored when the runtime's density map foveates the render pass. Takes effect with the next
+  // recorded frame; swapchains need TRANSFER_DST usage for the upscale.
+  void SetFoveationTiles(const FoveationTiles &tiles);
+
+  // Restricts the following frames to a sub-rectangle of the images, the imageRect the layer
+  // views hand to the compositor. Defaults to the whole image.
+  void SetRenderArea(const VkRect2D &render_area);
+
+  // Every pass of the following frames starts with the far field reprojected into this view,
+  // view_projection covering the far field's depth range. Null stops it.
+  void SetFarField(std::shared_ptr<VulkanFarFieldRenderer> far_field,
+                   const glm::mat4 &view_projection);
+
+  // Color the passes start from, transparent where a layer below it has to show through.
+  void SetClearColor(const glm::vec4 &color);
+
+  // Images of a depth swapchain laid out like the color one, to be enumerated into before
+  // InitSwapchainImageViews. Every frame then resolves its depth into the render area of the image
+  // set with SetDepthImageIndex. Tile foveation does not keep depth, its frames clear it to the
+  // far plane.
+  XrSwapchainImageBaseHeader *AllocateDepthImageStructs(
+      uint32_t capacity,
+      const XrSwapchainCreateInfo &swapchain_create_info);
+
+  // Whether the next recorded frame resolves its depth, false under tile foveation.
+  [[nodiscard]] bool IsDepthKept() const;
+
+  void SetDepthImageIndex(uint32_t image_index);
+
+  // Renders at input_scale of the render area from then on and upsamples into it. Swapchains need
+  // TRANSFER_DST usage.
+  void EnableTemporalUpsampling(float input_scale);
+
+  // Called once per frame after SetRenderArea with the view projection of every layer. Returns
+  // the matrices to draw with, jittered when upsampling temporally and unchanged otherwise.
+  std::vector<glm::mat4> ApplyTemporalJitter(const std::vector<glm::mat4> &view_projections);
 
   [[nodiscard]] bool IsInited() const;
 
+  // Scene binds of every frame recorded so far, the passes around the scene are left out.
+  [[nodiscard]] const vulkan::BindStatistics &GetBindStatistics() const;
+
   virtual ~VulkanSwapchainContext();
 };
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include "vulkan_temporal_upsampler.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "temporal_jitter.hpp"
+#include "vulkan/vulkan_utils.hpp"
+
+namespace {
+constexpr uint32_t kResolveWorkgroupSize = 8;
+constexpr VkFormat kHistoryFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+struct ResolvePushConstants {
+  glm::mat4 reprojection;
+  glm::vec2 input_uv_scale;
+  glm::vec2 history_uv_scale;
+  glm::vec2 jitter;
+  float history_weight;
+  uint32_t layer;
+  glm::uvec2 output_extent;
+};
+}
+
+VulkanTemporalUpsampler::VulkanTemporalUpsampler(
+    std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+    VkFormat color_format,
+    VkExtent2D output_extent,
+    uint32_t array_size,
+    float input_scale) :
+    rendering_context_(rendering_context),
+    color_format_(color_format),
+    output_extent_(output_extent),
+    input_extent_({std::max(1u, static_cast<uint32_t>(output_extent.width * input_scale)),
+                   std::max(1u, static_cast<uint32_t>(output_extent.height * input_scale))}),
+    array_size_(array_size),
+    input_scale_(input_scale) {
+  if (input_scale <= 0.0f || input_scale > 1.0f) {
+    throw std::invalid_argument("temporal upsampling needs an input scale in (0, 1]");
+  }
+  if (rendering_context_->GetSamplingRenderPass() == VK_NULL_HANDLE) {
+    throw std::runtime_error("temporal upsampling is not available with a density map");
+  }
+
+  const std::vector<uint32_t> kResolveShader = {
+#include "temporal_resolve.spv"
+  };
+  auto resolve_shader = std::make_shared<vulkan::VulkanShader>(rendering_context_,
+                                                               kResolveShader,
+                                                               "main");
+  resolve_pipeline_ = std::make_shared<vulkan::VulkanComputePipeline>(rendering_context_,
+                                                                      resolve_shader,
+                                                                      2);
+
+  CreateInputResources();
+  CreateHistoryResources();
+
+  VkSamplerCreateInfo sampler_info = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = VK_FILTER_LINEAR,
+      .minFilter = VK_FILTER_LINEAR,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .maxLod = 0.0f,
+  };
+  CHECK_VKCMD(vkCreateSampler(rendering_context_->GetDevice(), &sampler_info, nullptr, &sampler_));
+
+  for (uint32_t parity = 0; parity < 2; parity++) {
+    resolve_pipeline_->SetImage(0,
+                                resolve_image_view_,
+                                sampler_,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                parity);
+    resolve_pipeline_->SetImage(1,
+                                depth_image_view_,
+                                sampler_,
+                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                                parity);
+    resolve_pipeline_->SetImage(2,
+                                history_image_views_[parity],
+                                sampler_,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                parity);
+    resolve_pipeline_->SetImage(3,
+                                history_image_views_[1 - parity],
+                                VK_NULL_HANDLE,
+                                VK_IMAGE_LAYOUT_GENERAL,
+                                parity);
+  }
+}
+
+std::vector<glm::mat4> VulkanTemporalUpsampler::BeginFrame(
+    const VkRect2D &output_area,
+    const std::vector<glm::mat4> &view_projections) {
+  if (view_projections.size() != array_size_) {
+    throw std::invalid_argument("temporal upsampling needs a view projection per layer");
+  }
+  if (output_area.offset.x < 0 || output_area.offset.y < 0
+      || output_area.offset.x + output_area.extent.width > output_extent_.width
+      || output_area.offset.y + output_area.extent.height > output_extent_.height) {
+    throw std::out_of_range("temporal upsampling output area exceeds the history");
+  }
+  output_area_ = output_area;
+  input_area_ = {
+      {0, 0},
+      {std::clamp(static_cast<uint32_t>(output_area.extent.width * input_scale_),
+                  1u,
+                  input_extent_.width),
+       std::clamp(static_cast<uint32_t>(output_area.extent.height * input_scale_),
+                  1u,
+                  input_extent_.height)},
+  };
+  view_projections_ = view_projections;
+
+  frame_count_++;
+  const TemporalJitter kJitterOffset = ComputeTemporalJitter(
+      frame_count_,
+      {input_area_.extent.width, input_area_.extent.height});
+  jitter_ = kJitterOffset.uv;
+
+  const glm::mat4 kJitter = glm::translate(glm::mat4(1.0f), glm::vec3(kJitterOffset.clip, 0.0f));
+  std::vector<glm::mat4> jittered{};
+  for (const auto &view_projection: view_projections) {
+    jittered.push_back(kJitter * view_projection);
+  }
+  return jittered;
+}
+
+VkRect2D VulkanTemporalUpsampler::GetInputArea() const {
+  return input_area_;
+}
+
+VkFramebuffer VulkanTemporalUpsampler::GetFrameBuffer() const {
+  return frame_buffer_;
+}
+
+VkImage VulkanTemporalUpsampler::GetDepthImage() const {
+  return depth_image_;
+}
+
+void VulkanTemporalUpsampler::BarrierInput(VkCommandBuffer command_buffer) const {
+  // Only the previous resolve's reads have to finish, the pass discards the old contents.
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                           | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                           | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       0, nullptr);
+}
+
+void VulkanTemporalUpsampler::Resolve(VkCommandBuffer command_buffer, VkImage output_image) {
+  const uint32_t kParity = history_index_;
+  VkImage history = history_images_[kParity];
+  VkImage resolved = history_images_[1 - kParity];
+  const VkImageSubresourceRange kLayers = {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .baseMipLevel = 0,
+      .levelCount = 1,
+      .baseArrayLayer = 0,
+      .layerCount = array_size_,
+  };
+
+  std::vector<VkImageMemoryBarrier> to_resolve = {
+      VkImageMemoryBarrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = 0,
+          .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+          .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = resolved,
+          .subresourceRange = kLayers,
+      },
+  };
+  if (!history_valid_) {
+    // Never written, but the descriptor expects it readable.
+    to_resolve.push_back(VkImageMemoryBarrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = history,
+        .subresourceRange = kLayers,
+    });
+  }
+  // The image written now was read by the previous resolve and copied out before that.
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       static_cast<uint32_t>(to_resolve.size()), to_resolve.data());
+
+  resolve_pipeline_->BindPipeline(command_buffer, kParity);
+  for (uint32_t layer = 0; layer < array_size_; layer++) {
+    ResolvePushConstants push_constants{
+        .reprojection = history_valid_
+                        ? ComputeHistoryReprojection(previous_view_projections_[layer],
+                                                     view_projections_[layer])
+                        : glm::mat4(1.0f),
+        .input_uv_scale = {
+            static_cast<float>(input_area_.extent.width) / input_extent_.width,
+            static_cast<float>(input_area_.extent.height) / input_extent_.height,
+        },
+        .history_uv_scale = {
+            static_cast<float>(history_extent_.width) / output_extent_.width,
+            static_cast<float>(history_extent_.height) / output_extent_.height,
+        },
+        .jitter = jitter_,
+        .history_weight = GetHistoryWeight(history_valid_),
+        .layer = layer,
+        .output_extent = {output_area_.extent.width, output_area_.extent.height},
+    };
+    vkCmdPushConstants(command_buffer,
+                       resolve_pipeline_->GetPipelineLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT,
+                       0,
+                       sizeof(push_constants),
+                       &push_constants);
+    vkCmdDispatch(command_buffer,
+                  (output_area_.extent.width + kResolveWorkgroupSize - 1) / kResolveWorkgroupSize,
+                  (output_area_.extent.height + kResolveWorkgroupSize - 1) / kResolveWorkgroupSize,
+                  1);
+  }
+
+  // Storage images can not be sRGB, so the history is blitted into the output for the encode.
+  std::array<VkImageMemoryBarrier, 2> to_transfer = {
+      VkImageMemoryBarrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+          .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+          .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = resolved,
+          .subresourceRange = kLayers,
+      },
+      VkImageMemoryBarrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = 0,
+          .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+          .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = output_image,
+          .subresourceRange = kLayers,
+      },
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       static_cast<uint32_t>(to_transfer.size()), to_transfer.data());
+
+  const auto kWidth = static_cast<int32_t>(output_area_.extent.width);
+  const auto kHeight = static_cast<int32_t>(output_area_.extent.height);
+  VkImageBlit blit = {
+      .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, array_size_},
+      .srcOffsets = {{0, 0, 0}, {kWidth, kHeight, 1}},
+      .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, array_size_},
+      .dstOffsets = {{output_area_.offset.x, output_area_.offset.y, 0},
+                     {output_area_.offset.x + kWidth, output_area_.offset.y + kHeight, 1}},
+  };
+  vkCmdBlitImage(command_buffer,
+                 resolved,
+                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 output_image,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                 1,
+                 &blit,
+                 VK_FILTER_NEAREST);
+
+  std::array<VkImageMemoryBarrier, 2> to_final = {
+      VkImageMemoryBarrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+          .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = resolved,
+          .subresourceRange = kLayers,
+      },
+      VkImageMemoryBarrier{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+          .dstAccessMask = 0,
+          .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = output_image,
+          .subresourceRange = kLayers,
+      },
+  };
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0,
+                       0, nullptr,
+                       0, nullptr,
+                       static_cast<uint32_t>(to_final.size()), to_final.data());
+
+  previous_view_projections_ = view_projections_;
+  history_index_ = 1 - history_index_;
+  history_extent_ = output_area_.extent;
+  history_valid_ = true;
+}
+
+void VulkanTemporalUpsampler::Invalidate() {
+  history_valid_ = false;
+}
+
+VulkanTemporalUpsampler::~VulkanTemporalUpsampler() {
+  const VkDevice kDevice = rendering_context_->GetDevice();
+  rendering_context_->WaitForGpuIdle();
+  for (size_t i = 0; i < history_images_.size(); i++) {
+    vkDestroyImageView(kDevice, history_image_views_[i], nullptr);
+    vkDestroyImage(kDevice, history_images_[i], nullptr);
+    vkFreeMemory(kDevice, history_image_memories_[i], nullptr);
+  }
+  vkDestroySampler(kDevice, sampler_, nullptr);
+  vkDestroyFramebuffer(kDevice, frame_buffer_, nullptr);
+  vkDestroyImageView(kDevice, resolve_image_view_, nullptr);
+  vkDestroyImage(kDevice, resolve_image_, nullptr);
+  vkFreeMemory(kDevice, resolve_image_memory_, nullptr);
+  vkDestroyImageView(kDevice, depth_image_view_, nullptr);
+  vkDestroyImage(kDevice, depth_image_, nullptr);
+  vkFreeMemory(kDevice, depth_image_memory_, nullptr);
+  vkDestroyImageView(kDevice, color_image_view_, nullptr);
+  vkDestroyImage(kDevice, color_image_, nullptr);
+  vkFreeMemory(kDevice, color_image_memory_, nullptr);
+}
+
+void VulkanTemporalUpsampler::CreateInputResources() {
+  const VkFormat kDepthFormat = rendering_context_->GetDepthAttachmentFormat();
+  rendering_context_->CreateImage(input_extent_.width,
+                                  input_extent_.height,
+                                  rendering_context_->GetRecommendedMsaaSamples(),
+                                  color_format_,
+                                  VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &color_image_,
+                                  &color_image_memory_,
+                                  array_size_);
+  CreateArrayImageView(color_image_, color_format_, VK_IMAGE_ASPECT_COLOR_BIT, &color_image_view_);
+  // Sampled by the resolve, so unlike the eye buffer depth it can not be transient.
+  rendering_context_->CreateImage(input_extent_.width,
+                                  input_extent_.height,
+                                  rendering_context_->GetRecommendedMsaaSamples(),
+                                  kDepthFormat,
+                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &depth_image_,
+                                  &depth_image_memory_,
+                                  array_size_);
+  CreateArrayImageView(depth_image_, kDepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, &depth_image_view_);
+  rendering_context_->CreateImage(input_extent_.width,
+                                  input_extent_.height,
+                                  VK_SAMPLE_COUNT_1_BIT,
+                                  color_format_,
+                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &resolve_image_,
+                                  &resolve_image_memory_,
+                                  array_size_);
+  CreateArrayImageView(resolve_image_,
+                       color_format_,
+                       VK_IMAGE_ASPECT_COLOR_BIT,
+                       &resolve_image_view_);
+
+  std::array<VkImageView, 3> attachments = {
+      color_image_view_,
+      depth_image_view_,
+      resolve_image_view_
+  };
+  VkFramebufferCreateInfo framebuffer_info = {};
+  framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebuffer_info.renderPass = rendering_context_->GetSamplingRenderPass();
+  framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebuffer_info.pAttachments = attachments.data();
+  framebuffer_info.width = input_extent_.width;
+  framebuffer_info.height = input_extent_.height;
+  framebuffer_info.layers = 1;
+  CHECK_VKCMD(vkCreateFramebuffer(rendering_context_->GetDevice(),
+                                  &framebuffer_info,
+                                  nullptr,
+                                  &frame_buffer_));
+}
+
+void VulkanTemporalUpsampler::CreateHistoryResources() {
+  for (size_t i = 0; i < history_images_.size(); i++) {
+    rendering_context_->CreateImage(output_extent_.width,
+                                    output_extent_.height,
+                                    VK_SAMPLE_COUNT_1_BIT,
+                                    kHistoryFormat,
+                                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+                                        | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                    &history_images_[i],
+                                    &history_image_memories_[i],
+                                    array_size_);
+    CreateArrayImageView(history_images_[i],
+                         kHistoryFormat,
+                         VK_IMAGE_ASPECT_COLOR_BIT,
+                         &history_image_views_[i]);
+  }
+}
+
+void VulkanTemporalUpsampler::CreateArrayImageView(VkImage image,
+                                                   VkFormat format,
+                                                   VkImageAspectFlags aspect_mask,
+                                                   VkImageView *image_view) const {
+  // The resolve samples every image as an array, also with a single layer.
+  VkImageViewCreateInfo view_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+      .format = format,
+      .subresourceRange = {
+          .aspectMask = aspect_mask,
+          .baseMipLevel = 0,
+          .levelCount = 1,
+          .baseArrayLayer = 0,
+          .layerCount = array_size_,
+      },
+  };
+  CHECK_VKCMD(vkCreateImageView(rendering_context_->GetDevice(), &view_info, nullptr, image_view));
+}
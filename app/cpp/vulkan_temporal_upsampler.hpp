@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "vulkan/vulkan_compute_pipeline.hpp"
+#include "vulkan/vulkan_rendering_context.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+// Renders the scene below the output resolution with a sub-pixel jitter that cycles over a few
+// frames, and accumulates the jittered frames into a full resolution history. The history is
+// reprojected with the depth of the current frame and the change of the view projection, then
+// clamped to the colors around the current sample so disoccluded and moving content does not
+// ghost. The history belongs to the upsampler rather than to the swapchain images, so it
+// survives the rotation of the image index; with multiview every layer keeps its own.
+// Nothing in here talks to OpenXR, the output is any image with TRANSFER_DST usage.
+class VulkanTemporalUpsampler {
+ private:
+  std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context_;
+  std::shared_ptr<vulkan::VulkanComputePipeline> resolve_pipeline_;
+  VkFormat color_format_;
+  VkExtent2D output_extent_;
+  VkExtent2D input_extent_;
+  uint32_t array_size_;
+  float input_scale_;
+
+  VkImage color_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory color_image_memory_ = VK_NULL_HANDLE;
+  VkImageView color_image_view_ = VK_NULL_HANDLE;
+  VkImage depth_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory depth_image_memory_ = VK_NULL_HANDLE;
+  VkImageView depth_image_view_ = VK_NULL_HANDLE;
+  VkImage resolve_image_ = VK_NULL_HANDLE;
+  VkDeviceMemory resolve_image_memory_ = VK_NULL_HANDLE;
+  VkImageView resolve_image_view_ = VK_NULL_HANDLE;
+  VkFramebuffer frame_buffer_ = VK_NULL_HANDLE;
+  VkSampler sampler_ = VK_NULL_HANDLE;
+
+  // Ping-pong, the descriptor set of each parity reads one and writes the other.
+  std::array<VkImage, 2> history_images_{};
+  std::array<VkDeviceMemory, 2> history_image_memories_{};
+  std::array<VkImageView, 2> history_image_views_{};
+
+  uint64_t frame_count_ = 0;
+  // History image the next resolve reads from.
+  uint32_t history_index_ = 0;
+  bool history_valid_ = false;
+  VkRect2D output_area_ = {{0, 0}, {0, 0}};
+  VkRect2D input_area_ = {{0, 0}, {0, 0}};
+  VkExtent2D history_extent_ = {0, 0};
+  glm::vec2 jitter_ = glm::vec2(0.0f);
+  std::vector<glm::mat4> view_projections_{};
+  std::vector<glm::mat4> previous_view_projections_{};
+
+  void CreateInputResources();
+  void CreateHistoryResources();
+  void CreateArrayImageView(VkImage image,
+                            VkFormat format,
+                            VkImageAspectFlags aspect_mask,
+                            VkImageView *image_view) const;
+
+ public:
+  VulkanTemporalUpsampler() = delete;
+  VulkanTemporalUpsampler(const VulkanTemporalUpsampler &) = delete;
+  // input_scale is the resolution of the rendered frames relative to the output, per dimension.
+  VulkanTemporalUpsampler(std::shared_ptr<vulkan::VulkanRenderingContext> rendering_context,
+                          VkFormat color_format,
+                          VkExtent2D output_extent,
+                          uint32_t array_size,
+                          float input_scale);
+
+  // Starts a frame resolving into output_area. Takes the view projection of every layer and
+  // returns them jittered, to be used for all draws of the frame.
+  std::vector<glm::mat4> BeginFrame(const VkRect2D &output_area,
+                                    const std::vector<glm::mat4> &view_projections);
+
+  // Where the scene is rendered this frame, in the frame buffer of the sampling render pass.
+  [[nodiscard]] VkRect2D GetInputArea() const;
+
+  [[nodiscard]] VkFramebuffer GetFrameBuffer() const;
+
+  // Multisampled depth of the scene pass, in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+  // after it and covering the input area.
+  [[nodiscard]] VkImage GetDepthImage() const;
+
+  // Orders the scene pass after the previous frame's reads of the input images, recorded before
+  // the render pass begins.
+  void BarrierInput(VkCommandBuffer command_buffer) const;
+
+  // Records after the scene pass: resolves into the history and copies the output area of it
+  // into output_image, which is left in VK_IMAGE_LAYOUT_PRESENT_SRC_KHR like the render pass
+  // leaves its resolve target.
+  void Resolve(VkCommandBuffer command_buffer, VkImage output_image);
+
+  // Drops the history, e.g. after a discontinuity of the views.
+  void Invalidate();
+
+  virtual ~VulkanTemporalUpsampler();
+};
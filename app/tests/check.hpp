@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+
+// Failures are counted instead of aborting, so one run reports every broken expectation.
+inline int check_failures = 0;
+
+#define CHECK(condition)                                                          \
+  do {                                                                            \
+    if (!(condition)) {                                                           \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      check_failures++;                                                           \
+    }                                                                             \
+  } while (false)
+
+inline int CheckResult() {
+  if (check_failures > 0) {
+    std::fprintf(stderr, "%d checks failed\n", check_failures);
+    return 1;
+  }
+  return 0;
+}
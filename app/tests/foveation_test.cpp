@@ -0,0 +1,49 @@
+#include "foveation.hpp"
+
+#include <initializer_list>
+
+#include "check.hpp"
+
+namespace {
+float GetShadedFraction(const FoveationTiles &tiles) {
+  return tiles.inset_size * tiles.inset_size + tiles.periphery_scale * tiles.periphery_scale;
+}
+
+void TestSelectionKeepsTheMinimum() {
+  CHECK(SelectFoveationLevel(FoveationLevel::OFF, FoveationLevel::OFF) == FoveationLevel::OFF);
+  CHECK(SelectFoveationLevel(FoveationLevel::HIGH, FoveationLevel::OFF) == FoveationLevel::HIGH);
+  CHECK(SelectFoveationLevel(FoveationLevel::LOW, FoveationLevel::MEDIUM)
+            == FoveationLevel::MEDIUM);
+  CHECK(SelectFoveationLevel(FoveationLevel::MEDIUM, FoveationLevel::HIGH)
+            == FoveationLevel::HIGH);
+  CHECK(SelectFoveationLevel(FoveationLevel::HIGH, FoveationLevel::LOW) == FoveationLevel::HIGH);
+}
+
+void TestOffShadesEverything() {
+  const FoveationTiles kTiles = GetFoveationTiles(FoveationLevel::OFF);
+  CHECK(kTiles.inset_size == 1.0f);
+  CHECK(kTiles.periphery_scale == 1.0f);
+  CHECK(!IsFoveated(kTiles));
+}
+
+void TestHigherLevelsShadeLess() {
+  const FoveationTiles kLow = GetFoveationTiles(FoveationLevel::LOW);
+  const FoveationTiles kMedium = GetFoveationTiles(FoveationLevel::MEDIUM);
+  const FoveationTiles kHigh = GetFoveationTiles(FoveationLevel::HIGH);
+  for (const FoveationTiles &tiles: {kLow, kMedium, kHigh}) {
+    CHECK(IsFoveated(tiles));
+    CHECK(GetShadedFraction(tiles) < 1.0f);
+    // The periphery targets are never reallocated.
+    CHECK(tiles.periphery_scale <= kMaxFoveationPeripheryScale);
+  }
+  CHECK(GetShadedFraction(kLow) > GetShadedFraction(kMedium));
+  CHECK(GetShadedFraction(kMedium) > GetShadedFraction(kHigh));
+}
+}
+
+int main() {
+  TestSelectionKeepsTheMinimum();
+  TestOffShadesEverything();
+  TestHigherLevelsShadeLess();
+  return CheckResult();
+}
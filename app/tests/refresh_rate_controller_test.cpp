@@ -0,0 +1,95 @@
+#include "refresh_rate_controller.hpp"
+
+#include "check.hpp"
+
+namespace {
+constexpr int64_t kMillisecond = 1'000'000;
+// Frames judged at once and the wait before a left rate is tried again, see the controller.
+constexpr uint64_t kWindowFrames = 120;
+constexpr uint64_t kInitialBackoffFrames = 600;
+
+int64_t GetDisplayPeriod(float refresh_rate) {
+  return static_cast<int64_t>(1e9 / refresh_rate);
+}
+
+// Feeds a trace of frames that all take frame_time on the CPU and the GPU, paced at whatever rate
+// the controller picks, and returns the rate after the last one.
+float Run(RefreshRateController &controller, uint64_t frames, int64_t frame_time) {
+  float rate = controller.GetRefreshRate();
+  for (uint64_t i = 0; i < frames; i++) {
+    rate = controller.Update(frame_time, frame_time, GetDisplayPeriod(rate));
+  }
+  return rate;
+}
+
+void TestStartsClosestToTheCurrentRate() {
+  CHECK(RefreshRateController({120.0f, 72.0f, 90.0f}, 89.9f).GetRefreshRate() == 90.0f);
+  CHECK(RefreshRateController({72.0f, 90.0f}).GetRefreshRate() == 72.0f);
+  CHECK(RefreshRateController({72.0f, 90.0f, 120.0f}).GetLowestRefreshRate() == 72.0f);
+  CHECK(RefreshRateController().GetRefreshRate() == 0.0f);
+}
+
+void TestUpgradesWithHeadroom() {
+  RefreshRateController controller({72.0f, 90.0f, 120.0f}, 72.0f);
+  // A partial window changes nothing.
+  CHECK(Run(controller, kWindowFrames - 1, 5 * kMillisecond) == 72.0f);
+  CHECK(Run(controller, 1, 5 * kMillisecond) == 90.0f);
+  CHECK(Run(controller, kWindowFrames, 5 * kMillisecond) == 120.0f);
+  CHECK(Run(controller, 4 * kWindowFrames, 5 * kMillisecond) == 120.0f);
+}
+
+void TestDowngradesOnMissedFrames() {
+  RefreshRateController controller({72.0f, 90.0f, 120.0f}, 120.0f);
+  // Over 95% of the 8.3 ms period.
+  CHECK(Run(controller, kWindowFrames, 10 * kMillisecond) == 90.0f);
+  // Fits 90 Hz but leaves no room for 120 Hz, so it settles.
+  CHECK(Run(controller, 4 * kWindowFrames, 10 * kMillisecond) == 90.0f);
+  CHECK(Run(controller, kWindowFrames, 13 * kMillisecond) == 72.0f);
+  // Nothing below the lowest rate.
+  CHECK(Run(controller, kWindowFrames, 20 * kMillisecond) == 72.0f);
+}
+
+void TestIgnoresRareSpikes() {
+  RefreshRateController controller({72.0f, 90.0f}, 90.0f);
+  const int64_t kPeriod = GetDisplayPeriod(90.0f);
+  float rate = 90.0f;
+  for (uint64_t i = 0; i < kWindowFrames; i++) {
+    // 5 of 120 frames stay above the 95th percentile.
+    const int64_t kFrameTime = i % 24 == 0 ? 20 * kMillisecond : 8 * kMillisecond;
+    rate = controller.Update(kFrameTime, kFrameTime, kPeriod);
+  }
+  CHECK(rate == 90.0f);
+}
+
+void TestBacksOffFromAFailedRate() {
+  RefreshRateController controller({72.0f, 90.0f}, 90.0f);
+  CHECK(Run(controller, kWindowFrames, 11 * kMillisecond) == 72.0f);
+  // Light frames do not return to 90 Hz before the backoff from the drop has passed.
+  CHECK(Run(controller, kInitialBackoffFrames - kWindowFrames, 5 * kMillisecond) == 72.0f);
+  CHECK(Run(controller, kWindowFrames, 5 * kMillisecond) == 90.0f);
+  // Failing again doubles the wait.
+  CHECK(Run(controller, kWindowFrames, 11 * kMillisecond) == 72.0f);
+  CHECK(Run(controller, 2 * kInitialBackoffFrames - kWindowFrames, 5 * kMillisecond) == 72.0f);
+  CHECK(Run(controller, kWindowFrames, 5 * kMillisecond) == 90.0f);
+}
+
+void TestGpuTimeDecides() {
+  RefreshRateController controller({72.0f, 90.0f}, 90.0f);
+  const int64_t kPeriod = GetDisplayPeriod(90.0f);
+  float rate = 90.0f;
+  for (uint64_t i = 0; i < kWindowFrames; i++) {
+    rate = controller.Update(4 * kMillisecond, 11 * kMillisecond, kPeriod);
+  }
+  CHECK(rate == 72.0f);
+}
+}
+
+int main() {
+  TestStartsClosestToTheCurrentRate();
+  TestUpgradesWithHeadroom();
+  TestDowngradesOnMissedFrames();
+  TestIgnoresRareSpikes();
+  TestBacksOffFromAFailedRate();
+  TestGpuTimeDecides();
+  return CheckResult();
+}
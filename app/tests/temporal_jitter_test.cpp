@@ -0,0 +1,83 @@
+#include "temporal_jitter.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+#include "check.hpp"
+
+namespace {
+constexpr float kEpsilon = 1e-3f;
+
+bool IsNear(const glm::vec4 &a, const glm::vec4 &b) {
+  return glm::all(glm::lessThan(glm::abs(a - b), glm::vec4(kEpsilon)));
+}
+
+void TestJitterStaysWithinAPixel() {
+  const glm::uvec2 kExtent = {1024, 512};
+  glm::vec2 sum(0.0f);
+  for (uint64_t frame = 0; frame < kTemporalJitterPhases; frame++) {
+    const TemporalJitter kJitter = ComputeTemporalJitter(frame, kExtent);
+    const glm::vec2 kPixels = kJitter.clip * glm::vec2(kExtent) / 2.0f;
+    CHECK(std::abs(kPixels.x) < 0.5f);
+    CHECK(std::abs(kPixels.y) < 0.5f);
+    sum += kPixels;
+  }
+  // Spread around the pixel center rather than piled up on one side.
+  CHECK(std::abs(sum.x / kTemporalJitterPhases) < 0.1f);
+  CHECK(std::abs(sum.y / kTemporalJitterPhases) < 0.1f);
+}
+
+void TestJitterCycles() {
+  const glm::uvec2 kExtent = {800, 600};
+  for (uint64_t frame = 0; frame < kTemporalJitterPhases; frame++) {
+    const TemporalJitter kJitter = ComputeTemporalJitter(frame, kExtent);
+    const TemporalJitter kNextCycle = ComputeTemporalJitter(frame + kTemporalJitterPhases, kExtent);
+    CHECK(kJitter.clip == kNextCycle.clip);
+    // No two phases of a cycle sample the same spot.
+    for (uint64_t other = frame + 1; other < kTemporalJitterPhases; other++) {
+      CHECK(kJitter.clip != ComputeTemporalJitter(other, kExtent).clip);
+    }
+  }
+}
+
+void TestUvJitterFollowsTheFlippedViewport() {
+  const TemporalJitter kJitter = ComputeTemporalJitter(3, {640, 480});
+  CHECK(std::abs(kJitter.uv.x - 0.5f * kJitter.clip.x) < kEpsilon);
+  CHECK(std::abs(kJitter.uv.y + 0.5f * kJitter.clip.y) < kEpsilon);
+}
+
+void TestHistoryWeight() {
+  CHECK(GetHistoryWeight(false) == 0.0f);
+  CHECK(GetHistoryWeight(true) > 0.0f);
+  CHECK(GetHistoryWeight(true) < 1.0f);
+}
+
+void TestStillViewReprojectsInPlace() {
+  const glm::mat4 kViewProjection = glm::perspective(1.5f, 1.0f, 0.1f, 100.0f)
+      * glm::lookAt(glm::vec3(0.0f, 1.6f, 0.0f), glm::vec3(0.0f, 1.6f, -1.0f), glm::vec3(0, 1, 0));
+  const glm::vec4 kClip = kViewProjection * glm::vec4(0.3f, 1.2f, -4.0f, 1.0f);
+  CHECK(IsNear(ComputeHistoryReprojection(kViewProjection, kViewProjection) * kClip, kClip));
+}
+
+void TestMovedViewReprojectsIntoThePreviousFrame() {
+  const glm::mat4 kProjection = glm::perspective(1.5f, 1.0f, 0.1f, 100.0f);
+  const glm::mat4 kPrevious = kProjection
+      * glm::lookAt(glm::vec3(0.0f, 1.6f, 0.0f), glm::vec3(0.0f, 1.6f, -1.0f), glm::vec3(0, 1, 0));
+  const glm::mat4 kCurrent = kProjection
+      * glm::lookAt(glm::vec3(0.1f, 1.6f, 0.0f), glm::vec3(0.2f, 1.6f, -1.0f), glm::vec3(0, 1, 0));
+  const glm::vec4 kPoint = glm::vec4(0.3f, 1.2f, -4.0f, 1.0f);
+  CHECK(IsNear(ComputeHistoryReprojection(kPrevious, kCurrent) * (kCurrent * kPoint),
+               kPrevious * kPoint));
+}
+}
+
+int main() {
+  TestJitterStaysWithinAPixel();
+  TestJitterCycles();
+  TestUvJitterFollowsTheFlippedViewport();
+  TestHistoryWeight();
+  TestStillViewReprojectsInPlace();
+  TestMovedViewReprojectsIntoThePreviousFrame();
+  return CheckResult();
+}